@@ -0,0 +1,136 @@
+#ifndef COMMON_ARENA_H
+#define COMMON_ARENA_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <sys/mman.h>
+
+#include "args.h"
+#include "threads.h"
+
+// Арена процесса: одна область памяти, резервируемая при запуске, из которой буферы
+// выдаются сдвигом указателя с выравниванием на строку кэша. Буферы всей программы
+// берутся до замеров; временные буферы фаз берутся после отметки (arena_mark)
+// и возвращаются откатом к ней (arena_reset), поэтому в следующей фазе и следующем
+// запуске те же страницы используются повторно. Страницы, впервые выдаваемые ареной,
+// заполняются нулями потоками процесса (первое касание), так что ошибки страниц и
+// время распределителя в измеряемую часть не попадают. Пик занятости (peak) — объём
+// памяти, который процесс реально использовал; подкачанная часть (touched) может быть
+// больше, если арена переживает несколько заданий (служебный режим).
+// В параллельных программах (mpi.h подключён раньше этого заголовка) arena_report
+// печатает наибольший по процессам пик.
+
+#define ARENA_ALIGN 64  // выравнивание буферов (строка кэша)
+#define ARENA_HUGE_PAGE (2UL << 20)
+#define ARENA_SLACK (1UL << 20)  // запас к оценке программы на выравнивание и мелкие массивы
+
+typedef struct {
+    char* base;
+    size_t capacity;  // зарезервировано байт
+    size_t used;      // выдано сейчас
+    size_t peak;      // наибольшее used (с последнего arena_ensure)
+    size_t touched;   // страницы до touched уже подкачаны
+    int huge;
+} arena;
+
+// Резервирование capacity байт (без подкачки страниц). huge — просить прозрачные
+// большие страницы. Возвращает 0, если адресное пространство не выделено
+static inline int arena_init(arena* a, size_t capacity, int huge) {
+    a->capacity = (capacity + ARENA_HUGE_PAGE - 1) / ARENA_HUGE_PAGE * ARENA_HUGE_PAGE;
+    a->used = a->peak = a->touched = 0;
+    a->huge = huge;
+    void* p = mmap(NULL, a->capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    a->base = p == MAP_FAILED ? NULL : (char*)p;
+#ifdef MADV_HUGEPAGE
+    if (a->base && huge)
+        madvise(a->base, a->capacity, MADV_HUGEPAGE);
+#endif
+    return a->base != NULL;
+}
+
+static inline void arena_free(arena* a) {
+    if (a->base)
+        munmap(a->base, a->capacity);
+    a->base = NULL;
+}
+
+// Буфер из bytes байт или NULL, если арена исчерпана
+static inline void* arena_alloc(arena* a, size_t bytes) {
+    size_t start = (a->used + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+    if (start > a->capacity || bytes > a->capacity - start)
+        return NULL;
+    size_t end = start + bytes;
+    if (end > a->touched) {
+        size_t from = start > a->touched ? start : a->touched;
+        threads_first_touch(a->base + from, 1, (long long)(end - from));
+        a->touched = end;
+    }
+    if (end > a->peak)
+        a->peak = end;
+    a->used = end;
+    return a->base + start;
+}
+
+// Буфер из count элементов размера elem (хотя бы одного, как malloc для пустых блоков)
+static inline void* arena_array(arena* a, size_t elem, long long count) {
+    return arena_alloc(a, elem * (size_t)(count > 0 ? count : 1));
+}
+
+static inline size_t arena_mark(const arena* a) {
+    return a->used;
+}
+
+static inline void arena_reset(arena* a, size_t mark) {
+    a->used = mark;
+}
+
+// Резервирование по параметрам: --arena=<байт> (с суффиксами K/M/G) заменяет оценку needed,
+// --huge включает большие страницы. Возвращает 0 при некорректном значении или ошибке mmap
+static inline int arena_setup(arena* a, int argc, char* argv[], size_t needed) {
+    long long capacity = arg_size(argc, argv, "--arena", (long long)needed);
+    if (capacity <= 0)
+        return 0;
+    return arena_init(a, (size_t)capacity, arg_flag(argc, argv, "--huge"));
+}
+
+// То же для арены, переживающей несколько заданий (служебный режим): арена опустошается
+// и пик считается заново, а резерв пересоздаётся, только если его не хватает или меняется
+// --huge, так что подкачанные страницы используются следующими заданиями.
+// Пустая арена — { NULL, 0, 0, 0, 0, 0 }
+static inline int arena_ensure(arena* a, int argc, char* argv[], size_t needed) {
+    long long capacity = arg_size(argc, argv, "--arena", (long long)needed);
+    int huge = arg_flag(argc, argv, "--huge");
+    if (capacity <= 0)
+        return 0;
+    a->used = a->peak = 0;
+    if (a->base && (size_t)capacity <= a->capacity && huge == a->huge)
+        return 1;
+    arena_free(a);
+    return arena_init(a, (size_t)capacity, huge);
+}
+
+#ifdef MPI_VERSION
+// Буфер из count элементов; если арена исчерпана, программа завершается с подсказкой про --arena
+static inline void* arena_take(arena* a, size_t elem, long long count) {
+    void* p = arena_array(a, elem, count);
+    if (!p) {
+        printf("Ошибка: арена процесса исчерпана (резерв %zu байт), увеличьте --arena.\n", a->capacity);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    return p;
+}
+
+// Печать на root наибольшего по процессам пика и резерва арены; возвращает пик (на root)
+static inline size_t arena_report(const arena* a, int root, MPI_Comm comm) {
+    unsigned long long mine[2] = { a->peak, a->capacity }, most[2] = { 0, 0 };
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Reduce(mine, most, 2, MPI_UNSIGNED_LONG_LONG, MPI_MAX, root, comm);
+    if (rank == root)
+        printf("Память арены: пик %.1f МиБ на процесс (максимум по процессам), резерв %.1f МиБ\n",
+               most[0] / 1048576.0, most[1] / 1048576.0);
+    return (size_t)most[0];
+}
+#endif
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef COMMON_ARGS_H
+#define COMMON_ARGS_H
+
+#include <stdlib.h>
+#include <string.h>
+
+// Разбор необязательных параметров вида --ключ=значение.
+// Первый позиционный параметр (число запусков) программы разбирают сами.
+
+// Значение параметра --name=value или NULL, если параметр не передан
+static inline const char* arg_value(int argc, char* argv[], const char* name) {
+    size_t len = strlen(name);
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], name, len) == 0 && argv[i][len] == '=')
+            return argv[i] + len + 1;
+    }
+    return NULL;
+}
+
+// Есть ли среди параметров флаг --name (без значения)
+static inline int arg_flag(int argc, char* argv[], const char* name) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], name) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+// Целочисленный параметр со значением по умолчанию
+static inline long long arg_long(int argc, char* argv[], const char* name, long long def) {
+    const char* v = arg_value(argc, argv, name);
+    return v ? atoll(v) : def;
+}
+
+// Размер задачи: целое число с необязательным суффиксом K, M или G (10^3, 10^6, 10^9).
+// Возвращает -1, если значение не разобрано
+static inline long long arg_size(int argc, char* argv[], const char* name, long long def) {
+    const char* v = arg_value(argc, argv, name);
+    if (!v)
+        return def;
+
+    char* end = NULL;
+    long long n = strtoll(v, &end, 10);
+    if (end == v || n < 0)
+        return -1;
+    switch (*end) {
+        case 'k': case 'K': n *= 1000LL; end++; break;
+        case 'm': case 'M': n *= 1000000LL; end++; break;
+        case 'g': case 'G': n *= 1000000000LL; end++; break;
+        default: break;
+    }
+    return *end == '\0' ? n : -1;
+}
+
+// Строковый параметр со значением по умолчанию
+static inline const char* arg_str(int argc, char* argv[], const char* name, const char* def) {
+    const char* v = arg_value(argc, argv, name);
+    return v ? v : def;
+}
+
+#endif
@@ -0,0 +1,419 @@
+#ifndef COMMON_BENCH_H
+#define COMMON_BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include "args.h"
+#ifdef MPI_VERSION
+#include "coll.h"
+#endif
+
+// Общий измерительный каркас для всех программ.
+// Программа регистрирует серии замеров (по одной на операцию), выполняет
+// warmup + runs итераций и записывает время каждой; прогревочные итерации
+// не учитываются. В параллельных программах (mpi.h подключён раньше этого
+// заголовка) время итерации заменяется максимумом по процессам, а отношение
+// максимума к среднему по процессам печатается как дисбаланс.
+// Режим замера --timing: barrier — операции обрамляются барьерами (bench_sync),
+// local — без барьеров, каждый процесс засекает свою операцию сам, global — без
+// барьеров, время итерации — от самого раннего начала до самого позднего конца
+// по часам процессов, один раз выровненным относительно процесса 0 (bench_timing_setup).
+// Итог печатается таблицей min/медиана/p95/max (bench_report) и, по --format=csv|json,
+// дописывается машиночитаемой строкой в --out или в stdout (bench_write).
+
+#define BENCH_MAX_SERIES 8
+#define BENCH_MAX_PARAMS 16
+#define BENCH_PARAM_LEN 64
+
+typedef struct {
+    const char* name;   // имя для CSV/JSON
+    const char* label;  // подпись в таблице
+    double* samples;    // время каждой учтённой итерации, секунды
+    double* starts;     // начало каждой итерации по часам процесса (bench_record_span)
+    double* imbalance;  // максимум по процессам, делённый на среднее (после свёртки)
+    int count;
+    int spans;          // записывались начала итераций
+} bench_series;
+
+typedef struct {
+    double min, median, p95, max, mean, stddev;
+} bench_stats;
+
+typedef enum { BENCH_TIMING_BARRIER, BENCH_TIMING_LOCAL, BENCH_TIMING_GLOBAL } bench_timing;
+
+static const char* const bench_timing_names[] = { "barrier", "local", "global" };
+
+typedef struct {
+    const char* program;
+    int runs, warmup;
+    int nproc, threads;
+    long long size;
+    const char* format;  // text, csv или json
+    const char* out_path;
+    bench_timing timing;
+    double clock_offset; // поправка часов процесса к часам процесса 0, секунды
+    int reduced;         // 1 после свёртки по процессам
+    bench_series series[BENCH_MAX_SERIES];
+    int nseries;
+    char param_keys[BENCH_MAX_PARAMS][BENCH_PARAM_LEN];
+    char param_values[BENCH_MAX_PARAMS][BENCH_PARAM_LEN];
+    int nparams;
+} bench;
+
+// Настенное время в секундах (clock() считает процессорное время, а не прошедшее)
+static inline double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Разбор --warmup=<число> (по умолчанию 1), --format=text|csv|json, --out=<файл>
+// и --timing=barrier|local|global. Возвращает 0 при ошибке в параметрах
+static inline int bench_init(bench* b, const char* program, int runs, int argc, char* argv[]) {
+    memset(b, 0, sizeof(*b));
+    b->program = program;
+    b->runs = runs;
+    b->warmup = (int)arg_long(argc, argv, "--warmup", 1);
+    b->format = arg_str(argc, argv, "--format", "text");
+    b->out_path = arg_value(argc, argv, "--out");
+    b->nproc = 1;
+    b->threads = 1;
+
+    const char* timing = arg_str(argc, argv, "--timing", "barrier");
+    int known = 0;
+    for (int t = BENCH_TIMING_BARRIER; t <= BENCH_TIMING_GLOBAL; t++) {
+        if (strcmp(timing, bench_timing_names[t]) == 0) {
+            b->timing = (bench_timing)t;
+            known = 1;
+        }
+    }
+    return known && b->warmup >= 0 && (strcmp(b->format, "text") == 0 || strcmp(b->format, "csv") == 0
+                                       || strcmp(b->format, "json") == 0);
+}
+
+// Всего итераций, включая прогревочные
+static inline int bench_iterations(const bench* b) {
+    return b->warmup + b->runs;
+}
+
+static inline int bench_is_warmup(const bench* b, int iteration) {
+    return iteration < b->warmup;
+}
+
+// Регистрация серии; возвращает её номер для bench_record
+static inline int bench_series_add(bench* b, const char* name, const char* label) {
+    if (b->nseries == BENCH_MAX_SERIES)
+        return -1;
+    bench_series* s = &b->series[b->nseries];
+    s->name = name;
+    s->label = label;
+    s->samples = (double*)calloc(b->runs > 0 ? b->runs : 1, sizeof(double));
+    s->starts = (double*)calloc(b->runs > 0 ? b->runs : 1, sizeof(double));
+    s->imbalance = NULL;
+    s->count = 0;
+    s->spans = 0;
+    return b->nseries++;
+}
+
+// Запись времени итерации iteration (прогревочные отбрасываются)
+static inline void bench_record(bench* b, int series, int iteration, double seconds) {
+    if (series < 0 || bench_is_warmup(b, iteration))
+        return;
+    bench_series* s = &b->series[series];
+    int slot = iteration - b->warmup;
+    s->samples[slot] = seconds;
+    if (slot + 1 > s->count)
+        s->count = slot + 1;
+}
+
+// Запись итерации по её началу и концу (MPI_Wtime): в режиме global время итерации
+// после свёртки считается от самого раннего начала до самого позднего конца
+static inline void bench_record_span(bench* b, int series, int iteration, double start, double end) {
+    if (series < 0 || bench_is_warmup(b, iteration))
+        return;
+    bench_record(b, series, iteration, end - start);
+    b->series[series].starts[iteration - b->warmup] = start;
+    b->series[series].spans = 1;
+}
+
+// Параметр запуска для машиночитаемого вывода (размер, вариант ядра и т.п.)
+__attribute__((format(printf, 3, 4)))
+static inline void bench_param(bench* b, const char* key, const char* fmt, ...) {
+    if (b->nparams == BENCH_MAX_PARAMS)
+        return;
+    snprintf(b->param_keys[b->nparams], BENCH_PARAM_LEN, "%s", key);
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(b->param_values[b->nparams], BENCH_PARAM_LEN, fmt, ap);
+    va_end(ap);
+    b->nparams++;
+}
+
+static inline int bench_cmp_double(const void* x, const void* y) {
+    double a = *(const double*)x, c = *(const double*)y;
+    return (a > c) - (a < c);
+}
+
+// Статистика выборки values[0..n); p95 — по ближайшему рангу
+static inline bench_stats bench_sample_stats(const double* values, int n) {
+    bench_stats st = { 0, 0, 0, 0, 0, 0 };
+    if (n == 0)
+        return st;
+    double* sorted = (double*)malloc(sizeof(double) * n);
+    memcpy(sorted, values, sizeof(double) * n);
+    qsort(sorted, n, sizeof(double), bench_cmp_double);
+
+    double sum = 0.0;
+    for (int i = 0; i < n; i++)
+        sum += sorted[i];
+    st.mean = sum / n;
+    double var = 0.0;
+    for (int i = 0; i < n; i++)
+        var += (sorted[i] - st.mean) * (sorted[i] - st.mean);
+    st.stddev = n > 1 ? sqrt(var / (n - 1)) : 0.0;
+    st.min = sorted[0];
+    st.max = sorted[n - 1];
+    st.median = n % 2 ? sorted[n / 2] : 0.5 * (sorted[n / 2 - 1] + sorted[n / 2]);
+    int rank95 = (int)ceil(0.95 * n);
+    st.p95 = sorted[(rank95 > 0 ? rank95 : 1) - 1];
+    free(sorted);
+    return st;
+}
+
+static inline bench_stats bench_series_stats(const bench* b, int series) {
+    return bench_sample_stats(b->series[series].samples, b->series[series].count);
+}
+
+// Дисбаланс серии: медиана по итерациям отношения наибольшего по процессам времени
+// к среднему (1 — процессы заняты одинаково). До свёртки — 0
+static inline double bench_series_imbalance(const bench* b, int series) {
+    const bench_series* s = &b->series[series];
+    return s->imbalance ? bench_sample_stats(s->imbalance, s->count).median : 0.0;
+}
+
+#ifdef MPI_VERSION
+#define BENCH_CLOCK_ROUNDS 16
+#define BENCH_CLOCK_TAG 7301
+
+// Граница замера: барьер в режиме barrier, в режимах local и global ничего
+static inline void bench_sync(const bench* b, MPI_Comm comm) {
+    if (b->timing == BENCH_TIMING_BARRIER)
+        MPI_Barrier(comm);
+}
+
+// Подготовка режима замера, коллективная операция. В режиме global, если часы MPI не
+// общие (MPI_WTIME_IS_GLOBAL), поправка часов каждого процесса к часам процесса 0 берётся
+// по обмену с наименьшим временем оборота: середина оборота на процессе 0 минус отметка процесса
+static inline void bench_timing_setup(bench* b, MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    b->clock_offset = 0.0;
+    bench_param(b, "timing", "%s", bench_timing_names[b->timing]);
+    if (b->timing != BENCH_TIMING_GLOBAL)
+        return;
+
+    int* global = NULL;
+    int flag = 0;
+    MPI_Comm_get_attr(MPI_COMM_WORLD, MPI_WTIME_IS_GLOBAL, &global, &flag);
+    if (flag && *global)
+        return;
+
+    for (int peer = 1; peer < size; peer++) {
+        if (rank == 0) {
+            double best = 1e30, offset = 0.0;
+            for (int k = 0; k < BENCH_CLOCK_ROUNDS; k++) {
+                double t0 = MPI_Wtime(), remote;
+                MPI_Send(&t0, 1, MPI_DOUBLE, peer, BENCH_CLOCK_TAG, comm);
+                MPI_Recv(&remote, 1, MPI_DOUBLE, peer, BENCH_CLOCK_TAG, comm, MPI_STATUS_IGNORE);
+                double t1 = MPI_Wtime();
+                if (t1 - t0 < best) {
+                    best = t1 - t0;
+                    offset = 0.5 * (t0 + t1) - remote;
+                }
+            }
+            MPI_Send(&offset, 1, MPI_DOUBLE, peer, BENCH_CLOCK_TAG, comm);
+        } else if (rank == peer) {
+            for (int k = 0; k < BENCH_CLOCK_ROUNDS; k++) {
+                double t0;
+                MPI_Recv(&t0, 1, MPI_DOUBLE, 0, BENCH_CLOCK_TAG, comm, MPI_STATUS_IGNORE);
+                double now = MPI_Wtime();
+                MPI_Send(&now, 1, MPI_DOUBLE, 0, BENCH_CLOCK_TAG, comm);
+            }
+            MPI_Recv(&b->clock_offset, 1, MPI_DOUBLE, 0, BENCH_CLOCK_TAG, comm, MPI_STATUS_IGNORE);
+        }
+    }
+}
+
+// Свёртка по процессам, коллективная операция. Время итерации заменяется максимумом
+// по процессам (итерация заканчивается, когда закончил самый медленный процесс), в режиме
+// global для серий с началами — отрезком от самого раннего начала до самого позднего конца
+// по выровненным часам. На root сохраняется и дисбаланс каждой итерации. Все серии
+// сворачиваются двумя векторными свёртками (coll_reduce): максимумов — времена, начала
+// со знаком минус (минимум начала — это максимум с обратным знаком) и концы, и сумм — времена
+static inline void bench_reduce_max(bench* b, int root, coll* c) {
+    int rank;
+    MPI_Comm_rank(c->comm, &rank);
+    MPI_Comm_size(c->comm, &b->nproc);
+    int n = b->runs > 0 ? b->runs : 1;
+    if (b->nseries <= 0) {  // сворачивать нечего (число серий одинаково на всех процессах)
+        b->reduced = 1;
+        return;
+    }
+    int spans = 0;
+    for (int i = 0; i < b->nseries; i++)
+        spans += b->timing == BENCH_TIMING_GLOBAL && b->series[i].spans;
+
+    // Вектор максимумов: [времена всех серий | для серий с началами: -начала, концы]
+    size_t nmost = (size_t)n * (b->nseries + 2 * spans), ntotal = (size_t)n * b->nseries;
+    double* most = (double*)calloc(nmost, sizeof(double));
+    double* total = (double*)calloc(ntotal, sizeof(double));
+    for (int i = 0, k = 0; i < b->nseries; i++) {
+        bench_series* s = &b->series[i];
+        memcpy(most + i * n, s->samples, sizeof(double) * b->runs);
+        memcpy(total + i * n, s->samples, sizeof(double) * b->runs);
+        if (b->timing != BENCH_TIMING_GLOBAL || !s->spans)
+            continue;
+        double* first = most + n * (b->nseries + 2 * k);
+        double* last = first + n;
+        for (int r = 0; r < b->runs; r++) {
+            first[r] = -(s->starts[r] + b->clock_offset);
+            last[r] = s->starts[r] + b->clock_offset + s->samples[r];
+        }
+        k++;
+    }
+    coll_reduce(c, rank == root ? MPI_IN_PLACE : most, most, (int)nmost, MPI_DOUBLE, MPI_MAX, root);
+    coll_reduce(c, rank == root ? MPI_IN_PLACE : total, total, (int)ntotal, MPI_DOUBLE, MPI_SUM, root);
+
+    for (int i = 0, k = 0; rank == root && i < b->nseries; i++) {
+        bench_series* s = &b->series[i];
+        int span = b->timing == BENCH_TIMING_GLOBAL && s->spans;
+        const double* first = most + n * (b->nseries + 2 * k);
+        const double* last = first + n;
+        k += span;
+        s->imbalance = (double*)malloc(sizeof(double) * n);
+        for (int r = 0; r < b->runs; r++) {
+            double avg = total[i * n + r] / b->nproc;
+            s->imbalance[r] = avg > 0.0 ? most[i * n + r] / avg : 1.0;
+            s->samples[r] = span ? last[r] + first[r] : most[i * n + r];
+        }
+    }
+    free(most);
+    free(total);
+    b->reduced = 1;
+}
+#endif
+
+// Число символов UTF-8 строки (printf выравнивает по байтам, а кириллица занимает два байта на букву)
+static inline int bench_text_width(const char* text) {
+    int width = 0;
+    for (const unsigned char* c = (const unsigned char*)text; *c; c++)
+        width += (*c & 0xC0) != 0x80;
+    return width;
+}
+
+// Ячейка таблицы шириной width: right — выравнивание по правому краю
+static inline void bench_print_cell(const char* text, int width, int right) {
+    int pad = width - bench_text_width(text);
+    if (right) printf("%*s%s", pad > 0 ? pad : 0, "", text);
+    else printf("%s%*s", text, pad > 0 ? pad : 0, "");
+}
+
+// Таблица в stdout
+static inline void bench_print_table(const bench* b) {
+    static const char* columns[] = { "мин", "медиана", "p95", "макс", "среднее", "ст.откл.", "дисбаланс" };
+    const char* across = "";
+    if (b->reduced)
+        across = b->timing == BENCH_TIMING_GLOBAL ? ", от первого начала до последнего конца по процессам"
+                                                  : ", максимум по процессам";
+    printf("Время, с (запусков: %d, прогревочных: %d%s%s):\n", b->runs, b->warmup, across,
+           b->reduced && b->timing != BENCH_TIMING_BARRIER ? ", без барьеров" : "");
+    bench_print_cell("", 24, 0);
+    for (int c = 0; c < (b->reduced ? 7 : 6); c++)
+        bench_print_cell(columns[c], 12, 1);
+    printf("\n");
+    for (int i = 0; i < b->nseries; i++) {
+        bench_stats st = bench_series_stats(b, i);
+        bench_print_cell(b->series[i].label, 24, 0);
+        printf(" %11.6f %11.6f %11.6f %11.6f %11.6f %11.6f",
+               st.min, st.median, st.p95, st.max, st.mean, st.stddev);
+        if (b->reduced)
+            printf(" %11.2f", bench_series_imbalance(b, i));
+        printf("\n");
+    }
+}
+
+// CSV: одна строка на серию; параметры запуска собраны в поле params как ключ=значение через ';'
+static inline void bench_write_csv(const bench* b, FILE* f, int header) {
+    if (header)
+        fprintf(f, "program,series,nproc,threads,size,params,runs,warmup,min,median,p95,max,mean,stddev,imbalance\n");
+    for (int i = 0; i < b->nseries; i++) {
+        bench_stats st = bench_series_stats(b, i);
+        fprintf(f, "%s,%s,%d,%d,%lld,", b->program, b->series[i].name, b->nproc, b->threads, b->size);
+        for (int p = 0; p < b->nparams; p++)
+            fprintf(f, "%s%s=%s", p ? ";" : "", b->param_keys[p], b->param_values[p]);
+        fprintf(f, ",%d,%d,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.4g\n", b->runs, b->warmup,
+                st.min, st.median, st.p95, st.max, st.mean, st.stddev, bench_series_imbalance(b, i));
+    }
+}
+
+// JSON: один объект на запуск программы в одной строке (формат JSON Lines)
+static inline void bench_write_json(const bench* b, FILE* f) {
+    fprintf(f, "{\"program\":\"%s\",\"nproc\":%d,\"threads\":%d,\"size\":%lld,\"runs\":%d,\"warmup\":%d,\"params\":{",
+            b->program, b->nproc, b->threads, b->size, b->runs, b->warmup);
+    for (int p = 0; p < b->nparams; p++)
+        fprintf(f, "%s\"%s\":\"%s\"", p ? "," : "", b->param_keys[p], b->param_values[p]);
+    fprintf(f, "},\"series\":{");
+    for (int i = 0; i < b->nseries; i++) {
+        bench_stats st = bench_series_stats(b, i);
+        fprintf(f, "%s\"%s\":{\"min\":%.9g,\"median\":%.9g,\"p95\":%.9g,\"max\":%.9g,\"mean\":%.9g,\"stddev\":%.9g,"
+                "\"imbalance\":%.4g}", i ? "," : "", b->series[i].name, st.min, st.median, st.p95, st.max, st.mean,
+                st.stddev, bench_series_imbalance(b, i));
+    }
+    fprintf(f, "}}\n");
+}
+
+// Итоговая таблица
+static inline void bench_report(const bench* b) {
+    bench_print_table(b);
+}
+
+// Машиночитаемая запись по --format=csv|json (для text ничего не делает).
+// В --out строки дописываются, заголовок CSV пишется только в пустой файл
+static inline void bench_write(const bench* b) {
+    if (strcmp(b->format, "text") == 0)
+        return;
+
+    FILE* f = stdout;
+    int header = 1;
+    if (b->out_path) {
+        f = fopen(b->out_path, "a");
+        if (!f) {
+            printf("Ошибка: не удалось открыть файл '%s' для записи результатов.\n", b->out_path);
+            return;
+        }
+        header = ftell(f) == 0;
+    }
+    if (strcmp(b->format, "csv") == 0)
+        bench_write_csv(b, f, header);
+    else
+        bench_write_json(b, f);
+    if (f != stdout)
+        fclose(f);
+}
+
+static inline void bench_free(bench* b) {
+    for (int i = 0; i < b->nseries; i++) {
+        free(b->series[i].samples);
+        free(b->series[i].starts);
+        free(b->series[i].imbalance);
+    }
+    b->nseries = 0;
+}
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef COMMON_COLL_H
+#define COMMON_COLL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+#include "args.h"
+#include "shm.h"
+
+// Двухуровневые коллективные операции (--coll=flat|hier). flat — обычный MPI_Reduce на comm.
+// hier — свёртка сначала внутри узла через общую память, затем между узлами: каждый процесс
+// кладёт свой вектор в свой сегмент общего окна узла (common/shm.h), старший процесс узла
+// сворачивает сегменты на месте (MPI_Reduce_local, в порядке номеров процессов, поэтому
+// годятся и пользовательские операции), и только старшие процессы узлов, по одному на узел,
+// выполняют MPI_Reduce между собой. Сегмент разделён на две половины, которые чередуются
+// от вызова к вызову: запись в половину возможна не раньше, чем старший процесс дочитал
+// её в позапрошлом вызове, так что хватает одного барьера узла на вызов.
+
+#define COLL_TAG 7311
+
+typedef enum { COLL_FLAT, COLL_HIER } coll_mode;
+
+static const char* const coll_mode_names[] = { "flat", "hier" };
+
+typedef struct {
+    coll_mode mode;
+    MPI_Comm comm;
+    shm_node node;        // только в режиме hier
+    shm_window scratch;   // сегменты свёртки внутри узла
+    size_t scratch_half;  // байт в половине сегмента, 0 — окно ещё не выделено
+    int calls;            // номер вызова: выбирает половину сегмента
+} coll;
+
+// Разбор --coll=flat|hier (по умолчанию flat); -1 при ошибке
+static inline int coll_mode_arg(int argc, char* argv[]) {
+    const char* mode = arg_str(argc, argv, "--coll", "flat");
+    for (int m = COLL_FLAT; m <= COLL_HIER; m++)
+        if (strcmp(mode, coll_mode_names[m]) == 0)
+            return m;
+    return -1;
+}
+
+// Коллективная операция на comm
+static inline void coll_setup(coll* c, MPI_Comm comm, coll_mode mode) {
+    memset(c, 0, sizeof(*c));
+    c->mode = mode;
+    c->comm = comm;
+    if (mode == COLL_HIER)
+        shm_setup(&c->node, comm);
+}
+
+static inline void coll_free(coll* c) {
+    if (c->mode != COLL_HIER)
+        return;
+    if (c->scratch_half)
+        shm_window_free(&c->scratch);
+    shm_free(&c->node);
+}
+
+// То же, что MPI_Reduce(send, recv, count, type, op, root, comm); send может быть MPI_IN_PLACE
+// на root. Тип — непрерывные элементы без смещения нижней границы. Коллективная операция
+static inline void coll_reduce(coll* c, const void* send, void* recv, int count, MPI_Datatype type, MPI_Op op,
+                               int root) {
+    if (c->mode == COLL_FLAT) {
+        MPI_Reduce(send, recv, count, type, op, root, c->comm);
+        return;
+    }
+    int rank;
+    MPI_Comm_rank(c->comm, &rank);
+    const shm_node* s = &c->node;
+    if (send == MPI_IN_PLACE)
+        send = recv;
+    MPI_Aint lb, extent;
+    MPI_Type_get_extent(type, &lb, &extent);
+    size_t bytes = (size_t)extent * count;
+
+    // Окно растёт по мере надобности; count одинаков на всех процессах узла
+    if (bytes > c->scratch_half) {
+        if (c->scratch_half)
+            shm_window_free(&c->scratch);
+        if (!shm_window_alloc(&c->scratch, s, 2 * bytes)) {
+            printf("Ошибка: не удалось выделить окно общей памяти для свёртки.\n");
+            MPI_Abort(c->comm, 1);
+        }
+        c->scratch_half = bytes;
+    }
+    size_t half = c->scratch_half * (size_t)(c->calls++ & 1);
+
+    // Внутри узла: свой вектор — в свой сегмент, старший процесс сворачивает сегменты
+    memcpy((char*)c->scratch.base + half, send, bytes);
+    MPI_Win_sync(c->scratch.win);
+    MPI_Barrier(s->node);
+    MPI_Win_sync(c->scratch.win);
+
+    if (s->leaders != MPI_COMM_NULL) {
+        void* acc = rank == root ? recv : malloc(bytes > 0 ? bytes : 1);
+        MPI_Aint seg;
+        int disp;
+        void* part;
+        MPI_Win_shared_query(c->scratch.win, s->node_size - 1, &seg, &disp, &part);
+        memcpy(acc, (char*)part + half, bytes);
+        for (int i = s->node_size - 2; i >= 0; i--) {
+            MPI_Win_shared_query(c->scratch.win, i, &seg, &disp, &part);
+            MPI_Reduce_local((char*)part + half, acc, count, type, op);
+        }
+
+        // Между узлами: старшие процессы сворачивают к процессу 0 (он всегда старший на своём узле)
+        int leader;
+        MPI_Comm_rank(s->leaders, &leader);
+        if (s->nodes > 1)
+            MPI_Reduce(leader == 0 ? MPI_IN_PLACE : acc, acc, count, type, op, 0, s->leaders);
+        if (rank == 0 && root != 0)
+            MPI_Send(acc, count, type, root, COLL_TAG, c->comm);
+        if (acc != recv)
+            free(acc);
+    }
+    // Если root — не процесс 0, итог приходит к нему от процесса 0
+    if (rank == root && root != 0)
+        MPI_Recv(recv, count, type, 0, COLL_TAG, c->comm, MPI_STATUS_IGNORE);
+}
+
+#endif
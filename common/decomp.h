@@ -0,0 +1,121 @@
+#ifndef COMMON_DECOMP_H
+#define COMMON_DECOMP_H
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+// Блочное разбиение n элементов между nproc процессами: остаток n % nproc
+// достаётся первым процессам по одному элементу, поэтому размеры блоков
+// отличаются не больше чем на 1 при любом числе процессов.
+
+#define DECOMP_CHUNK (1LL << 30)  // наибольшая порция одной пересылки точка-точка
+
+static inline long long block_count(long long n, int nproc, int rank) {
+    return n / nproc + (rank < n % nproc ? 1 : 0);
+}
+
+static inline long long block_start(long long n, int nproc, int rank) {
+    long long rem = n % nproc;
+    return (n / nproc) * rank + (rank < rem ? rank : rem);
+}
+
+// Длина наибольшего блока передаётся в MPI как int
+static inline int decomp_fits(long long n, int nproc) {
+    return block_count(n, nproc, 0) <= INT_MAX;
+}
+
+// Заполнение массивов счётчиков и смещений для MPI_Scatterv/MPI_Gatherv.
+// Возвращает 0, если смещения не помещаются в int
+static inline int decomp_counts(long long n, int nproc, int* counts, int* displs) {
+    if (n > INT_MAX)
+        return 0;
+    for (int r = 0; r < nproc; r++) {
+        counts[r] = (int)block_count(n, nproc, r);
+        displs[r] = (int)block_start(n, nproc, r);
+    }
+    return 1;
+}
+
+// Раздача блоков массива root_buf (только у root) по процессам.
+// Пока массив адресуется смещениями int, используется MPI_Scatterv;
+// для больших массивов root пересылает блоки порциями по DECOMP_CHUNK элементов.
+static inline void scatterv_blocks(const void* root_buf, long long n, MPI_Datatype type,
+                                   void* local_buf, int root, MPI_Comm comm) {
+    int rank, nproc, type_size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nproc);
+    MPI_Type_size(type, &type_size);
+
+    int* counts = (int*)malloc(sizeof(int) * nproc);
+    int* displs = (int*)malloc(sizeof(int) * nproc);
+    if (decomp_counts(n, nproc, counts, displs)) {
+        MPI_Scatterv(root_buf, counts, displs, type,
+                     local_buf, counts[rank], type, root, comm);
+        free(counts); free(displs);
+        return;
+    }
+    free(counts); free(displs);
+
+    long long my_count = block_count(n, nproc, rank);
+    if (rank == root) {
+        for (int r = 0; r < nproc; r++) {
+            const char* src = (const char*)root_buf + block_start(n, nproc, r) * type_size;
+            long long count = block_count(n, nproc, r);
+            for (long long off = 0; off < count; off += DECOMP_CHUNK) {
+                int part = (int)(count - off < DECOMP_CHUNK ? count - off : DECOMP_CHUNK);
+                if (r == root)
+                    memcpy((char*)local_buf + off * type_size, src + off * type_size, (size_t)part * type_size);
+                else
+                    MPI_Send(src + off * type_size, part, type, r, 0, comm);
+            }
+        }
+    } else {
+        for (long long off = 0; off < my_count; off += DECOMP_CHUNK) {
+            int part = (int)(my_count - off < DECOMP_CHUNK ? my_count - off : DECOMP_CHUNK);
+            MPI_Recv((char*)local_buf + off * type_size, part, type, root, 0, comm, MPI_STATUS_IGNORE);
+        }
+    }
+}
+
+// Сбор блоков в root_buf (только у root): обратная операция к scatterv_blocks
+static inline void gatherv_blocks(const void* local_buf, long long n, MPI_Datatype type,
+                                  void* root_buf, int root, MPI_Comm comm) {
+    int rank, nproc, type_size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nproc);
+    MPI_Type_size(type, &type_size);
+
+    int* counts = (int*)malloc(sizeof(int) * nproc);
+    int* displs = (int*)malloc(sizeof(int) * nproc);
+    if (decomp_counts(n, nproc, counts, displs)) {
+        MPI_Gatherv(local_buf, counts[rank], type,
+                    root_buf, counts, displs, type, root, comm);
+        free(counts); free(displs);
+        return;
+    }
+    free(counts); free(displs);
+
+    long long my_count = block_count(n, nproc, rank);
+    if (rank == root) {
+        for (int r = 0; r < nproc; r++) {
+            char* dst = (char*)root_buf + block_start(n, nproc, r) * type_size;
+            long long count = block_count(n, nproc, r);
+            for (long long off = 0; off < count; off += DECOMP_CHUNK) {
+                int part = (int)(count - off < DECOMP_CHUNK ? count - off : DECOMP_CHUNK);
+                if (r == root)
+                    memcpy(dst + off * type_size, (const char*)local_buf + off * type_size, (size_t)part * type_size);
+                else
+                    MPI_Recv(dst + off * type_size, part, type, r, 0, comm, MPI_STATUS_IGNORE);
+            }
+        }
+    } else {
+        for (long long off = 0; off < my_count; off += DECOMP_CHUNK) {
+            int part = (int)(my_count - off < DECOMP_CHUNK ? my_count - off : DECOMP_CHUNK);
+            MPI_Send((const char*)local_buf + off * type_size, part, type, root, 0, comm);
+        }
+    }
+}
+
+#endif
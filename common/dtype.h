@@ -0,0 +1,61 @@
+#ifndef COMMON_DTYPE_H
+#define COMMON_DTYPE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "rng.h"
+
+// Тип элементов данных, выбираемый при запуске параметром --dtype.
+// Ядра, зависящие от типа, пишутся один раз макросом и порождаются для каждого типа
+// списком DTYPE_FOREACH; код задач работает с void* и размером элемента и берёт
+// нужный экземпляр ядра из таблицы по dtype. Параллельные программы (mpi.h подключён
+// раньше этого заголовка) получают и соответствующий тип MPI.
+
+typedef enum { DTYPE_I32, DTYPE_I64, DTYPE_F32, DTYPE_F64, DTYPE_COUNT } dtype;
+
+// X(суффикс, тип C) для каждого типа в порядке dtype
+#define DTYPE_FOREACH(X) X(i32, int) X(i64, int64_t) X(f32, float) X(f64, double)
+
+static const char* const dtype_names[DTYPE_COUNT] = { "int", "int64", "float", "double" };
+
+// Разбор имени типа; возвращает 0, если имя неизвестно
+static inline int dtype_parse(const char* name, dtype* out) {
+    for (int t = 0; t < DTYPE_COUNT; t++) {
+        if (strcmp(name, dtype_names[t]) == 0) {
+            *out = (dtype)t;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static inline size_t dtype_size(dtype t) {
+    return t == DTYPE_I32 || t == DTYPE_F32 ? 4 : 8;
+}
+
+static inline int dtype_is_int(dtype t) {
+    return t == DTYPE_I32 || t == DTYPE_I64;
+}
+
+#ifdef MPI_VERSION
+static inline MPI_Datatype dtype_mpi(dtype t) {
+    static const MPI_Datatype types[DTYPE_COUNT] = { MPI_INT, MPI_INT64_T, MPI_FLOAT, MPI_DOUBLE };
+    return types[t];
+}
+#endif
+
+// Заполнение out[0..count) значениями элементов first..first+count-1 из [lo, lo + span):
+// целые типы получают одни и те же целые числа (int64 — те же, что int),
+// вещественные — равномерно распределённые вещественные
+static inline void dtype_fill(void* out, dtype t, long long count, long long first,
+                              uint64_t seed, uint32_t stream, int lo, uint32_t span) {
+    switch (t) {
+    case DTYPE_I32: rng_fill_int((int*)out, count, first, seed, stream, lo, span); break;
+    case DTYPE_I64: rng_fill_i64((int64_t*)out, count, first, seed, stream, lo, span); break;
+    case DTYPE_F32: rng_fill_float((float*)out, count, first, seed, stream, (float)lo, (float)span); break;
+    default: rng_fill_double((double*)out, count, first, seed, stream, lo, span); break;
+    }
+}
+
+#endif
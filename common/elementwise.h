@@ -0,0 +1,228 @@
+#ifndef COMMON_ELEMENTWISE_H
+#define COMMON_ELEMENTWISE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "dtype.h"
+
+#if defined(__SSE2__) && defined(__x86_64__)
+#include <emmintrin.h>
+#define EW_HAVE_STREAM 1
+#else
+#define EW_HAVE_STREAM 0
+#endif
+
+// Поэлементные операции над двумя массивами (задачи 3 и 4) для элементов любого типа
+// из dtype.h: сумма, разность и произведение — в типе операндов, частное — в double.
+// Раздельные ядра делают по проходу на операцию; совмещённое ядро читает
+// a[i], b[i] один раз и записывает все четыре результата за один проход.
+// Ядра пишутся один раз макросом EW_DEFINE и порождаются для каждого типа;
+// ew_scalar[dtype] — их таблица, векторные варианты собраны в simd.h.
+
+// Параллельный цикл внутри макросов ядер; без -fopenmp (последовательные программы) — обычный цикл
+#ifdef _OPENMP
+#define EW_OMP_FOR(clauses) _Pragma("omp parallel for " clauses)
+#else
+#define EW_OMP_FOR(clauses)
+#endif
+
+// Объём памяти на элемент при размере элемента операндов elem: чтение a и b плюс запись результата
+#define EW_BYTES_SEPARATE(elem) (4 * 2 * (elem) + 3 * (elem) + sizeof(double))
+#define EW_BYTES_FUSED(elem) (2 * (elem) + 3 * (elem) + sizeof(double))
+
+// Операнды и результаты: блок процесса или полные массивы на процессе 0
+typedef struct {
+    dtype type;  // тип a, b, sum, diff, prod
+    void *a, *b, *sum, *diff, *prod;
+    double *quot;
+} ew_arrays;
+
+// Те же массивы, сдвинутые на from элементов (отрезок или порция блока); NULL остаются NULL
+static inline ew_arrays ew_slice(const ew_arrays* l, long long from) {
+    size_t shift = (size_t)from * dtype_size(l->type);
+#define EW_SHIFT(p) ((p) ? (void*)((char*)(p) + shift) : NULL)
+    ew_arrays r = { l->type, EW_SHIFT(l->a), EW_SHIFT(l->b), EW_SHIFT(l->sum), EW_SHIFT(l->diff),
+                    EW_SHIFT(l->prod), l->quot ? l->quot + from : NULL };
+#undef EW_SHIFT
+    return r;
+}
+
+typedef void (*ew_binary_fn)(const void* restrict, const void* restrict, void* restrict, long long);
+typedef void (*ew_div_fn)(const void* restrict, const void* restrict, double* restrict, long long);
+typedef void (*ew_fused_fn)(const void* restrict, const void* restrict, void* restrict, void* restrict,
+                            void* restrict, double* restrict, long long);
+
+// Ядра одного типа элементов; fused_nt — совмещённое с некэширующими (потоковыми) записями:
+// результаты не читаются повторно, поэтому их запись в обход кэша экономит чтение строк при записи
+typedef struct {
+    ew_binary_fn add, sub, mul;
+    ew_div_fn div;
+    ew_fused_fn fused, fused_nt;
+} ew_kernels;
+
+// Потоковая запись значения размером 4 или 8 байт (MOVNTI) независимо от его типа
+#if EW_HAVE_STREAM
+static inline void ew_stream(void* dst, const void* value, size_t size) {
+    if (size == 4) {
+        int bits;
+        memcpy(&bits, value, 4);
+        _mm_stream_si32((int*)dst, bits);
+    } else {
+        long long bits;
+        memcpy(&bits, value, 8);
+        _mm_stream_si64((long long*)dst, bits);
+    }
+}
+#endif
+
+#define EW_DEFINE(sfx, T)                                                                            \
+static inline void ew_add_##sfx(const void* restrict va, const void* restrict vb, void* restrict vc, \
+                                long long n) {                                                       \
+    const T* restrict a = (const T*)va;                                                              \
+    const T* restrict b = (const T*)vb;                                                              \
+    T* restrict c = (T*)vc;                                                                          \
+    for (long long i = 0; i < n; i++) c[i] = a[i] + b[i];                                            \
+}                                                                                                    \
+                                                                                                     \
+static inline void ew_sub_##sfx(const void* restrict va, const void* restrict vb, void* restrict vc, \
+                                long long n) {                                                       \
+    const T* restrict a = (const T*)va;                                                              \
+    const T* restrict b = (const T*)vb;                                                              \
+    T* restrict c = (T*)vc;                                                                          \
+    for (long long i = 0; i < n; i++) c[i] = a[i] - b[i];                                            \
+}                                                                                                    \
+                                                                                                     \
+static inline void ew_mul_##sfx(const void* restrict va, const void* restrict vb, void* restrict vc, \
+                                long long n) {                                                       \
+    const T* restrict a = (const T*)va;                                                              \
+    const T* restrict b = (const T*)vb;                                                              \
+    T* restrict c = (T*)vc;                                                                          \
+    for (long long i = 0; i < n; i++) c[i] = a[i] * b[i];                                            \
+}                                                                                                    \
+                                                                                                     \
+static inline void ew_div_##sfx(const void* restrict va, const void* restrict vb,                    \
+                                double* restrict quot, long long n) {                                \
+    const T* restrict a = (const T*)va;                                                              \
+    const T* restrict b = (const T*)vb;                                                              \
+    for (long long i = 0; i < n; i++) quot[i] = b[i] != 0 ? (double)a[i] / (double)b[i] : 0.0;       \
+}                                                                                                    \
+                                                                                                     \
+/* Совмещённое ядро: все четыре операции за один проход */                                          \
+static inline void ew_fused_##sfx(const void* restrict va, const void* restrict vb,                  \
+                                  void* restrict vsum, void* restrict vdiff, void* restrict vprod,   \
+                                  double* restrict quot, long long n) {                              \
+    const T* restrict a = (const T*)va;                                                              \
+    const T* restrict b = (const T*)vb;                                                              \
+    T* restrict sum = (T*)vsum;                                                                      \
+    T* restrict diff = (T*)vdiff;                                                                    \
+    T* restrict prod = (T*)vprod;                                                                    \
+    for (long long i = 0; i < n; i++) {                                                              \
+        T x = a[i], y = b[i];                                                                        \
+        sum[i] = x + y;                                                                              \
+        diff[i] = x - y;                                                                             \
+        prod[i] = x * y;                                                                             \
+        quot[i] = y != 0 ? (double)x / (double)y : 0.0;                                              \
+    }                                                                                                \
+}                                                                                                    \
+                                                                                                     \
+static inline void ew_fused_nt_##sfx(const void* restrict va, const void* restrict vb,               \
+                                     void* restrict vsum, void* restrict vdiff, void* restrict vprod,\
+                                     double* restrict quot, long long n) {                           \
+    EW_FUSED_NT_BODY(sfx, T)                                                                         \
+}                                                                                                    \
+                                                                                                     \
+/* Число элементов, результаты которых расходятся с эталонным скалярным ядром (побитово) */          \
+static inline long long ew_mismatches_##sfx(const ew_arrays* l, long long n) {                       \
+    const T* a = (const T*)l->a;                                                                     \
+    const T* b = (const T*)l->b;                                                                     \
+    const T* sum = (const T*)l->sum;                                                                 \
+    const T* diff = (const T*)l->diff;                                                               \
+    const T* prod = (const T*)l->prod;                                                               \
+    long long bad = 0;                                                                               \
+    EW_OMP_FOR("reduction(+:bad)")                                                                   \
+    for (long long i = 0; i < n; i++) {                                                              \
+        T x = a[i], y = b[i];                                                                        \
+        T s = x + y, d = x - y, p = x * y;                                                           \
+        double q = y != 0 ? (double)x / (double)y : 0.0;                                             \
+        bad += memcmp(&sum[i], &s, sizeof(T)) != 0 || memcmp(&diff[i], &d, sizeof(T)) != 0           \
+             || memcmp(&prod[i], &p, sizeof(T)) != 0 || memcmp(&l->quot[i], &q, sizeof(q)) != 0;     \
+    }                                                                                                \
+    return bad;                                                                                      \
+}
+
+#if EW_HAVE_STREAM
+#define EW_FUSED_NT_BODY(sfx, T)                                                                     \
+    const T* restrict a = (const T*)va;                                                              \
+    const T* restrict b = (const T*)vb;                                                              \
+    T* restrict sum = (T*)vsum;                                                                      \
+    T* restrict diff = (T*)vdiff;                                                                    \
+    T* restrict prod = (T*)vprod;                                                                    \
+    for (long long i = 0; i < n; i++) {                                                              \
+        T x = a[i], y = b[i];                                                                        \
+        T s = x + y, d = x - y, p = x * y;                                                           \
+        double q = y != 0 ? (double)x / (double)y : 0.0;                                             \
+        ew_stream(sum + i, &s, sizeof(T));                                                           \
+        ew_stream(diff + i, &d, sizeof(T));                                                          \
+        ew_stream(prod + i, &p, sizeof(T));                                                          \
+        ew_stream(quot + i, &q, sizeof(q));                                                          \
+    }                                                                                                \
+    _mm_sfence();
+#else
+#define EW_FUSED_NT_BODY(sfx, T) ew_fused_##sfx(va, vb, vsum, vdiff, vprod, quot, n);
+#endif
+
+DTYPE_FOREACH(EW_DEFINE)
+
+#define EW_TABLE_ENTRY(sfx, T) \
+    { ew_add_##sfx, ew_sub_##sfx, ew_mul_##sfx, ew_div_##sfx, ew_fused_##sfx, ew_fused_nt_##sfx },
+
+static const ew_kernels ew_scalar[DTYPE_COUNT] = { DTYPE_FOREACH(EW_TABLE_ENTRY) };
+
+// Число элементов блока l, результаты которых расходятся с эталонным скалярным ядром
+static inline long long ew_mismatches(const ew_arrays* l, long long n) {
+#define EW_MISMATCHES_ENTRY(sfx, T) ew_mismatches_##sfx,
+    static long long (*const fns[DTYPE_COUNT])(const ew_arrays*, long long) = { DTYPE_FOREACH(EW_MISMATCHES_ENTRY) };
+#undef EW_MISMATCHES_ENTRY
+    return fns[l->type](l, n);
+}
+
+// Контрольная сумма результатов: сумма по модулю 2^64 хешей (глобальный индекс, значения),
+// поэтому она не зависит от разбиения на блоки и порядка сложения частичных сумм,
+// но меняется при перестановке элементов. first — глобальный индекс элемента 0 блока r
+static inline uint64_t ew_mix(uint64_t x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Биты элемента i массива из элементов размера 4 или 8 байт
+static inline uint64_t ew_bits(const void* p, size_t elem, long long i) {
+    if (elem == 4) {
+        uint32_t v;
+        memcpy(&v, (const char*)p + i * 4, 4);
+        return v;
+    }
+    uint64_t v;
+    memcpy(&v, (const char*)p + i * 8, 8);
+    return v;
+}
+
+static inline uint64_t ew_checksum(const ew_arrays* r, long long n, long long first) {
+    size_t elem = dtype_size(r->type);
+    uint64_t total = 0;
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:total)
+#endif
+    for (long long i = 0; i < n; i++) {
+        uint64_t q;
+        memcpy(&q, r->quot + i, sizeof(q));
+        uint64_t d = ew_bits(r->diff, elem, i), p = ew_bits(r->prod, elem, i);
+        uint64_t h = ew_mix((uint64_t)(first + i) * 0x9e3779b97f4a7c15ULL ^ ew_bits(r->sum, elem, i));
+        h = elem == 4 ? ew_mix(h ^ (d << 32 | p)) : ew_mix(ew_mix(h ^ d) ^ p);
+        total += ew_mix(h ^ q);
+    }
+    return total;
+}
+
+#endif
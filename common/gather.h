@@ -0,0 +1,161 @@
+#ifndef COMMON_GATHER_H
+#define COMMON_GATHER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <mpi.h>
+
+#include "decomp.h"
+#include "elementwise.h"
+#include "grid.h"
+#include "io.h"
+#include "simd.h"
+
+// Сбор и проверка результатов поэлементных операций (задачи 3 и 4).
+// l — блок процесса из local_size элементов, g — полные массивы из n элементов
+// (только у root; операнды g->a, g->b нужны только при раздаче).
+
+// Полный путь данных без перекрытия: раздача a и b (если scatter), ядро, сбор четырёх результатов
+static inline void ew_roundtrip(const simd_kernels* k, int fused, int use_nt, int scatter, long long n,
+                                const ew_arrays* g, const ew_arrays* l, long long local_size,
+                                int root, MPI_Comm comm) {
+    MPI_Datatype type = dtype_mpi(l->type);
+    if (scatter) {
+        scatterv_blocks(g->a, n, type, l->a, root, comm);
+        scatterv_blocks(g->b, n, type, l->b, root, comm);
+    }
+    simd_run_all(k, fused, use_nt, l, 0, local_size);
+    gatherv_blocks(l->sum, n, type, g->sum, root, comm);
+    gatherv_blocks(l->diff, n, type, g->diff, root, comm);
+    gatherv_blocks(l->prod, n, type, g->prod, root, comm);
+    gatherv_blocks(l->quot, n, MPI_DOUBLE, g->quot, root, comm);
+}
+
+// Итог проверки: расхождения процессов с эталонным ядром (bad) и контрольные суммы их блоков
+// (sum) складываются на root. Если g не NULL, root сверяет с ней контрольную сумму собранных
+// массивов. Печатает итог на root; возвращает 1, если расхождений нет (на root)
+static inline int ew_verify_totals(long long bad, uint64_t sum, const ew_arrays* g, long long n,
+                                   int root, MPI_Comm comm) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    // Обе суммы — одной свёрткой (расхождения неотрицательны, контрольная сумма — по модулю 2^64)
+    uint64_t mine[2] = { (uint64_t)bad, sum }, totals[2] = { 0, 0 };
+    MPI_Reduce(mine, totals, 2, MPI_UINT64_T, MPI_SUM, root, comm);
+    if (rank != root)
+        return 1;
+    long long total_bad = (long long)totals[0];
+    uint64_t total = totals[1];
+
+    int ok = total_bad == 0;
+    printf("Проверка: расхождений с эталонным ядром: %lld, контрольная сумма: %016llx\n",
+           total_bad, (unsigned long long)total);
+    if (g) {
+        uint64_t gathered = ew_checksum(g, n, 0);
+        printf("Собранные результаты: %s\n", gathered == total ? "совпадают" : "НЕ совпадают");
+        ok = ok && gathered == total;
+    }
+    return ok;
+}
+
+// Проверка: каждый процесс сверяет свой блок с эталонным скалярным ядром; sum — контрольная
+// сумма блока процесса
+static inline int ew_verify_sum(const ew_arrays* l, long long local_size, uint64_t sum,
+                                const ew_arrays* g, long long n, int root, MPI_Comm comm) {
+    return ew_verify_totals(ew_mismatches(l, local_size), sum, g, n, root, comm);
+}
+
+// Проверка при блочном разбиении: блок процесса начинается с элемента local_first
+static inline int ew_verify(const ew_arrays* l, long long local_size, long long local_first,
+                            const ew_arrays* g, long long n, int root, MPI_Comm comm) {
+    uint64_t sum = ew_checksum(l, local_size, local_first);
+    return ew_verify_sum(l, local_size, sum, g, n, root, comm);
+}
+
+// Контрольная сумма плитки двумерного разбиения: складываются суммы её непрерывных
+// в полной матрице отрезков, поэтому она совпадает с суммой того же блока при любом разбиении
+static inline uint64_t ew_grid_checksum(const grid2d* grid, const ew_arrays* l) {
+    uint64_t sum = 0;
+    for (long long li = 0; li < grid->local_rows; li++) {
+        long long len, global;
+        for (long long lj = 0; lj < grid->local_cols; lj += len) {
+            long long at = li * grid->local_cols + lj;
+            len = grid_run(grid, li, lj, &global);
+            ew_arrays run = ew_slice(l, at);
+            sum += ew_checksum(&run, len, global);
+        }
+    }
+    return sum;
+}
+
+// Полный путь данных при двумерном разбиении: раздача плиток a и b (если scatter), ядро, сбор
+static inline void ew_grid_roundtrip(const simd_kernels* k, int fused, int use_nt, int scatter,
+                                     const grid2d* grid, const ew_arrays* g, const ew_arrays* l, int root) {
+    MPI_Datatype type = dtype_mpi(l->type);
+    if (scatter) {
+        grid_scatter(grid, g->a, type, l->a, root);
+        grid_scatter(grid, g->b, type, l->b, root);
+    }
+    simd_run_all(k, fused, use_nt, l, 0, grid_tile_size(grid));
+    grid_gather(grid, l->sum, type, g->sum, root);
+    grid_gather(grid, l->diff, type, g->diff, root);
+    grid_gather(grid, l->prod, type, g->prod, root);
+    grid_gather(grid, l->quot, MPI_DOUBLE, g->quot, root);
+}
+
+// Чтение блоков операндов из файлов path_a и path_b. Возвращает 1 на всех процессах при успехе
+static inline int ew_read_operands(const io_config* io, const char* path_a, const char* path_b,
+                                   const ew_arrays* l, long long local_first, long long local_size,
+                                   MPI_Comm comm) {
+    int ok = io_read_block(io, path_a, l->a, dtype_mpi(l->type), local_first, local_size, comm);
+    return io_read_block(io, path_b, l->b, dtype_mpi(l->type), local_first, local_size, comm) && ok;
+}
+
+// Запись результатов в файлы <prefix>.sum, .diff, .prod (тип операндов) и .quot (double):
+// каждый процесс пишет свой блок. Возвращает 1 на всех процессах при успехе
+static inline int ew_write_results(const io_config* io, const char* prefix, const ew_arrays* l,
+                                   long long local_first, long long local_size, long long n, MPI_Comm comm) {
+    static const char* suffix[4] = { "sum", "diff", "prod", "quot" };
+    const void* bufs[4] = { l->sum, l->diff, l->prod, l->quot };
+    char path[4096];
+    int ok = 1;
+    for (int i = 0; i < 4; i++) {
+        snprintf(path, sizeof(path), "%s.%s", prefix, suffix[i]);
+        ok = io_write_block(io, path, bufs[i], i == 3 ? MPI_DOUBLE : dtype_mpi(l->type), local_first, local_size,
+                            n, comm) && ok;
+    }
+    return ok;
+}
+
+// Чтение и запись плиток двумерного разбиения: тип плитки задаёт вид файла
+static inline int ew_grid_read_operands(const io_config* io, const char* path_a, const char* path_b,
+                                        const grid2d* grid, const ew_arrays* l) {
+    MPI_Datatype type = dtype_mpi(l->type), tile;
+    int rank;
+    MPI_Comm_rank(grid->comm, &rank);
+    grid_tile_type(grid, rank, type, &tile);
+    int ok = io_read_view(io, path_a, l->a, type, tile, grid_tile_size(grid), grid->comm);
+    ok = io_read_view(io, path_b, l->b, type, tile, grid_tile_size(grid), grid->comm) && ok;
+    MPI_Type_free(&tile);
+    return ok;
+}
+
+static inline int ew_grid_write_results(const io_config* io, const char* prefix, const grid2d* grid,
+                                        const ew_arrays* l) {
+    static const char* suffix[4] = { "sum", "diff", "prod", "quot" };
+    const void* bufs[4] = { l->sum, l->diff, l->prod, l->quot };
+    char path[4096];
+    int rank, ok = 1;
+    MPI_Comm_rank(grid->comm, &rank);
+    for (int i = 0; i < 4; i++) {
+        MPI_Datatype elem = i == 3 ? MPI_DOUBLE : dtype_mpi(l->type), tile;
+        grid_tile_type(grid, rank, elem, &tile);
+        snprintf(path, sizeof(path), "%s.%s", prefix, suffix[i]);
+        ok = io_write_view(io, path, bufs[i], elem, tile, grid_tile_size(grid), grid->rows * grid->cols,
+                           grid->comm) && ok;
+        MPI_Type_free(&tile);
+    }
+    return ok;
+}
+
+#endif
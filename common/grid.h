@@ -0,0 +1,169 @@
+#ifndef COMMON_GRID_H
+#define COMMON_GRID_H
+
+#include <limits.h>
+#include <stdlib.h>
+#include <mpi.h>
+
+#include "decomp.h"
+
+// Двумерное разбиение построчной матрицы rows x cols по решётке процессов P x Q
+// (MPI_Cart_create, нумерация процессов построчная). Процесс (p, q) хранит свою
+// плитку непрерывно, построчно: local_rows x local_cols элементов.
+// block == 0 — блочное разбиение каждого измерения, остаток достаётся первым строкам
+// и столбцам решётки (как block_count); block > 0 — блочно-циклическое с блоками
+// block x block (как в ScaLAPACK). Положение плитки в полной матрице описывает
+// производный тип (subarray или darray): им раздаются и собираются плитки на root
+// и задаётся вид файла для MPI-IO, поэтому полная копия матрицы ни у кого не нужна.
+
+typedef struct {
+    MPI_Comm comm;                    // декартов коммуникатор P x Q
+    int dims[2], coords[2];
+    long long rows, cols;
+    int block;                        // 0 — блочное разбиение, иначе размер блока
+    long long local_rows, local_cols;
+} grid2d;
+
+// Число элементов измерения длины n у координаты c из p
+static inline long long grid_dim_count(long long n, int p, int c, int block) {
+    if (block == 0)
+        return block_count(n, p, c);
+    long long blocks = n / block;
+    long long count = blocks / p * block;
+    if (c < blocks % p)
+        count += block;
+    else if (c == blocks % p)
+        count += n % block;
+    return count;
+}
+
+// Глобальный индекс локального индекса l по измерению
+static inline long long grid_dim_global(long long n, int p, int c, int block, long long l) {
+    if (block == 0)
+        return block_start(n, p, c) + l;
+    return (l / block * p + c) * block + l % block;
+}
+
+// Создание решётки: dims[0] x dims[1] процессов (нули выбирает MPI_Dims_create).
+// Возвращает 0, если решётка не совпадает с числом процессов, размеры не помещаются
+// в int (их принимают конструкторы типов), плитка больше INT_MAX элементов или пуста
+static inline int grid_init(grid2d* g, long long rows, long long cols, const int dims[2], int block, MPI_Comm comm) {
+    int nproc, periods[2] = { 0, 0 };
+    MPI_Comm_size(comm, &nproc);
+    g->comm = MPI_COMM_NULL;
+    g->dims[0] = dims[0];
+    g->dims[1] = dims[1];
+    // Заданные измерения должны делить число процессов: иначе MPI_Dims_create — фатальная ошибка MPI
+    long long fixed = (long long)(dims[0] > 0 ? dims[0] : 1) * (dims[1] > 0 ? dims[1] : 1);
+    if (rows > INT_MAX || cols > INT_MAX || block < 0 || g->dims[0] < 0 || g->dims[1] < 0 || nproc % fixed != 0
+        || MPI_Dims_create(nproc, 2, g->dims) != MPI_SUCCESS || g->dims[0] * g->dims[1] != nproc)
+        return 0;
+
+    MPI_Cart_create(comm, 2, g->dims, periods, 0, &g->comm);
+    int rank;
+    MPI_Comm_rank(g->comm, &rank);
+    MPI_Cart_coords(g->comm, rank, 2, g->coords);
+    g->rows = rows;
+    g->cols = cols;
+    g->block = block;
+    g->local_rows = grid_dim_count(rows, g->dims[0], g->coords[0], block);
+    g->local_cols = grid_dim_count(cols, g->dims[1], g->coords[1], block);
+
+    // У первой координаты плитка наибольшая, у последней — наименьшая; пустых плиток не бывает
+    long long max_tile = grid_dim_count(rows, g->dims[0], 0, block) * grid_dim_count(cols, g->dims[1], 0, block);
+    return max_tile <= INT_MAX && grid_dim_count(rows, g->dims[0], g->dims[0] - 1, block) > 0
+        && grid_dim_count(cols, g->dims[1], g->dims[1] - 1, block) > 0;
+}
+
+static inline void grid_free(grid2d* g) {
+    if (g->comm != MPI_COMM_NULL)
+        MPI_Comm_free(&g->comm);
+}
+
+static inline long long grid_tile_size(const grid2d* g) {
+    return g->local_rows * g->local_cols;
+}
+
+// Непрерывный в полной матрице отрезок строки плитки, начинающийся с (li, lj):
+// возвращает его длину, *global — глобальный (построчный) индекс первого элемента
+static inline long long grid_run(const grid2d* g, long long li, long long lj, long long* global) {
+    long long gi = grid_dim_global(g->rows, g->dims[0], g->coords[0], g->block, li);
+    long long gj = grid_dim_global(g->cols, g->dims[1], g->coords[1], g->block, lj);
+    *global = gi * g->cols + gj;
+    long long len = g->local_cols - lj;
+    if (g->block > 0 && g->block - lj % g->block < len)
+        len = g->block - lj % g->block;
+    return len;
+}
+
+// Тип плитки процесса rank в полной матрице из элементов elem
+static inline void grid_tile_type(const grid2d* g, int rank, MPI_Datatype elem, MPI_Datatype* type) {
+    int coords[2];
+    MPI_Cart_coords(g->comm, rank, 2, coords);
+    int sizes[2] = { (int)g->rows, (int)g->cols };
+    if (g->block == 0) {
+        int subsizes[2] = { (int)block_count(g->rows, g->dims[0], coords[0]),
+                            (int)block_count(g->cols, g->dims[1], coords[1]) };
+        int starts[2] = { (int)block_start(g->rows, g->dims[0], coords[0]),
+                          (int)block_start(g->cols, g->dims[1], coords[1]) };
+        MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C, elem, type);
+    } else {
+        int distribs[2] = { MPI_DISTRIBUTE_CYCLIC, MPI_DISTRIBUTE_CYCLIC };
+        int dargs[2] = { g->block, g->block };
+        MPI_Type_create_darray(g->dims[0] * g->dims[1], rank, 2, sizes, distribs, dargs, g->dims,
+                               MPI_ORDER_C, elem, type);
+    }
+    MPI_Type_commit(type);
+}
+
+// Раздача плиток полной матрицы full (только у root) по процессам решётки
+static inline void grid_scatter(const grid2d* g, const void* full, MPI_Datatype elem, void* tile, int root) {
+    int rank, nproc;
+    MPI_Comm_rank(g->comm, &rank);
+    MPI_Comm_size(g->comm, &nproc);
+    MPI_Request* reqs = (MPI_Request*)malloc(sizeof(MPI_Request) * (nproc + 1));
+    int nreq = 0;
+    MPI_Irecv(tile, (int)grid_tile_size(g), elem, root, 0, g->comm, &reqs[nreq++]);
+    MPI_Datatype* types = NULL;
+    if (rank == root) {
+        types = (MPI_Datatype*)malloc(sizeof(MPI_Datatype) * nproc);
+        for (int r = 0; r < nproc; r++) {
+            grid_tile_type(g, r, elem, &types[r]);
+            MPI_Isend(full, 1, types[r], r, 0, g->comm, &reqs[nreq++]);
+        }
+    }
+    MPI_Waitall(nreq, reqs, MPI_STATUSES_IGNORE);
+    if (types) {
+        for (int r = 0; r < nproc; r++)
+            MPI_Type_free(&types[r]);
+        free(types);
+    }
+    free(reqs);
+}
+
+// Сбор плиток в полную матрицу full (только у root): обратная операция к grid_scatter
+static inline void grid_gather(const grid2d* g, const void* tile, MPI_Datatype elem, void* full, int root) {
+    int rank, nproc;
+    MPI_Comm_rank(g->comm, &rank);
+    MPI_Comm_size(g->comm, &nproc);
+    MPI_Request* reqs = (MPI_Request*)malloc(sizeof(MPI_Request) * (nproc + 1));
+    int nreq = 0;
+    MPI_Datatype* types = NULL;
+    if (rank == root) {
+        types = (MPI_Datatype*)malloc(sizeof(MPI_Datatype) * nproc);
+        for (int r = 0; r < nproc; r++) {
+            grid_tile_type(g, r, elem, &types[r]);
+            MPI_Irecv(full, 1, types[r], r, 0, g->comm, &reqs[nreq++]);
+        }
+    }
+    MPI_Isend(tile, (int)grid_tile_size(g), elem, root, 0, g->comm, &reqs[nreq++]);
+    MPI_Waitall(nreq, reqs, MPI_STATUSES_IGNORE);
+    if (types) {
+        for (int r = 0; r < nproc; r++)
+            MPI_Type_free(&types[r]);
+        free(types);
+    }
+    free(reqs);
+}
+
+#endif
@@ -0,0 +1,202 @@
+#ifndef COMMON_IO_H
+#define COMMON_IO_H
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <mpi.h>
+
+#include "args.h"
+#include "threads.h"
+
+// Файловый ввод-вывод блочно распределённых массивов. Файл — сырой массив элементов
+// в машинном порядке байт без заголовка. Каждый процесс читает и пишет свой блок сам
+// по смещению first * размер элемента коллективными MPI_File_read_at_all и
+// MPI_File_write_at_all; подсказки включают коллективную буферизацию, при которой
+// MPI-IO объединяет обращения процессов в крупные непрерывные запросы к ФС.
+// Вариант mmap читает блок через отображение файла (для локальной ФС): страницы
+// копируются потоками процесса, поэтому буфер получает то же первое касание.
+
+typedef enum { IO_MPIIO, IO_MMAP } io_method;
+
+typedef struct {
+    io_method method;  // способ чтения; запись всегда через MPI-IO
+    MPI_Info info;     // подсказки MPI-IO
+} io_config;
+
+// Разбор --io=mpiio|mmap, --cb-buffer=<байт> (размер буфера коллективных операций) и
+// --cb-nodes=<число> (число процессов-агрегаторов). Переносимые подсказки стандарта
+// (collective_buffering, cb_buffer_size, cb_nodes) понимают и ROMIO, и OMPIO Open MPI;
+// romio_cb_read/romio_cb_write действуют только в ROMIO (MPICH, Intel MPI).
+// Возвращает 0 при некорректном значении
+static inline int io_setup(io_config* io, int argc, char* argv[]) {
+    const char* method = arg_str(argc, argv, "--io", "mpiio");
+    long long cb_buffer = arg_size(argc, argv, "--cb-buffer", 0);
+    long long cb_nodes = arg_long(argc, argv, "--cb-nodes", 0);
+    io->method = strcmp(method, "mmap") == 0 ? IO_MMAP : IO_MPIIO;
+    io->info = MPI_INFO_NULL;
+    if ((io->method == IO_MPIIO && strcmp(method, "mpiio") != 0) || cb_buffer < 0 || cb_buffer > INT_MAX ||
+        cb_nodes < 0 || cb_nodes > INT_MAX)
+        return 0;
+
+    MPI_Info_create(&io->info);
+    MPI_Info_set(io->info, "collective_buffering", "true");
+    MPI_Info_set(io->info, "romio_cb_read", "enable");
+    MPI_Info_set(io->info, "romio_cb_write", "enable");
+    if (cb_buffer > 0) {
+        char value[32];
+        snprintf(value, sizeof(value), "%lld", cb_buffer);
+        MPI_Info_set(io->info, "cb_buffer_size", value);
+    }
+    if (cb_nodes > 0) {
+        char value[32];
+        snprintf(value, sizeof(value), "%lld", cb_nodes);
+        MPI_Info_set(io->info, "cb_nodes", value);
+    }
+    return 1;
+}
+
+static inline void io_free(io_config* io) {
+    if (io->info != MPI_INFO_NULL)
+        MPI_Info_free(&io->info);
+}
+
+// Разбор пары путей "<a>,<b>" (входные файлы задач 3 и 4) в буферы a и b по size байт.
+// Возвращает 0, если запятой нет или путь не помещается в буфер
+static inline int io_split_pair(const char* value, char* a, char* b, size_t size) {
+    const char* comma = strchr(value, ',');
+    if (!comma || (size_t)(comma - value) >= size || strlen(comma + 1) >= size || comma == value || !comma[1])
+        return 0;
+    memcpy(a, value, (size_t)(comma - value));
+    a[comma - value] = '\0';
+    strcpy(b, comma + 1);
+    return 1;
+}
+
+// Число элементов размера elem в файле (одинаково на всех процессах comm);
+// -1, если файл не открывается или его размер не кратен elem
+static inline long long io_file_count(const char* path, int elem, MPI_Comm comm) {
+    MPI_File fh;
+    MPI_Offset bytes = -1;
+    if (MPI_File_open(comm, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS)
+        return -1;
+    MPI_File_get_size(fh, &bytes);
+    MPI_File_close(&fh);
+    return bytes >= 0 && bytes % elem == 0 ? (long long)(bytes / elem) : -1;
+}
+
+// Чтение count элементов с элемента first через отображение файла. Возвращает 1 при успехе
+static inline int io_read_mmap(const char* path, void* buf, int elem, long long first, long long count) {
+    if (count == 0)
+        return 1;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return 0;
+
+    struct stat st;
+    off_t from = (off_t)first * elem;
+    size_t bytes = (size_t)count * elem;
+    if (fstat(fd, &st) != 0 || st.st_size < from + (off_t)bytes) {
+        close(fd);
+        return 0;
+    }
+    off_t base = from - from % sysconf(_SC_PAGESIZE);  // смещение mmap кратно размеру страницы
+    size_t len = (size_t)(from - base) + bytes;
+    void* map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, base);
+    close(fd);
+    if (map == MAP_FAILED)
+        return 0;
+    madvise(map, len, MADV_SEQUENTIAL);
+
+    const char* src = (const char*)map + (from - base);
+#pragma omp parallel
+    {
+        long long part_from, part_count;
+        threads_range(count, &part_from, &part_count);
+        memcpy((char*)buf + part_from * elem, src + part_from * elem, (size_t)part_count * elem);
+    }
+    munmap(map, len);
+    return 1;
+}
+
+// Коллективное чтение элементов first..first+count-1 файла path в buf.
+// Возвращает 1 на всех процессах, если каждый прочитал свой блок полностью
+static inline int io_read_block(const io_config* io, const char* path, void* buf, MPI_Datatype type,
+                                long long first, long long count, MPI_Comm comm) {
+    int elem, ok = 0, all_ok = 0;
+    MPI_Type_size(type, &elem);
+    if (io->method == IO_MMAP) {
+        ok = io_read_mmap(path, buf, elem, first, count);
+    } else {
+        MPI_File fh;
+        if (MPI_File_open(comm, path, MPI_MODE_RDONLY, io->info, &fh) == MPI_SUCCESS) {
+            MPI_Status status;
+            int got = 0;
+            ok = MPI_File_read_at_all(fh, (MPI_Offset)first * elem, buf, (int)count, type, &status) == MPI_SUCCESS;
+            MPI_Get_count(&status, type, &got);
+            ok = ok && got == count;
+            MPI_File_close(&fh);
+        }
+    }
+    MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_LAND, comm);
+    return all_ok;
+}
+
+// Коллективная запись блока buf на место first..first+count-1 файла path из total элементов.
+// Файл создаётся или усекается до total элементов. Возвращает 1 на всех процессах при успехе
+static inline int io_write_block(const io_config* io, const char* path, const void* buf, MPI_Datatype type,
+                                 long long first, long long count, long long total, MPI_Comm comm) {
+    int elem, ok = 0, all_ok = 0;
+    MPI_Type_size(type, &elem);
+    MPI_File fh;
+    if (MPI_File_open(comm, path, MPI_MODE_WRONLY | MPI_MODE_CREATE, io->info, &fh) == MPI_SUCCESS) {
+        ok = MPI_File_set_size(fh, (MPI_Offset)total * elem) == MPI_SUCCESS;
+        ok = MPI_File_write_at_all(fh, (MPI_Offset)first * elem, buf, (int)count, type,
+                                   MPI_STATUS_IGNORE) == MPI_SUCCESS && ok;
+        MPI_File_close(&fh);
+    }
+    MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_LAND, comm);
+    return all_ok;
+}
+
+// Коллективное чтение несплошного блока: filetype (например, тип плитки из grid.h) задаёт
+// вид файла, count элементов type ложатся в buf подряд. Всегда через MPI-IO
+static inline int io_read_view(const io_config* io, const char* path, void* buf, MPI_Datatype type,
+                               MPI_Datatype filetype, long long count, MPI_Comm comm) {
+    int ok = 0, all_ok = 0;
+    MPI_File fh;
+    if (MPI_File_open(comm, path, MPI_MODE_RDONLY, io->info, &fh) == MPI_SUCCESS) {
+        MPI_Status status;
+        int got = 0;
+        ok = MPI_File_set_view(fh, 0, type, filetype, "native", io->info) == MPI_SUCCESS
+             && MPI_File_read_all(fh, buf, (int)count, type, &status) == MPI_SUCCESS;
+        if (ok)
+            MPI_Get_count(&status, type, &got);
+        ok = ok && got == count;
+        MPI_File_close(&fh);
+    }
+    MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_LAND, comm);
+    return all_ok;
+}
+
+// Коллективная запись несплошного блока по виду filetype в файл из total элементов
+static inline int io_write_view(const io_config* io, const char* path, const void* buf, MPI_Datatype type,
+                                MPI_Datatype filetype, long long count, long long total, MPI_Comm comm) {
+    int elem, ok = 0, all_ok = 0;
+    MPI_Type_size(type, &elem);
+    MPI_File fh;
+    if (MPI_File_open(comm, path, MPI_MODE_WRONLY | MPI_MODE_CREATE, io->info, &fh) == MPI_SUCCESS) {
+        ok = MPI_File_set_size(fh, (MPI_Offset)total * elem) == MPI_SUCCESS
+             && MPI_File_set_view(fh, 0, type, filetype, "native", io->info) == MPI_SUCCESS
+             && MPI_File_write_all(fh, buf, (int)count, type, MPI_STATUS_IGNORE) == MPI_SUCCESS;
+        MPI_File_close(&fh);
+    }
+    MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_LAND, comm);
+    return all_ok;
+}
+
+#endif
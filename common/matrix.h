@@ -0,0 +1,76 @@
+#ifndef COMMON_MATRIX_H
+#define COMMON_MATRIX_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// Построчная матрица в куче с выравниванием начала на строку кэша (или на большую
+// страницу). При выравнивании строк длина строки в памяти (stride) округляется вверх
+// до целого числа строк кэша, поэтому каждая строка начинается на границе строки кэша
+// и векторные ядра не разрезают строки кэша между соседними строками матрицы.
+// Без выравнивания строк матрица хранится сплошным массивом rows * cols элементов —
+// так её блоки и плитки пересылаются MPI без производных типов.
+
+#define MATRIX_CACHE_LINE 64
+#define MATRIX_HUGE_PAGE (2LL << 20)
+
+// Флаги matrix_alloc
+#define MATRIX_PAD_ROWS 1  // выравнивать каждую строку на строку кэша
+#define MATRIX_HUGE 2      // выравнивать на 2 МБ и просить прозрачные большие страницы
+
+typedef struct {
+    long long rows, cols;
+    long long stride;  // расстояние между началами строк в элементах
+    size_t elem;       // размер элемента в байтах
+    void* data;
+} matrix;
+
+// Выделение матрицы rows x cols из элементов размера elem. Возвращает 0, если памяти нет
+static inline int matrix_alloc(matrix* m, long long rows, long long cols, size_t elem, int flags) {
+    long long per_line = MATRIX_CACHE_LINE / (long long)elem;
+    m->rows = rows;
+    m->cols = cols;
+    m->elem = elem;
+    m->stride = (flags & MATRIX_PAD_ROWS) ? (cols + per_line - 1) / per_line * per_line : cols;
+
+    size_t align = (flags & MATRIX_HUGE) ? (size_t)MATRIX_HUGE_PAGE : MATRIX_CACHE_LINE;
+    size_t bytes = (size_t)(rows > 0 ? rows : 1) * (size_t)(m->stride > 0 ? m->stride : 1) * elem;
+    bytes = (bytes + align - 1) / align * align;
+    if (posix_memalign(&m->data, align, bytes) != 0) {
+        m->data = NULL;
+        return 0;
+    }
+#ifdef MADV_HUGEPAGE
+    if (flags & MATRIX_HUGE)
+        madvise(m->data, bytes, MADV_HUGEPAGE);
+#endif
+    return 1;
+}
+
+// Сплошная матрица rows x cols поверх готовой памяти data (например, буфера арены
+// из common/arena.h). Память принадлежит вызывающему, matrix_free для такой матрицы не вызывается
+static inline void matrix_wrap(matrix* m, void* data, long long rows, long long cols, size_t elem) {
+    m->rows = rows;
+    m->cols = cols;
+    m->stride = cols;
+    m->elem = elem;
+    m->data = data;
+}
+
+static inline void matrix_free(matrix* m) {
+    free(m->data);
+    m->data = NULL;
+}
+
+// Начало строки i
+static inline void* matrix_row(const matrix* m, long long i) {
+    return (char*)m->data + (size_t)(i * m->stride) * m->elem;
+}
+
+// Строки матрицы лежат подряд без промежутков (весь массив можно обрабатывать одним проходом)
+static inline int matrix_dense(const matrix* m) {
+    return m->stride == m->cols;
+}
+
+#endif
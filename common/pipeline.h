@@ -0,0 +1,90 @@
+#ifndef COMMON_PIPELINE_H
+#define COMMON_PIPELINE_H
+
+#include <stdlib.h>
+#include <mpi.h>
+
+#include "decomp.h"
+
+// Конвейерная раздача и сбор блочно распределённого массива.
+// Блок каждого процесса делится на chunks порций (размеры отличаются не больше
+// чем на 1); порция k всех процессов раздаётся одним MPI_Iscatterv и собирается
+// одним MPI_Igatherv. Программа ждёт порцию k, сразу запускает k+1 и считает на k,
+// пока k+1 в пути (двойная буферизация: одновременно в пути не больше двух порций).
+// Продвижение неблокирующих коллективных операций без отдельного потока MPI
+// происходит при вызовах MPI, поэтому pipe_progress вызывается между порциями.
+
+typedef struct {
+    int nproc, rank, root, chunks;
+    MPI_Comm comm;
+    int* counts;  // [chunks * nproc]: размер порции k процесса r
+    int* displs;  // [chunks * nproc]: её смещение в полном массиве
+} pipe_plan;
+
+// Возвращает 0, если полный массив не адресуется смещениями int
+static inline int pipe_plan_init(pipe_plan* p, long long n, int chunks, int root, MPI_Comm comm) {
+    p->root = root;
+    p->chunks = chunks;
+    p->comm = comm;
+    MPI_Comm_rank(comm, &p->rank);
+    MPI_Comm_size(comm, &p->nproc);
+    p->counts = NULL;
+    p->displs = NULL;
+    if (n > INT_MAX || chunks <= 0)
+        return 0;
+
+    p->counts = (int*)malloc(sizeof(int) * chunks * p->nproc);
+    p->displs = (int*)malloc(sizeof(int) * chunks * p->nproc);
+    for (int r = 0; r < p->nproc; r++) {
+        long long count = block_count(n, p->nproc, r);
+        long long start = block_start(n, p->nproc, r);
+        for (int k = 0; k < chunks; k++) {
+            p->counts[k * p->nproc + r] = (int)block_count(count, chunks, k);
+            p->displs[k * p->nproc + r] = (int)(start + block_start(count, chunks, k));
+        }
+    }
+    return 1;
+}
+
+static inline void pipe_plan_free(pipe_plan* p) {
+    free(p->counts);
+    free(p->displs);
+    p->counts = p->displs = NULL;
+}
+
+// Смещение порции k внутри локального блока и её размер
+static inline long long pipe_chunk_from(const pipe_plan* p, int k) {
+    return p->displs[k * p->nproc + p->rank] - p->displs[p->rank];
+}
+
+static inline int pipe_chunk_count(const pipe_plan* p, int k) {
+    return p->counts[k * p->nproc + p->rank];
+}
+
+// Запуск раздачи порции k из root_buf (только у root) в local_buf (локальный блок целиком)
+static inline void pipe_iscatter(const pipe_plan* p, int k, const void* root_buf, MPI_Datatype type,
+                                 void* local_buf, MPI_Request* req) {
+    MPI_Aint lb, extent;
+    MPI_Type_get_extent(type, &lb, &extent);
+    MPI_Iscatterv(root_buf, p->counts + k * p->nproc, p->displs + k * p->nproc, type,
+                  (char*)local_buf + pipe_chunk_from(p, k) * extent, pipe_chunk_count(p, k), type,
+                  p->root, p->comm, req);
+}
+
+// Запуск сбора порции k локального блока local_buf в root_buf (только у root)
+static inline void pipe_igather(const pipe_plan* p, int k, const void* local_buf, MPI_Datatype type,
+                                void* root_buf, MPI_Request* req) {
+    MPI_Aint lb, extent;
+    MPI_Type_get_extent(type, &lb, &extent);
+    MPI_Igatherv((const char*)local_buf + pipe_chunk_from(p, k) * extent, pipe_chunk_count(p, k), type,
+                 root_buf, p->counts + k * p->nproc, p->displs + k * p->nproc, type,
+                 p->root, p->comm, req);
+}
+
+// Подталкивание незавершённых операций
+static inline void pipe_progress(int count, MPI_Request* reqs) {
+    int done;
+    MPI_Testall(count, reqs, &done, MPI_STATUSES_IGNORE);
+}
+
+#endif
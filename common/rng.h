@@ -0,0 +1,99 @@
+#ifndef COMMON_RNG_H
+#define COMMON_RNG_H
+
+#include <stdint.h>
+
+// Счётчиковый генератор Philox4x32-10 (Salmon et al., 2011).
+// Значение элемента с глобальным индексом i зависит только от (seed, stream, i),
+// поэтому каждый процесс может сгенерировать свой блок сам, и массив
+// получается побитово таким же, как при генерации целиком на одном процессе.
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+
+static inline void philox4x32_10(uint32_t ctr[4], uint32_t k0, uint32_t k1) {
+    for (int round = 0; round < 10; round++) {
+        uint64_t p0 = (uint64_t)PHILOX_M0 * ctr[0];
+        uint64_t p1 = (uint64_t)PHILOX_M1 * ctr[2];
+        uint32_t c0 = (uint32_t)(p1 >> 32) ^ ctr[1] ^ k0;
+        uint32_t c1 = (uint32_t)p1;
+        uint32_t c2 = (uint32_t)(p0 >> 32) ^ ctr[3] ^ k1;
+        uint32_t c3 = (uint32_t)p0;
+        ctr[0] = c0; ctr[1] = c1; ctr[2] = c2; ctr[3] = c3;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+}
+
+// Заполнение out[0..count) значениями элементов first..first+count-1
+// из диапазона [lo, lo + span). stream различает независимые массивы (a и b)
+static inline void rng_fill_int(int* out, long long count, long long first,
+                                uint64_t seed, uint32_t stream, int lo, uint32_t span) {
+    uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+    long long i = 0;
+    while (i < count) {
+        long long g = first + i;
+        uint64_t block = (uint64_t)g >> 2;
+        uint32_t ctr[4] = { (uint32_t)block, (uint32_t)(block >> 32), stream, 0 };
+        philox4x32_10(ctr, k0, k1);
+
+        // Из четырёх слов блока берутся те, что попадают в запрошенный отрезок
+        for (int lane = (int)(g & 3); lane < 4 && i < count; lane++, i++)
+            out[i] = lo + (int)(((uint64_t)ctr[lane] * span) >> 32);
+    }
+}
+
+// Те же значения, что у rng_fill_int, в 64-битных элементах
+static inline void rng_fill_i64(int64_t* out, long long count, long long first,
+                                uint64_t seed, uint32_t stream, int lo, uint32_t span) {
+    uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+    long long i = 0;
+    while (i < count) {
+        long long g = first + i;
+        uint64_t block = (uint64_t)g >> 2;
+        uint32_t ctr[4] = { (uint32_t)block, (uint32_t)(block >> 32), stream, 0 };
+        philox4x32_10(ctr, k0, k1);
+
+        for (int lane = (int)(g & 3); lane < 4 && i < count; lane++, i++)
+            out[i] = lo + (int64_t)(((uint64_t)ctr[lane] * span) >> 32);
+    }
+}
+
+// Вещественные значения из [lo, lo + span). Элемент double берёт два 32-битных слова
+// блока (53 старших бита), элемент float — одно слово (24 старших бита);
+// последнее слово счётчика отделяет эти последовательности от целочисленной
+static inline void rng_fill_double(double* out, long long count, long long first,
+                                   uint64_t seed, uint32_t stream, double lo, double span) {
+    uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+    long long i = 0;
+    while (i < count) {
+        long long g = first + i;
+        uint64_t block = (uint64_t)g >> 1;
+        uint32_t ctr[4] = { (uint32_t)block, (uint32_t)(block >> 32), stream, 1 };
+        philox4x32_10(ctr, k0, k1);
+
+        for (int lane = (int)(g & 1); lane < 2 && i < count; lane++, i++) {
+            uint64_t bits = ((uint64_t)ctr[2 * lane] << 32 | ctr[2 * lane + 1]) >> 11;
+            out[i] = lo + span * (double)bits * (1.0 / 9007199254740992.0);
+        }
+    }
+}
+
+static inline void rng_fill_float(float* out, long long count, long long first,
+                                  uint64_t seed, uint32_t stream, float lo, float span) {
+    uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+    long long i = 0;
+    while (i < count) {
+        long long g = first + i;
+        uint64_t block = (uint64_t)g >> 2;
+        uint32_t ctr[4] = { (uint32_t)block, (uint32_t)(block >> 32), stream, 2 };
+        philox4x32_10(ctr, k0, k1);
+
+        for (int lane = (int)(g & 3); lane < 4 && i < count; lane++, i++)
+            out[i] = lo + span * (float)(ctr[lane] >> 8) * (1.0f / 16777216.0f);
+    }
+}
+
+#endif
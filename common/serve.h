@@ -0,0 +1,150 @@
+#ifndef COMMON_SERVE_H
+#define COMMON_SERVE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <mpi.h>
+
+#include "bench.h"
+
+// Служебный режим (--serve=<файл или FIFO>): процессы запускаются один раз и выполняют
+// поток заданий, так что запуск mpirun, MPI_Init и резервирование памяти не повторяются
+// для каждого задания. Задание — строка с параметрами программы, как в командной строке
+// (например, "task1 3 --n=1M --dtype=double --sum=pairwise"); необязательное первое слово —
+// имя задачи, оно должно совпадать с задачей программы. Пустые строки и строки с # пропускаются,
+// строка quit завершает режим. Процесс 0 читает строки и рассылает их остальным; конец FIFO
+// (писатель закрыл канал) не завершает режим — канал открывается снова и ждёт следующего писателя.
+// После каждого задания процесс 0 печатает его задержку, в конце — сводку по всем заданиям.
+
+#define SERVE_LINE 4096
+#define SERVE_MAX_ARGS 64
+
+typedef struct {
+    FILE* in;             // на процессе 0
+    const char* path;
+    int fifo;
+    const char* program;  // argv[0] заданий
+    const char* task;     // имя задачи в строках заданий
+    char line[SERVE_LINE];
+    char words[SERVE_LINE];
+    char* argv[SERVE_MAX_ARGS + 1];
+    int argc;             // 0 — строка задания некорректна
+    long long jobs, failed;
+    double* latency;      // задержки заданий, секунды (на процессе 0)
+    long long capacity;
+} serve;
+
+// Открытие потока заданий; коллективная операция. Возвращает 1 на всех процессах при успехе
+static inline int serve_open(serve* s, const char* path, const char* program, const char* task, MPI_Comm comm) {
+    int rank, ok = 1;
+    MPI_Comm_rank(comm, &rank);
+    memset(s, 0, sizeof(*s));
+    s->path = path;
+    s->program = program;
+    s->task = task;
+    if (rank == 0) {
+        struct stat st;
+        s->fifo = stat(path, &st) == 0 && S_ISFIFO(st.st_mode);
+        s->in = fopen(path, "r");
+        ok = s->in != NULL;
+    }
+    MPI_Bcast(&ok, 1, MPI_INT, 0, comm);
+    return ok;
+}
+
+// Следующая строка задания на процессе 0: 1 — строка в s->line, 0 — конец потока
+static inline int serve_read_line(serve* s) {
+    for (;;) {
+        if (fgets(s->line, sizeof(s->line), s->in)) {
+            s->line[strcspn(s->line, "\r\n")] = '\0';
+            const char* p = s->line + strspn(s->line, " \t");
+            if (*p == '\0' || *p == '#')
+                continue;
+            return strcmp(p, "quit") != 0;
+        }
+        if (!s->fifo)
+            return 0;
+        // Писатель закрыл канал: ждём следующего
+        fclose(s->in);
+        s->in = fopen(s->path, "r");
+        if (!s->in)
+            return 0;
+    }
+}
+
+// Получение следующего задания всеми процессами; коллективная операция. Возвращает 0 в конце потока.
+// Параметры задания — в s->argc/s->argv (argv[0] — имя программы); s->argc == 0, если строка некорректна
+static inline int serve_next(serve* s, MPI_Comm comm) {
+    int rank, len = -1;
+    MPI_Comm_rank(comm, &rank);
+    if (rank == 0 && serve_read_line(s))
+        len = (int)strlen(s->line) + 1;
+    MPI_Bcast(&len, 1, MPI_INT, 0, comm);
+    if (len < 0)
+        return 0;
+    MPI_Bcast(s->line, len, MPI_CHAR, 0, comm);
+
+    // Разбиение на слова; первое слово может быть именем задачи
+    memcpy(s->words, s->line, len);
+    s->argc = 0;
+    s->argv[s->argc++] = (char*)s->program;
+    for (char* w = strtok(s->words, " \t"); w; w = strtok(NULL, " \t")) {
+        if (s->argc == SERVE_MAX_ARGS) {
+            s->argc = 0;
+            break;
+        }
+        s->argv[s->argc++] = w;
+    }
+    if (s->argc > 1 && s->argv[1][0] != '-' && (s->argv[1][0] < '0' || s->argv[1][0] > '9')) {
+        if (strcmp(s->argv[1], s->task) != 0)
+            s->argc = 0;
+        else {
+            memmove(&s->argv[1], &s->argv[2], sizeof(char*) * (s->argc - 2));
+            s->argc--;
+        }
+    }
+    if (s->argc == 0 && rank == 0)
+        printf("Ошибка: задание не для %s или слишком много параметров: %s\n", s->task, s->line);
+    s->argv[s->argc] = NULL;
+    return 1;
+}
+
+// Завершение задания, начатого в start (MPI_Wtime): задержка — до конца задания на всех процессах.
+// code — код завершения задания (0 — успех). Коллективная операция
+static inline void serve_done(serve* s, int code, double start, MPI_Comm comm) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Barrier(comm);
+    double seconds = MPI_Wtime() - start;
+    s->jobs++;
+    s->failed += code != 0;
+    if (rank != 0)
+        return;
+    if (s->jobs > s->capacity) {
+        s->capacity = s->capacity ? 2 * s->capacity : 64;
+        s->latency = (double*)realloc(s->latency, sizeof(double) * s->capacity);
+    }
+    s->latency[s->jobs - 1] = seconds;
+    printf("Задание %lld: %.6f с%s: %s\n", s->jobs, seconds, code ? " (ошибка)" : "", s->line);
+    fflush(stdout);
+}
+
+// Сводка по заданиям и закрытие потока на процессе 0; вызывается всеми процессами
+static inline void serve_close(serve* s, MPI_Comm comm) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    if (rank != 0)
+        return;
+    if (s->jobs > 0) {
+        bench_stats st = bench_sample_stats(s->latency, (int)s->jobs);
+        printf("Заданий: %lld (с ошибкой: %lld), задержка, с: мин %.6f, медиана %.6f, p95 %.6f, макс %.6f\n",
+               s->jobs, s->failed, st.min, st.median, st.p95, st.max);
+    }
+    if (s->in)
+        fclose(s->in);
+    free(s->latency);
+}
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef COMMON_SHM_H
+#define COMMON_SHM_H
+
+#include <stdlib.h>
+#include <mpi.h>
+
+#include "decomp.h"
+
+// Общая память узла (--shm). Процессы одного узла (MPI_COMM_TYPE_SHARED) держат свои
+// блоки в общем окне MPI_Win_allocate_shared: сегменты окна лежат подряд в порядке
+// номеров процессов, так что при подряд идущих номерах на узле часть массива узла —
+// один непрерывный отрезок. Раздача тогда идёт только между старшими процессами узлов
+// (по одному на узел) прямо в окно, а остальные процессы узла работают со своим
+// сегментом на месте, без копирования. Соседи на одном узле читают блок друг друга
+// через указатель из MPI_Win_shared_query; сообщения остаются только между узлами.
+// Окна открыты в пассивном режиме (MPI_Win_lock_all) всё время жизни; видимость
+// записей обеспечивают MPI_Win_sync вокруг синхронизирующих сообщений.
+
+typedef struct {
+    MPI_Comm comm;       // все процессы
+    MPI_Comm node;       // процессы узла
+    MPI_Comm leaders;    // по младшему процессу каждого узла; MPI_COMM_NULL у остальных
+    int node_rank, node_size;
+    int* node_of;        // [nproc]: номер процесса comm в node, -1 — процесс другого узла
+    int contiguous;      // на каждом узле номера процессов идут подряд (на всех процессах одинаково)
+    int nodes;           // число узлов (у старших процессов)
+    int* node_first;     // [nodes]: номер первого процесса узла в comm (у старших процессов)
+    int* node_count;     // [nodes]: число процессов узла (у старших процессов)
+} shm_node;
+
+// Общее окно узла: base — свой сегмент
+typedef struct {
+    MPI_Win win;
+    void* base;
+} shm_window;
+
+// Разбиение comm на узлы. Коллективная операция
+static inline void shm_setup(shm_node* s, MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    s->comm = comm;
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &s->node);
+    MPI_Comm_rank(s->node, &s->node_rank);
+    MPI_Comm_size(s->node, &s->node_size);
+
+    // Номера в node для всех процессов comm (MPI_UNDEFINED — чужой узел)
+    MPI_Group all, local;
+    MPI_Comm_group(comm, &all);
+    MPI_Comm_group(s->node, &local);
+    int* ranks = (int*)malloc(sizeof(int) * size);
+    s->node_of = (int*)malloc(sizeof(int) * size);
+    for (int r = 0; r < size; r++)
+        ranks[r] = r;
+    MPI_Group_translate_ranks(all, size, ranks, local, s->node_of);
+    for (int r = 0; r < size; r++)
+        if (s->node_of[r] == MPI_UNDEFINED)
+            s->node_of[r] = -1;
+    MPI_Group_free(&all);
+    MPI_Group_free(&local);
+    free(ranks);
+
+    // Номера процессов узла подряд: первый процесс узла плюс номер в узле
+    int first = rank - s->node_rank, mine = first >= 0 && first + s->node_size <= size;
+    for (int i = 0; mine && i < s->node_size; i++)
+        mine = s->node_of[first + i] == i;
+    MPI_Allreduce(&mine, &s->contiguous, 1, MPI_INT, MPI_LAND, comm);
+
+    // Старшие процессы узлов знают первый процесс и размер каждого узла
+    MPI_Comm_split(comm, s->node_rank == 0 ? 0 : MPI_UNDEFINED, rank, &s->leaders);
+    s->nodes = 0;
+    s->node_first = s->node_count = NULL;
+    if (s->leaders != MPI_COMM_NULL) {
+        MPI_Comm_size(s->leaders, &s->nodes);
+        s->node_first = (int*)malloc(sizeof(int) * s->nodes);
+        s->node_count = (int*)malloc(sizeof(int) * s->nodes);
+        MPI_Allgather(&rank, 1, MPI_INT, s->node_first, 1, MPI_INT, s->leaders);
+        MPI_Allgather(&s->node_size, 1, MPI_INT, s->node_count, 1, MPI_INT, s->leaders);
+    }
+}
+
+static inline void shm_free(shm_node* s) {
+    if (s->leaders != MPI_COMM_NULL)
+        MPI_Comm_free(&s->leaders);
+    MPI_Comm_free(&s->node);
+    free(s->node_of);
+    free(s->node_first);
+    free(s->node_count);
+}
+
+// Процесс peer (номер в comm) на том же узле
+static inline int shm_same_node(const shm_node* s, int peer) {
+    return s->node_of[peer] >= 0;
+}
+
+// Сегмент из bytes байт в общем окне узла. Коллективная операция на узле;
+// возвращает 0, если окно не выделено
+static inline int shm_window_alloc(shm_window* w, const shm_node* s, size_t bytes) {
+    if (MPI_Win_allocate_shared((MPI_Aint)bytes, 1, MPI_INFO_NULL, s->node, &w->base,
+                                &w->win) != MPI_SUCCESS)
+        return 0;
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, w->win);
+    return 1;
+}
+
+static inline void shm_window_free(shm_window* w) {
+    MPI_Win_unlock_all(w->win);
+    MPI_Win_free(&w->win);
+}
+
+// Сегмент процесса peer (номер в comm, тот же узел)
+static inline void* shm_window_peer(const shm_window* w, const shm_node* s, int peer) {
+    MPI_Aint bytes;
+    int disp;
+    void* ptr = NULL;
+    MPI_Win_shared_query(w->win, s->node_of[peer], &bytes, &disp, &ptr);
+    return ptr;
+}
+
+// Обмен значением с процессом peer, упорядочивающий память окон wins[0..count):
+// записи каждой стороны до вызова видны другой после него. Возвращает значение peer
+static inline int shm_pair_sync(const shm_window* wins, int count, int value, int peer, int tag, MPI_Comm comm) {
+    int other = 0;
+    for (int i = 0; i < count; i++)
+        MPI_Win_sync(wins[i].win);
+    MPI_Sendrecv(&value, 1, MPI_INT, peer, tag, &other, 1, MPI_INT, peer, tag, comm, MPI_STATUS_IGNORE);
+    for (int i = 0; i < count; i++)
+        MPI_Win_sync(wins[i].win);
+    return other;
+}
+
+// Раздача массива root_buf из n элементов (на процессе 0) блоками decomp.h прямо в общее окно w:
+// части массива получают только старшие процессы узлов, остальные видят свой блок на месте.
+// Нужны подряд идущие номера на узлах и n не больше INT_MAX; иначе возвращает 0 (на всех
+// процессах) и ничего не раздаёт. Коллективная операция
+static inline int shm_scatter_blocks(const shm_node* s, const void* root_buf, long long n, MPI_Datatype type,
+                                     const shm_window* w) {
+    if (!s->contiguous || n > INT_MAX)
+        return 0;
+    int size;
+    MPI_Comm_size(s->comm, &size);
+    if (s->leaders != MPI_COMM_NULL) {
+        int* counts = (int*)malloc(sizeof(int) * s->nodes);
+        int* displs = (int*)malloc(sizeof(int) * s->nodes);
+        for (int i = 0; i < s->nodes; i++) {
+            long long from = block_start(n, size, s->node_first[i]);
+            displs[i] = (int)from;
+            counts[i] = (int)(block_start(n, size, s->node_first[i] + s->node_count[i]) - from);
+        }
+        int leader;
+        MPI_Comm_rank(s->leaders, &leader);
+        MPI_Scatterv(root_buf, counts, displs, type, w->base, counts[leader], type, 0, s->leaders);
+        free(counts);
+        free(displs);
+    }
+    MPI_Win_sync(w->win);
+    MPI_Barrier(s->node);
+    MPI_Win_sync(w->win);
+    return 1;
+}
+
+#endif
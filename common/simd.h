@@ -0,0 +1,628 @@
+#ifndef COMMON_SIMD_H
+#define COMMON_SIMD_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "elementwise.h"
+#include "sum.h"
+#include "threads.h"
+
+// Векторные варианты ядер суммы и поэлементных операций (AVX2, AVX-512)
+// со скалярным запасным вариантом. Вариант выбирается при запуске по CPUID;
+// векторные функции компилируются с атрибутом target, поэтому общий флаг -mavx2
+// при сборке не нужен, а на процессоре без расширения они просто не вызываются.
+// Поэлементные ядра для int написаны на интринсиках; для int64, float и double
+// они порождаются макросом SIMD_EW_DEFINE из векторных расширений GCC
+// (vector_size) — один текст на тип и ширину вектора.
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define SIMD_X86 1
+#else
+#define SIMD_X86 0
+#endif
+
+typedef struct {
+    const char* name;
+    int64_t (*sum_i32)(const int* restrict, long long);
+    sum_pair (*sum_f64_kahan)(const double* restrict, long long);
+    sum_pair (*sum_f32_kahan)(const float* restrict, long long);
+    ew_kernels ew[DTYPE_COUNT];  // поэлементные ядра по типам элементов
+} simd_kernels;
+
+static const simd_kernels simd_scalar = {
+    "scalar", sum_i32_wide, sum_kahan_f64, sum_kahan_f32, { DTYPE_FOREACH(EW_TABLE_ENTRY) }
+};
+
+#if SIMD_X86
+
+// ---------- AVX2: 8 элементов int за итерацию ----------
+
+// Сумма int в 64-битных линиях: каждые 4 элемента расширяются до int64
+__attribute__((target("avx2")))
+static inline int64_t simd_sum_i32_avx2(const int* restrict a, long long n) {
+    __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+    __m256i acc2 = _mm256_setzero_si256(), acc3 = _mm256_setzero_si256();
+    long long i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i x0 = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i x1 = _mm256_loadu_si256((const __m256i*)(a + i + 8));
+        acc0 = _mm256_add_epi64(acc0, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(x0)));
+        acc1 = _mm256_add_epi64(acc1, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(x0, 1)));
+        acc2 = _mm256_add_epi64(acc2, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(x1)));
+        acc3 = _mm256_add_epi64(acc3, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(x1, 1)));
+    }
+    __m256i acc = _mm256_add_epi64(_mm256_add_epi64(acc0, acc1), _mm256_add_epi64(acc2, acc3));
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sum_i32_wide(a + i, n - i);
+}
+
+// Кэхэн по восьми линиям (два вектора по 4 double), раскладка линий как в sum_kahan_f64
+__attribute__((target("avx2")))
+static inline sum_pair simd_sum_f64_kahan_avx2(const double* restrict x, long long n) {
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    __m256d c0 = _mm256_setzero_pd(), c1 = _mm256_setzero_pd();
+    long long i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256d y0 = _mm256_sub_pd(_mm256_loadu_pd(x + i), c0);
+        __m256d y1 = _mm256_sub_pd(_mm256_loadu_pd(x + i + 4), c1);
+        __m256d t0 = _mm256_add_pd(s0, y0);
+        __m256d t1 = _mm256_add_pd(s1, y1);
+        c0 = _mm256_sub_pd(_mm256_sub_pd(t0, s0), y0);
+        c1 = _mm256_sub_pd(_mm256_sub_pd(t1, s1), y1);
+        s0 = t0;
+        s1 = t1;
+    }
+    double s[SUM_LANES], c[SUM_LANES];
+    _mm256_storeu_pd(s, s0); _mm256_storeu_pd(s + 4, s1);
+    _mm256_storeu_pd(c, c0); _mm256_storeu_pd(c + 4, c1);
+    sum_kahan_f64_lanes(x, i, n, s, c);
+    return sum_kahan_combine(s, c);
+}
+
+__attribute__((target("avx2")))
+static inline sum_pair simd_sum_f32_kahan_avx2(const float* restrict x, long long n) {
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    __m256d c0 = _mm256_setzero_pd(), c1 = _mm256_setzero_pd();
+    long long i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 xf = _mm256_loadu_ps(x + i);
+        __m256d y0 = _mm256_sub_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(xf)), c0);
+        __m256d y1 = _mm256_sub_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(xf, 1)), c1);
+        __m256d t0 = _mm256_add_pd(s0, y0);
+        __m256d t1 = _mm256_add_pd(s1, y1);
+        c0 = _mm256_sub_pd(_mm256_sub_pd(t0, s0), y0);
+        c1 = _mm256_sub_pd(_mm256_sub_pd(t1, s1), y1);
+        s0 = t0;
+        s1 = t1;
+    }
+    double s[SUM_LANES], c[SUM_LANES];
+    _mm256_storeu_pd(s, s0); _mm256_storeu_pd(s + 4, s1);
+    _mm256_storeu_pd(c, c0); _mm256_storeu_pd(c + 4, c1);
+    sum_kahan_f32_lanes(x, i, n, s, c);
+    return sum_kahan_combine(s, c);
+}
+
+__attribute__((target("avx2")))
+static inline void simd_add_avx2(const void* restrict va, const void* restrict vb, void* restrict vc, long long n) {
+    const int* a = (const int*)va;
+    const int* b = (const int*)vb;
+    int* c = (int*)vc;
+    long long i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+        _mm256_storeu_si256((__m256i*)(c + i), _mm256_add_epi32(x, y));
+    }
+    ew_add_i32(a + i, b + i, c + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static inline void simd_sub_avx2(const void* restrict va, const void* restrict vb, void* restrict vc, long long n) {
+    const int* a = (const int*)va;
+    const int* b = (const int*)vb;
+    int* c = (int*)vc;
+    long long i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+        _mm256_storeu_si256((__m256i*)(c + i), _mm256_sub_epi32(x, y));
+    }
+    ew_sub_i32(a + i, b + i, c + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static inline void simd_mul_avx2(const void* restrict va, const void* restrict vb, void* restrict vc, long long n) {
+    const int* a = (const int*)va;
+    const int* b = (const int*)vb;
+    int* c = (int*)vc;
+    long long i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+        _mm256_storeu_si256((__m256i*)(c + i), _mm256_mullo_epi32(x, y));
+    }
+    ew_mul_i32(a + i, b + i, c + i, n - i);
+}
+
+// Деление без ветвлений: частное по всем элементам, затем обнуление по маске b == 0
+__attribute__((target("avx2")))
+static inline __m256d simd_div4_avx2(__m128i x, __m128i y) {
+    __m128i nonzero = _mm_xor_si128(_mm_cmpeq_epi32(y, _mm_setzero_si128()), _mm_set1_epi32(-1));
+    __m256d mask = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(nonzero));
+    __m256d q = _mm256_div_pd(_mm256_cvtepi32_pd(x), _mm256_cvtepi32_pd(y));
+    return _mm256_and_pd(q, mask);
+}
+
+__attribute__((target("avx2")))
+static inline void simd_div_avx2(const void* restrict va, const void* restrict vb, double* restrict c, long long n) {
+    const int* a = (const int*)va;
+    const int* b = (const int*)vb;
+    long long i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+        _mm256_storeu_pd(c + i, simd_div4_avx2(x, y));
+    }
+    ew_div_i32(a + i, b + i, c + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static inline void simd_fused_avx2(const void* restrict va, const void* restrict vb, void* restrict vsum,
+                                   void* restrict vdiff, void* restrict vprod, double* restrict quot, long long n) {
+    const int* a = (const int*)va;
+    const int* b = (const int*)vb;
+    int* sum = (int*)vsum;
+    int* diff = (int*)vdiff;
+    int* prod = (int*)vprod;
+    long long i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+        _mm256_storeu_si256((__m256i*)(sum + i), _mm256_add_epi32(x, y));
+        _mm256_storeu_si256((__m256i*)(diff + i), _mm256_sub_epi32(x, y));
+        _mm256_storeu_si256((__m256i*)(prod + i), _mm256_mullo_epi32(x, y));
+        _mm256_storeu_pd(quot + i, simd_div4_avx2(_mm256_castsi256_si128(x), _mm256_castsi256_si128(y)));
+        _mm256_storeu_pd(quot + i + 4, simd_div4_avx2(_mm256_extracti128_si256(x, 1), _mm256_extracti128_si256(y, 1)));
+    }
+    ew_fused_i32(a + i, b + i, sum + i, diff + i, prod + i, quot + i, n - i);
+}
+
+// Потоковые записи по 16 байт: достаточно выравнивания malloc, общего для всех выходных массивов.
+// Если хотя бы один массив не выровнен на 16 байт, используется скалярный вариант MOVNTI
+__attribute__((target("avx2")))
+static inline void simd_fused_nt_avx2(const void* restrict va, const void* restrict vb, void* restrict vsum,
+                                      void* restrict vdiff, void* restrict vprod, double* restrict quot, long long n) {
+    const int* a = (const int*)va;
+    const int* b = (const int*)vb;
+    int* sum = (int*)vsum;
+    int* diff = (int*)vdiff;
+    int* prod = (int*)vprod;
+    if (((uintptr_t)sum | (uintptr_t)diff | (uintptr_t)prod | (uintptr_t)quot) & 15) {
+        ew_fused_nt_i32(a, b, sum, diff, prod, quot, n);
+        return;
+    }
+    long long i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+        __m256i s = _mm256_add_epi32(x, y);
+        __m256i d = _mm256_sub_epi32(x, y);
+        __m256i p = _mm256_mullo_epi32(x, y);
+        __m256d q0 = simd_div4_avx2(_mm256_castsi256_si128(x), _mm256_castsi256_si128(y));
+        __m256d q1 = simd_div4_avx2(_mm256_extracti128_si256(x, 1), _mm256_extracti128_si256(y, 1));
+        _mm_stream_si128((__m128i*)(sum + i), _mm256_castsi256_si128(s));
+        _mm_stream_si128((__m128i*)(sum + i + 4), _mm256_extracti128_si256(s, 1));
+        _mm_stream_si128((__m128i*)(diff + i), _mm256_castsi256_si128(d));
+        _mm_stream_si128((__m128i*)(diff + i + 4), _mm256_extracti128_si256(d, 1));
+        _mm_stream_si128((__m128i*)(prod + i), _mm256_castsi256_si128(p));
+        _mm_stream_si128((__m128i*)(prod + i + 4), _mm256_extracti128_si256(p, 1));
+        _mm_stream_pd(quot + i, _mm256_castpd256_pd128(q0));
+        _mm_stream_pd(quot + i + 2, _mm256_extractf128_pd(q0, 1));
+        _mm_stream_pd(quot + i + 4, _mm256_castpd256_pd128(q1));
+        _mm_stream_pd(quot + i + 6, _mm256_extractf128_pd(q1, 1));
+    }
+    ew_fused_nt_i32(a + i, b + i, sum + i, diff + i, prod + i, quot + i, n - i);
+}
+
+// ---------- AVX-512: 16 элементов int за итерацию ----------
+
+__attribute__((target("avx512f")))
+static inline int64_t simd_sum_i32_avx512(const int* restrict a, long long n) {
+    __m512i acc0 = _mm512_setzero_si512(), acc1 = _mm512_setzero_si512();
+    __m512i acc2 = _mm512_setzero_si512(), acc3 = _mm512_setzero_si512();
+    long long i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m512i x0 = _mm512_loadu_si512((const void*)(a + i));
+        __m512i x1 = _mm512_loadu_si512((const void*)(a + i + 16));
+        acc0 = _mm512_add_epi64(acc0, _mm512_cvtepi32_epi64(_mm512_castsi512_si256(x0)));
+        acc1 = _mm512_add_epi64(acc1, _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(x0, 1)));
+        acc2 = _mm512_add_epi64(acc2, _mm512_cvtepi32_epi64(_mm512_castsi512_si256(x1)));
+        acc3 = _mm512_add_epi64(acc3, _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(x1, 1)));
+    }
+    __m512i acc = _mm512_add_epi64(_mm512_add_epi64(acc0, acc1), _mm512_add_epi64(acc2, acc3));
+    return _mm512_reduce_add_epi64(acc) + sum_i32_wide(a + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+static inline void simd_add_avx512(const void* restrict va, const void* restrict vb, void* restrict vc, long long n) {
+    const int* a = (const int*)va;
+    const int* b = (const int*)vb;
+    int* c = (int*)vc;
+    long long i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i x = _mm512_loadu_si512((const void*)(a + i));
+        __m512i y = _mm512_loadu_si512((const void*)(b + i));
+        _mm512_storeu_si512((void*)(c + i), _mm512_add_epi32(x, y));
+    }
+    ew_add_i32(a + i, b + i, c + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+static inline void simd_sub_avx512(const void* restrict va, const void* restrict vb, void* restrict vc, long long n) {
+    const int* a = (const int*)va;
+    const int* b = (const int*)vb;
+    int* c = (int*)vc;
+    long long i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i x = _mm512_loadu_si512((const void*)(a + i));
+        __m512i y = _mm512_loadu_si512((const void*)(b + i));
+        _mm512_storeu_si512((void*)(c + i), _mm512_sub_epi32(x, y));
+    }
+    ew_sub_i32(a + i, b + i, c + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+static inline void simd_mul_avx512(const void* restrict va, const void* restrict vb, void* restrict vc, long long n) {
+    const int* a = (const int*)va;
+    const int* b = (const int*)vb;
+    int* c = (int*)vc;
+    long long i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i x = _mm512_loadu_si512((const void*)(a + i));
+        __m512i y = _mm512_loadu_si512((const void*)(b + i));
+        _mm512_storeu_si512((void*)(c + i), _mm512_mullo_epi32(x, y));
+    }
+    ew_mul_i32(a + i, b + i, c + i, n - i);
+}
+
+// Деление по маске: элементы с b == 0 не делятся и получают 0.0
+__attribute__((target("avx512f")))
+static inline __m512d simd_div8_avx512(__m256i x, __m256i y) {
+    __mmask8 nonzero = (__mmask8)_mm512_cmpneq_epi64_mask(_mm512_cvtepi32_epi64(y), _mm512_setzero_si512());
+    return _mm512_maskz_div_pd(nonzero, _mm512_cvtepi32_pd(x), _mm512_cvtepi32_pd(y));
+}
+
+__attribute__((target("avx512f")))
+static inline void simd_div_avx512(const void* restrict va, const void* restrict vb, double* restrict c, long long n) {
+    const int* a = (const int*)va;
+    const int* b = (const int*)vb;
+    long long i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+        _mm512_storeu_pd(c + i, simd_div8_avx512(x, y));
+    }
+    ew_div_i32(a + i, b + i, c + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+static inline void simd_fused_avx512(const void* restrict va, const void* restrict vb, void* restrict vsum,
+                                     void* restrict vdiff, void* restrict vprod, double* restrict quot, long long n) {
+    const int* a = (const int*)va;
+    const int* b = (const int*)vb;
+    int* sum = (int*)vsum;
+    int* diff = (int*)vdiff;
+    int* prod = (int*)vprod;
+    long long i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i x = _mm512_loadu_si512((const void*)(a + i));
+        __m512i y = _mm512_loadu_si512((const void*)(b + i));
+        _mm512_storeu_si512((void*)(sum + i), _mm512_add_epi32(x, y));
+        _mm512_storeu_si512((void*)(diff + i), _mm512_sub_epi32(x, y));
+        _mm512_storeu_si512((void*)(prod + i), _mm512_mullo_epi32(x, y));
+        _mm512_storeu_pd(quot + i, simd_div8_avx512(_mm512_castsi512_si256(x), _mm512_castsi512_si256(y)));
+        _mm512_storeu_pd(quot + i + 8, simd_div8_avx512(_mm512_extracti64x4_epi64(x, 1), _mm512_extracti64x4_epi64(y, 1)));
+    }
+    ew_fused_i32(a + i, b + i, sum + i, diff + i, prod + i, quot + i, n - i);
+}
+
+// ---------- int64, float, double: векторные расширения GCC ----------
+
+// Потоковая запись bytes байт (кратно 16) по 16 байт; dst выровнен на 16 байт
+static inline void simd_stream16(void* dst, const void* src, size_t bytes) {
+    for (size_t j = 0; j < bytes / 16; j++)
+        _mm_stream_si128((__m128i*)dst + j, _mm_loadu_si128((const __m128i*)src + j));
+}
+
+// Раздельное ядро op над векторами из bytes байт
+#define SIMD_EW_BINARY(isa, tgt, sfx, T, name, op)                                                   \
+__attribute__((target(tgt)))                                                                         \
+static inline void simd_##name##_##sfx##_##isa(const void* restrict va, const void* restrict vb,     \
+                                                void* restrict vc, long long n) {                    \
+    const T* a = (const T*)va;                                                                       \
+    const T* b = (const T*)vb;                                                                       \
+    T* c = (T*)vc;                                                                                   \
+    long long i = 0;                                                                                 \
+    for (; i + (long long)(sizeof(simd_##sfx##_##isa##_v) / sizeof(T)) <= n;                         \
+         i += sizeof(simd_##sfx##_##isa##_v) / sizeof(T)) {                                          \
+        simd_##sfx##_##isa##_v x, y, r;                                                              \
+        memcpy(&x, a + i, sizeof(x));                                                                \
+        memcpy(&y, b + i, sizeof(y));                                                                \
+        r = x op y;                                                                                  \
+        memcpy(c + i, &r, sizeof(r));                                                                \
+    }                                                                                                \
+    ew_##name##_##sfx(a + i, b + i, c + i, n - i);                                                   \
+}
+
+// Ядра типа T для векторов из bytes байт: _v — операнды, _q — частные (double той же длины
+// в элементах), _m — маска ненулевых делителей. Деление без ветвлений, как в simd_div4_avx2
+#define SIMD_EW_DEFINE(isa, tgt, bytes, sfx, T)                                                      \
+typedef T simd_##sfx##_##isa##_v __attribute__((vector_size(bytes)));                                \
+typedef double simd_##sfx##_##isa##_q __attribute__((vector_size(bytes / sizeof(T) * sizeof(double))));  \
+typedef long long simd_##sfx##_##isa##_m __attribute__((vector_size(bytes / sizeof(T) * sizeof(double)))); \
+                                                                                                     \
+SIMD_EW_BINARY(isa, tgt, sfx, T, add, +)                                                             \
+SIMD_EW_BINARY(isa, tgt, sfx, T, sub, -)                                                             \
+SIMD_EW_BINARY(isa, tgt, sfx, T, mul, *)                                                             \
+                                                                                                     \
+/* Частное по всем элементам, затем обнуление по маске b == 0; запись в out */                      \
+__attribute__((target(tgt)))                                                                         \
+static inline void simd_quot_##sfx##_##isa(double* out, const T* a, const T* b) {                    \
+    simd_##sfx##_##isa##_v x, y;                                                                     \
+    memcpy(&x, a, sizeof(x));                                                                        \
+    memcpy(&y, b, sizeof(y));                                                                        \
+    simd_##sfx##_##isa##_q zero = { 0 };                                                             \
+    simd_##sfx##_##isa##_q xd = __builtin_convertvector(x, simd_##sfx##_##isa##_q);                  \
+    simd_##sfx##_##isa##_q yd = __builtin_convertvector(y, simd_##sfx##_##isa##_q);                  \
+    simd_##sfx##_##isa##_m q = (simd_##sfx##_##isa##_m)(xd / yd) & (yd != zero);                     \
+    memcpy(out, &q, sizeof(q));                                                                      \
+}                                                                                                    \
+                                                                                                     \
+__attribute__((target(tgt)))                                                                         \
+static inline void simd_div_##sfx##_##isa(const void* restrict va, const void* restrict vb,          \
+                                          double* restrict c, long long n) {                         \
+    const T* a = (const T*)va;                                                                       \
+    const T* b = (const T*)vb;                                                                       \
+    const long long lanes = sizeof(simd_##sfx##_##isa##_v) / sizeof(T);                              \
+    long long i = 0;                                                                                 \
+    for (; i + lanes <= n; i += lanes)                                                               \
+        simd_quot_##sfx##_##isa(c + i, a + i, b + i);                                                \
+    ew_div_##sfx(a + i, b + i, c + i, n - i);                                                        \
+}                                                                                                    \
+                                                                                                     \
+__attribute__((target(tgt)))                                                                         \
+static inline void simd_fused_##sfx##_##isa(const void* restrict va, const void* restrict vb,        \
+                                            void* restrict vsum, void* restrict vdiff,               \
+                                            void* restrict vprod, double* restrict quot, long long n) { \
+    const T* a = (const T*)va;                                                                       \
+    const T* b = (const T*)vb;                                                                       \
+    T* sum = (T*)vsum;                                                                               \
+    T* diff = (T*)vdiff;                                                                             \
+    T* prod = (T*)vprod;                                                                             \
+    const long long lanes = sizeof(simd_##sfx##_##isa##_v) / sizeof(T);                              \
+    long long i = 0;                                                                                 \
+    for (; i + lanes <= n; i += lanes) {                                                             \
+        simd_##sfx##_##isa##_v x, y, r;                                                              \
+        memcpy(&x, a + i, sizeof(x));                                                                \
+        memcpy(&y, b + i, sizeof(y));                                                                \
+        r = x + y; memcpy(sum + i, &r, sizeof(r));                                                   \
+        r = x - y; memcpy(diff + i, &r, sizeof(r));                                                  \
+        r = x * y; memcpy(prod + i, &r, sizeof(r));                                                  \
+        simd_quot_##sfx##_##isa(quot + i, a + i, b + i);                                             \
+    }                                                                                                \
+    ew_fused_##sfx(a + i, b + i, sum + i, diff + i, prod + i, quot + i, n - i);                      \
+}                                                                                                    \
+                                                                                                     \
+/* Потоковые записи по 16 байт; без выравнивания на 16 байт — скалярный вариант MOVNTI */           \
+__attribute__((target(tgt)))                                                                         \
+static inline void simd_fused_nt_##sfx##_##isa(const void* restrict va, const void* restrict vb,     \
+                                               void* restrict vsum, void* restrict vdiff,            \
+                                               void* restrict vprod, double* restrict quot, long long n) { \
+    if (((uintptr_t)vsum | (uintptr_t)vdiff | (uintptr_t)vprod | (uintptr_t)quot) & 15) {            \
+        ew_fused_nt_##sfx(va, vb, vsum, vdiff, vprod, quot, n);                                      \
+        return;                                                                                      \
+    }                                                                                                \
+    const T* a = (const T*)va;                                                                       \
+    const T* b = (const T*)vb;                                                                       \
+    T* sum = (T*)vsum;                                                                               \
+    T* diff = (T*)vdiff;                                                                             \
+    T* prod = (T*)vprod;                                                                             \
+    const long long lanes = sizeof(simd_##sfx##_##isa##_v) / sizeof(T);                              \
+    long long i = 0;                                                                                 \
+    for (; i + lanes <= n; i += lanes) {                                                             \
+        simd_##sfx##_##isa##_v x, y, r;                                                              \
+        double q[sizeof(simd_##sfx##_##isa##_v) / sizeof(T)];                                        \
+        memcpy(&x, a + i, sizeof(x));                                                                \
+        memcpy(&y, b + i, sizeof(y));                                                                \
+        r = x + y; simd_stream16(sum + i, &r, sizeof(r));                                            \
+        r = x - y; simd_stream16(diff + i, &r, sizeof(r));                                           \
+        r = x * y; simd_stream16(prod + i, &r, sizeof(r));                                           \
+        simd_quot_##sfx##_##isa(q, a + i, b + i);                                                    \
+        simd_stream16(quot + i, q, sizeof(q));                                                       \
+    }                                                                                                \
+    ew_fused_nt_##sfx(a + i, b + i, sum + i, diff + i, prod + i, quot + i, n - i);                   \
+}
+
+// Типы с ядрами из векторных расширений (int — на интринсиках выше)
+#define SIMD_GENERIC_TYPES(X) X(i64, int64_t) X(f32, float) X(f64, double)
+
+#define SIMD_EW_AVX2(sfx, T) SIMD_EW_DEFINE(avx2, "avx2", 32, sfx, T)
+#define SIMD_EW_AVX512(sfx, T) SIMD_EW_DEFINE(avx512, "avx512f", 64, sfx, T)
+SIMD_GENERIC_TYPES(SIMD_EW_AVX2)
+SIMD_GENERIC_TYPES(SIMD_EW_AVX512)
+
+// Потоковый вариант всегда из AVX2: 16-байтные потоковые записи не требуют
+// выравнивания выходных массивов на 64 байта
+#define SIMD_EW_ENTRY(isa, sfx)                                                                      \
+    { simd_add_##sfx##_##isa, simd_sub_##sfx##_##isa, simd_mul_##sfx##_##isa, simd_div_##sfx##_##isa, \
+      simd_fused_##sfx##_##isa, simd_fused_nt_##sfx##_avx2 }
+
+static const simd_kernels simd_avx2 = {
+    "avx2", simd_sum_i32_avx2, simd_sum_f64_kahan_avx2, simd_sum_f32_kahan_avx2,
+    { { simd_add_avx2, simd_sub_avx2, simd_mul_avx2, simd_div_avx2, simd_fused_avx2, simd_fused_nt_avx2 },
+      SIMD_EW_ENTRY(avx2, i64), SIMD_EW_ENTRY(avx2, f32), SIMD_EW_ENTRY(avx2, f64) }
+};
+
+// Суммы Кэхэна и потоковый вариант берутся из AVX2: эти ядра упираются в память,
+// а 16-байтные потоковые записи не требуют выравнивания выходных массивов на 64 байта
+static const simd_kernels simd_avx512 = {
+    "avx512", simd_sum_i32_avx512, simd_sum_f64_kahan_avx2, simd_sum_f32_kahan_avx2,
+    { { simd_add_avx512, simd_sub_avx512, simd_mul_avx512, simd_div_avx512, simd_fused_avx512, simd_fused_nt_avx2 },
+      SIMD_EW_ENTRY(avx512, i64), SIMD_EW_ENTRY(avx512, f32), SIMD_EW_ENTRY(avx512, f64) }
+};
+
+#endif
+
+// Выбор варианта: "auto" — лучший из поддерживаемых процессором,
+// "scalar", "avx2", "avx512" — явно. NULL, если вариант недоступен
+static inline const simd_kernels* simd_select(const char* request) {
+    if (strcmp(request, "scalar") == 0)
+        return &simd_scalar;
+#if SIMD_X86
+    __builtin_cpu_init();
+    int have_avx2 = __builtin_cpu_supports("avx2");
+    int have_avx512 = __builtin_cpu_supports("avx512f");
+    if (strcmp(request, "avx512") == 0)
+        return have_avx512 ? &simd_avx512 : NULL;
+    if (strcmp(request, "avx2") == 0)
+        return have_avx2 ? &simd_avx2 : NULL;
+    if (strcmp(request, "auto") == 0)
+        return have_avx512 ? &simd_avx512 : have_avx2 ? &simd_avx2 : &simd_scalar;
+#else
+    if (strcmp(request, "auto") == 0)
+        return &simd_scalar;
+#endif
+    return NULL;
+}
+
+// Самопроверка поэлементных ядер типа T: результаты k на небольших массивах (с нулями
+// в делителе, отрицательными числами и хвостом некратной длины) должны совпадать
+// с эталонными ref побитово
+#define SIMD_CHECK_DEFINE(sfx, T)                                                                    \
+static inline int simd_selfcheck_##sfx(const ew_kernels* k, const ew_kernels* ref) {                 \
+    enum { N = 1027 };                                                                               \
+    static T a[N], b[N], s0[N], s1[N], d0[N], d1[N], p0[N], p1[N];                                   \
+    static double q0[N], q1[N];                                                                      \
+    for (int i = 0; i < N; i++) {                                                                    \
+        a[i] = (T)((i * 7919) % 2001 - 1000) * (T)1.25;                                              \
+        b[i] = i % 13 == 0 ? 0 : (T)((i * 104729) % 199 - 99) * (T)1.25;                             \
+    }                                                                                                \
+                                                                                                     \
+    ref->add(a, b, s0, N); k->add(a, b, s1, N);                                                      \
+    int ok = memcmp(s0, s1, sizeof(s0)) == 0;                                                        \
+    ref->sub(a, b, s0, N); k->sub(a, b, s1, N);                                                      \
+    ok &= memcmp(s0, s1, sizeof(s0)) == 0;                                                           \
+    ref->mul(a, b, s0, N); k->mul(a, b, s1, N);                                                      \
+    ok &= memcmp(s0, s1, sizeof(s0)) == 0;                                                           \
+    ref->div(a, b, q0, N); k->div(a, b, q1, N);                                                      \
+    ok &= memcmp(q0, q1, sizeof(q0)) == 0;                                                           \
+                                                                                                     \
+    ref->fused(a, b, s0, d0, p0, q0, N);                                                             \
+    k->fused(a, b, s1, d1, p1, q1, N);                                                               \
+    ok &= memcmp(s0, s1, sizeof(s0)) == 0 && memcmp(d0, d1, sizeof(d0)) == 0                         \
+          && memcmp(p0, p1, sizeof(p0)) == 0 && memcmp(q0, q1, sizeof(q0)) == 0;                     \
+    k->fused_nt(a, b, s1, d1, p1, q1, N);                                                            \
+    ok &= memcmp(s0, s1, sizeof(s0)) == 0 && memcmp(d0, d1, sizeof(d0)) == 0                         \
+          && memcmp(p0, p1, sizeof(p0)) == 0 && memcmp(q0, q1, sizeof(q0)) == 0;                     \
+    return ok;                                                                                       \
+}
+
+DTYPE_FOREACH(SIMD_CHECK_DEFINE)
+
+// Самопроверка варианта k: суммы и поэлементные ядра всех типов. Возвращает 1 при совпадении
+static inline int simd_selfcheck(const simd_kernels* k) {
+    enum { N = 1027 };
+    static int a[N];
+    for (int i = 0; i < N; i++)
+        a[i] = (i * 7919) % 2001 - 1000;
+
+    int ok = k->sum_i32(a, N) == simd_scalar.sum_i32(a, N);
+
+    // Кэхэн: одинаковая раскладка по линиям даёт побитово равный результат
+    static double x64[N];
+    static float x32[N];
+    for (int i = 0; i < N; i++) {
+        x64[i] = a[i] * 0.001 + 1e8 * (i % 3);
+        x32[i] = (float)x64[i];
+    }
+    sum_pair r0 = simd_scalar.sum_f64_kahan(x64, N), r1 = k->sum_f64_kahan(x64, N);
+    ok &= r0.sum == r1.sum && r0.err == r1.err;
+    r0 = simd_scalar.sum_f32_kahan(x32, N);
+    r1 = k->sum_f32_kahan(x32, N);
+    ok &= r0.sum == r1.sum && r0.err == r1.err;
+
+#define SIMD_CHECK_ENTRY(sfx, T) simd_selfcheck_##sfx,
+    static int (*const checks[DTYPE_COUNT])(const ew_kernels*, const ew_kernels*) = { DTYPE_FOREACH(SIMD_CHECK_ENTRY) };
+#undef SIMD_CHECK_ENTRY
+    for (int t = 0; t < DTYPE_COUNT; t++)
+        ok &= checks[t](&k->ew[t], &simd_scalar.ew[t]);
+    return ok;
+}
+
+// Выбор варианта по параметру --simd с самопроверкой. При расхождении со скалярным
+// вариантом печатает предупреждение (если verbose) и возвращает скалярный вариант;
+// NULL, если запрошенный вариант не поддерживается процессором
+static inline const simd_kernels* simd_setup(const char* request, int verbose) {
+    const simd_kernels* k = simd_select(request);
+    if (k && k != &simd_scalar && !simd_selfcheck(k)) {
+        if (verbose)
+            printf("Предупреждение: вариант %s не прошёл самопроверку, используется scalar\n", k->name);
+        k = &simd_scalar;
+    }
+    return k;
+}
+
+// Запуск поэлементного ядра на всех потоках процесса: каждый поток обрабатывает
+// свой отрезок блока (см. threads_range); elem — размер элемента операндов
+static inline void simd_run_binary(ew_binary_fn fn, size_t elem, const void* a, const void* b, void* out,
+                                   long long n) {
+#pragma omp parallel
+    {
+        long long from, count;
+        threads_range(n, &from, &count);
+        fn((const char*)a + from * elem, (const char*)b + from * elem, (char*)out + from * elem, count);
+    }
+}
+
+static inline void simd_run_div(ew_div_fn fn, size_t elem, const void* a, const void* b, double* out,
+                                long long n) {
+#pragma omp parallel
+    {
+        long long from, count;
+        threads_range(n, &from, &count);
+        fn((const char*)a + from * elem, (const char*)b + from * elem, out + from, count);
+    }
+}
+
+static inline void simd_run_fused(ew_fused_fn fn, const ew_arrays* l, long long n) {
+#pragma omp parallel
+    {
+        long long from, count;
+        threads_range(n, &from, &count);
+        ew_arrays p = ew_slice(l, from);
+        fn(p.a, p.b, p.sum, p.diff, p.prod, p.quot, count);
+    }
+}
+
+// Все четыре операции над отрезком from..from+count-1 блока l ядрами его типа:
+// совмещённым ядром (fused, с потоковыми записями при use_nt) или четырьмя проходами
+static inline void simd_run_all(const simd_kernels* k, int fused, int use_nt, const ew_arrays* l,
+                                long long from, long long count) {
+    const ew_kernels* e = &k->ew[l->type];
+    size_t elem = dtype_size(l->type);
+    ew_arrays p = ew_slice(l, from);
+    if (fused) {
+        simd_run_fused(use_nt ? e->fused_nt : e->fused, &p, count);
+    } else {
+        simd_run_binary(e->add, elem, p.a, p.b, p.sum, count);
+        simd_run_binary(e->sub, elem, p.a, p.b, p.diff, count);
+        simd_run_binary(e->mul, elem, p.a, p.b, p.prod, count);
+        simd_run_div(e->div, elem, p.a, p.b, p.quot, count);
+    }
+}
+
+#endif
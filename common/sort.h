@@ -0,0 +1,344 @@
+#ifndef COMMON_SORT_H
+#define COMMON_SORT_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dtype.h"
+
+// Локальные ядра сортировки: интроспективная сортировка, k-путевое слияние уже
+// отсортированных отрезков и слияние-разделение (для элементов любого типа из dtype.h),
+// поразрядная LSD-сортировка (для int). Ядра сравнения порождаются макросом SORT_DEFINE
+// для каждого типа; sort_table[dtype] собирает их для выбора по --dtype.
+// Ядра не выделяют память сами: рабочие буферы (кучу слияния, строки и счётчики
+// поразрядной сортировки) передаёт вызывающий, чтобы выделение не попадало в замер.
+
+#define SORT_INSERTION_THRESHOLD 16
+
+#define SORT_DEFINE(sfx, T)                                                                          \
+/* Сортировка вставками для коротких отрезков */                                                    \
+static inline void sort_insertion_##sfx(T* arr, long long n) {                                       \
+    for (long long i = 1; i < n; i++) {                                                              \
+        T key = arr[i];                                                                              \
+        long long j = i - 1;                                                                         \
+        while (j >= 0 && arr[j] > key) {                                                             \
+            arr[j + 1] = arr[j];                                                                     \
+            j--;                                                                                     \
+        }                                                                                            \
+        arr[j + 1] = key;                                                                            \
+    }                                                                                                \
+}                                                                                                    \
+                                                                                                     \
+/* Просеивание вниз в max-куче */                                                                   \
+static inline void sort_sift_down_##sfx(T* arr, long long root, long long n) {                       \
+    for (;;) {                                                                                       \
+        long long child = 2 * root + 1;                                                              \
+        if (child >= n)                                                                              \
+            break;                                                                                   \
+        if (child + 1 < n && arr[child + 1] > arr[child])                                            \
+            child++;                                                                                 \
+        if (arr[root] >= arr[child])                                                                 \
+            break;                                                                                   \
+        T tmp = arr[root]; arr[root] = arr[child]; arr[child] = tmp;                                 \
+        root = child;                                                                                \
+    }                                                                                                \
+}                                                                                                    \
+                                                                                                     \
+/* Пирамидальная сортировка: запасной вариант при слишком глубокой рекурсии */                      \
+static inline void sort_heap_##sfx(T* arr, long long n) {                                            \
+    for (long long i = n / 2 - 1; i >= 0; i--)                                                       \
+        sort_sift_down_##sfx(arr, i, n);                                                             \
+    for (long long i = n - 1; i > 0; i--) {                                                          \
+        T tmp = arr[0]; arr[0] = arr[i]; arr[i] = tmp;                                               \
+        sort_sift_down_##sfx(arr, 0, i);                                                             \
+    }                                                                                                \
+}                                                                                                    \
+                                                                                                     \
+/* Медиана из трёх как опорный элемент */                                                           \
+static inline T sort_median3_##sfx(T a, T b, T c) {                                                  \
+    if (a < b) {                                                                                     \
+        if (b < c) return b;                                                                         \
+        return a < c ? c : a;                                                                        \
+    }                                                                                                \
+    if (a < c) return a;                                                                             \
+    return b < c ? c : b;                                                                            \
+}                                                                                                    \
+                                                                                                     \
+static inline void sort_intro_rec_##sfx(T* arr, long long n, int depth) {                            \
+    while (n > SORT_INSERTION_THRESHOLD) {                                                           \
+        if (depth-- == 0) {                                                                          \
+            sort_heap_##sfx(arr, n);                                                                 \
+            return;                                                                                  \
+        }                                                                                            \
+                                                                                                     \
+        /* Разбиение Хоара относительно медианы трёх */                                             \
+        T pivot = sort_median3_##sfx(arr[0], arr[n / 2], arr[n - 1]);                                \
+        long long i = -1, j = n;                                                                     \
+        for (;;) {                                                                                   \
+            do { i++; } while (arr[i] < pivot);                                                      \
+            do { j--; } while (arr[j] > pivot);                                                      \
+            if (i >= j)                                                                              \
+                break;                                                                               \
+            T tmp = arr[i]; arr[i] = arr[j]; arr[j] = tmp;                                           \
+        }                                                                                            \
+                                                                                                     \
+        /* Рекурсия по меньшей части, цикл по большей */                                            \
+        long long left = j + 1;                                                                      \
+        if (left < n - left) {                                                                       \
+            sort_intro_rec_##sfx(arr, left, depth);                                                  \
+            arr += left;                                                                             \
+            n -= left;                                                                               \
+        } else {                                                                                     \
+            sort_intro_rec_##sfx(arr + left, n - left, depth);                                       \
+            n = left;                                                                                \
+        }                                                                                            \
+    }                                                                                                \
+    sort_insertion_##sfx(arr, n);                                                                    \
+}                                                                                                    \
+                                                                                                     \
+/* Интроспективная сортировка: быстрая сортировка с переходом                                       \
+   на пирамидальную при глубине рекурсии больше 2*log2(n) */                                        \
+static inline void sort_##sfx(void* data, long long n) {                                             \
+    int depth = 0;                                                                                   \
+    for (long long m = n; m > 1; m >>= 1)                                                            \
+        depth += 2;                                                                                  \
+    sort_intro_rec_##sfx((T*)data, n, depth);                                                        \
+}                                                                                                    \
+                                                                                                     \
+/* Элемент кучи для k-путевого слияния */                                                           \
+typedef struct {                                                                                     \
+    T value;                                                                                         \
+    int run;                                                                                         \
+} sort_heap_node_##sfx;                                                                              \
+                                                                                                     \
+static inline void sort_merge_sift_##sfx(sort_heap_node_##sfx* heap, int root, int n) {              \
+    for (;;) {                                                                                       \
+        int child = 2 * root + 1;                                                                    \
+        if (child >= n)                                                                              \
+            break;                                                                                   \
+        if (child + 1 < n && heap[child + 1].value < heap[child].value)                              \
+            child++;                                                                                 \
+        if (heap[root].value <= heap[child].value)                                                   \
+            break;                                                                                   \
+        sort_heap_node_##sfx tmp = heap[root];                                                       \
+        heap[root] = heap[child];                                                                    \
+        heap[child] = tmp;                                                                           \
+        root = child;                                                                                \
+    }                                                                                                \
+}                                                                                                    \
+                                                                                                     \
+/* k-путевое слияние k отсортированных отрезков runs[r] длины lens[r] в out;                      \
+   scratch — рабочий буфер из sort_kway_scratch(k) байт, выровненный на 8 */                       \
+static inline void sort_kway_merge_##sfx(void* const* runs, const long long* lens, int k, void* data, \
+                                         void* scratch) {                                            \
+    T* out = (T*)data;                                                                               \
+    long long* pos = (long long*)scratch;                                                            \
+    sort_heap_node_##sfx* heap = (sort_heap_node_##sfx*)(pos + (k > 0 ? k : 1));                     \
+    memset(pos, 0, sizeof(long long) * (k > 0 ? k : 1));                                             \
+    int n = 0;                                                                                       \
+                                                                                                     \
+    for (int r = 0; r < k; r++) {                                                                    \
+        if (lens[r] > 0) {                                                                           \
+            heap[n].value = ((const T*)runs[r])[0];                                                  \
+            heap[n].run = r;                                                                         \
+            n++;                                                                                     \
+        }                                                                                            \
+    }                                                                                                \
+    for (int i = n / 2 - 1; i >= 0; i--)                                                             \
+        sort_merge_sift_##sfx(heap, i, n);                                                           \
+                                                                                                     \
+    long long out_pos = 0;                                                                           \
+    while (n > 0) {                                                                                  \
+        int r = heap[0].run;                                                                         \
+        out[out_pos++] = heap[0].value;                                                              \
+        if (++pos[r] < lens[r]) {                                                                    \
+            heap[0].value = ((const T*)runs[r])[pos[r]];                                             \
+        } else {                                                                                     \
+            heap[0] = heap[--n];                                                                     \
+        }                                                                                            \
+        sort_merge_sift_##sfx(heap, 0, n);                                                           \
+    }                                                                                                \
+}                                                                                                    \
+                                                                                                     \
+/* Индекс первого элемента, большего *value (массив отсортирован) */                                \
+static inline long long sort_upper_bound_##sfx(const void* data, long long n, const void* value) {   \
+    const T* arr = (const T*)data;                                                                   \
+    T v = *(const T*)value;                                                                          \
+    long long lo = 0, hi = n;                                                                        \
+    while (lo < hi) {                                                                                \
+        long long mid = lo + (hi - lo) / 2;                                                          \
+        if (arr[mid] <= v)                                                                           \
+            lo = mid + 1;                                                                            \
+        else                                                                                         \
+            hi = mid;                                                                                \
+    }                                                                                                \
+    return lo;                                                                                       \
+}                                                                                                    \
+                                                                                                     \
+/* Слияние-разделение для младшего ранга: из своего блока длины n и блока соседа                    \
+   длины m оставляет n наименьших элементов, сливая с начала. O(n) */                               \
+static inline void sort_merge_split_low_##sfx(const void* vmine, int n, const void* vother, int m,  \
+                                              void* vout) {                                          \
+    const T* mine = (const T*)vmine;                                                                 \
+    const T* other = (const T*)vother;                                                               \
+    T* out = (T*)vout;                                                                               \
+    int i = 0, j = 0;                                                                                \
+    for (int k = 0; k < n; ++k)                                                                      \
+        out[k] = (j >= m || (i < n && mine[i] <= other[j])) ? mine[i++] : other[j++];                \
+}                                                                                                    \
+                                                                                                     \
+/* Слияние-разделение для старшего ранга: оставляет n наибольших элементов, сливая с конца */       \
+static inline void sort_merge_split_high_##sfx(const void* vmine, int n, const void* vother, int m, \
+                                               void* vout) {                                         \
+    const T* mine = (const T*)vmine;                                                                 \
+    const T* other = (const T*)vother;                                                               \
+    T* out = (T*)vout;                                                                               \
+    int i = n - 1, j = m - 1;                                                                        \
+    for (int k = n - 1; k >= 0; --k)                                                                 \
+        out[k] = (j < 0 || (i >= 0 && mine[i] > other[j])) ? mine[i--] : other[j--];                 \
+}                                                                                                    \
+                                                                                                     \
+/* Упорядоченность отрезка по неубыванию */                                                         \
+static inline int sort_is_sorted_##sfx(const void* data, long long n) {                              \
+    const T* arr = (const T*)data;                                                                   \
+    for (long long i = 1; i < n; i++)                                                                \
+        if (arr[i - 1] > arr[i])                                                                     \
+            return 0;                                                                                \
+    return 1;                                                                                        \
+}                                                                                                    \
+                                                                                                     \
+static inline int sort_less_##sfx(const void* a, const void* b) {                                    \
+    return *(const T*)a < *(const T*)b;                                                              \
+}
+
+DTYPE_FOREACH(SORT_DEFINE)
+
+// Размер рабочего буфера k-путевого слияния: позиции в отрезках и куча (узел любого типа
+// не больше узла int64: 8-байтное значение и номер отрезка)
+static inline size_t sort_kway_scratch(int k) {
+    return (size_t)(k > 0 ? k : 1) * (sizeof(long long) + sizeof(sort_heap_node_i64));
+}
+
+// Ядра сортировки одного типа элементов
+typedef struct {
+    void (*sort)(void*, long long);
+    void (*kway_merge)(void* const*, const long long*, int, void*, void*);
+    long long (*upper_bound)(const void*, long long, const void*);
+    void (*merge_split_low)(const void*, int, const void*, int, void*);
+    void (*merge_split_high)(const void*, int, const void*, int, void*);
+    int (*is_sorted)(const void*, long long);
+    int (*less)(const void*, const void*);
+} sort_kernels;
+
+#define SORT_TABLE_ENTRY(sfx, T)                                                                     \
+    { sort_##sfx, sort_kway_merge_##sfx, sort_upper_bound_##sfx, sort_merge_split_low_##sfx,         \
+      sort_merge_split_high_##sfx, sort_is_sorted_##sfx, sort_less_##sfx },
+
+static const sort_kernels sort_table[DTYPE_COUNT] = { DTYPE_FOREACH(SORT_TABLE_ENTRY) };
+
+// Поразрядная LSD-сортировка для ключей из ограниченного диапазона.
+// Ключи сдвигаются на минимум диапазона, поэтому подходят и отрицательные числа;
+// число проходов определяется шириной диапазона, а не разрядностью int.
+
+#define RADIX_MAX_BITS 11
+#define RADIX_WC_LINE 16  // элементов int в одной 64-байтной строке кэша
+#define RADIX_BUCKETS ((size_t)1 << RADIX_MAX_BITS)
+// Рабочий буфер radix_scatter: строки объединения записи, смещения и заполнение корзин
+#define RADIX_SCATTER_SCRATCH (RADIX_BUCKETS * (sizeof(int) * RADIX_WC_LINE + sizeof(long long) + sizeof(int)))
+// Рабочий буфер sort_radix: то же и гистограмма разряда
+#define RADIX_SCRATCH (RADIX_SCATTER_SCRATCH + RADIX_BUCKETS * sizeof(long long))
+
+// Минимум и максимум ключей массива
+static inline void sort_key_range(const int* arr, long long n, int* min_out, int* max_out) {
+    int lo = n > 0 ? arr[0] : 0, hi = lo;
+    for (long long i = 1; i < n; i++) {
+        if (arr[i] < lo) lo = arr[i];
+        if (arr[i] > hi) hi = arr[i];
+    }
+    *min_out = lo;
+    *max_out = hi;
+}
+
+// Разбиение ширины диапазона на проходы: не больше RADIX_MAX_BITS бит на проход,
+// биты распределяются между проходами поровну
+static inline void radix_plan(int min_key, int max_key, int* passes, int* digit_bits) {
+    unsigned int span = (unsigned int)max_key - (unsigned int)min_key;
+    int bits = 0;
+    while (bits < 32 && (span >> bits) != 0)
+        bits++;
+    *passes = bits == 0 ? 0 : (bits + RADIX_MAX_BITS - 1) / RADIX_MAX_BITS;
+    *digit_bits = *passes == 0 ? 0 : (bits + *passes - 1) / *passes;
+}
+
+static inline unsigned int radix_digit(int key, int min_key, int shift, unsigned int mask) {
+    return (((unsigned int)key - (unsigned int)min_key) >> shift) & mask;
+}
+
+// Гистограмма разряда: hist[b] — число ключей с цифрой b
+static inline void radix_histogram(const int* src, long long n, int min_key, int shift, int digit_bits,
+                                   long long* hist) {
+    unsigned int mask = (1u << digit_bits) - 1;
+    memset(hist, 0, sizeof(long long) * ((size_t)1 << digit_bits));
+    for (long long i = 0; i < n; i++)
+        hist[radix_digit(src[i], min_key, shift, mask)]++;
+}
+
+// Устойчивое распределение по цифре с программным объединением записи:
+// элементы копятся в буфере на строку кэша для каждой корзины и
+// выгружаются в dst целыми строками. hist — гистограмма этого разряда,
+// scratch — рабочий буфер из RADIX_SCATTER_SCRATCH байт, выровненный на 64.
+static inline void radix_scatter(const int* src, int* dst, long long n, int min_key, int shift,
+                                 int digit_bits, const long long* hist, void* scratch) {
+    size_t buckets = (size_t)1 << digit_bits;
+    unsigned int mask = (unsigned int)buckets - 1;
+    int* lines = (int*)scratch;
+    long long* offsets = (long long*)(lines + RADIX_WC_LINE * RADIX_BUCKETS);
+    int* fill = (int*)(offsets + RADIX_BUCKETS);
+    memset(fill, 0, sizeof(int) * buckets);
+
+    long long sum = 0;
+    for (size_t b = 0; b < buckets; b++) {
+        offsets[b] = sum;
+        sum += hist[b];
+    }
+
+    for (long long i = 0; i < n; i++) {
+        unsigned int b = radix_digit(src[i], min_key, shift, mask);
+        int* line = lines + (size_t)b * RADIX_WC_LINE;
+        line[fill[b]++] = src[i];
+        if (fill[b] == RADIX_WC_LINE) {
+            memcpy(dst + offsets[b], line, sizeof(int) * RADIX_WC_LINE);
+            offsets[b] += RADIX_WC_LINE;
+            fill[b] = 0;
+        }
+    }
+
+    // Выгрузка неполных строк
+    for (size_t b = 0; b < buckets; b++) {
+        if (fill[b] > 0)
+            memcpy(dst + offsets[b], lines + b * RADIX_WC_LINE, sizeof(int) * fill[b]);
+    }
+}
+
+// Поразрядная сортировка arr с ключами из [min_key, max_key]; tmp — буфер длины n,
+// scratch — рабочий буфер из RADIX_SCRATCH байт, выровненный на 64
+static inline void sort_radix(int* arr, long long n, int* tmp, int min_key, int max_key, void* scratch) {
+    int passes, digit_bits;
+    radix_plan(min_key, max_key, &passes, &digit_bits);
+
+    long long* hist = (long long*)((char*)scratch + RADIX_SCATTER_SCRATCH);
+    int* src = arr;
+    int* dst = tmp;
+    for (int p = 0; p < passes; p++) {
+        int shift = p * digit_bits;
+        radix_histogram(src, n, min_key, shift, digit_bits, hist);
+        radix_scatter(src, dst, n, min_key, shift, digit_bits, hist, scratch);
+        int* t = src;
+        src = dst;
+        dst = t;
+    }
+    if (src != arr)
+        memcpy(arr, src, sizeof(int) * n);
+}
+
+#endif
@@ -0,0 +1,187 @@
+#ifndef COMMON_STREAM_H
+#define COMMON_STREAM_H
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+
+#include "args.h"
+
+// Потоковая обработка массивов больше памяти (--stream=<элементов окна>).
+// Блок процесса проходится окнами фиксированного размера: окно читается из файла
+// или генерируется по глобальным индексам, обрабатывается, результат копится или
+// дописывается в файл, и окно используется снова. Окон два (двойная буферизация):
+// пока ядро считает окно k, чтение окна k+1 и запись результатов окна k-1 идут
+// неблокирующими MPI_File_iread_at / MPI_File_iwrite_at. Обращения независимые
+// (не коллективные), поэтому процессы с разным числом окон друг друга не ждут.
+// Память процесса — два окна, сколько бы элементов ни было в блоке.
+// С --dynamic окна всего массива раздаются не блоками, а по одному из общей очереди
+// (stream_queue): процесс, закончивший окно, берёт следующее атомарным MPI_Fetch_and_op
+// над счётчиком на процессе 0, поэтому более быстрые процессы обрабатывают больше окон.
+
+// Окна блока first..first+count-1 (глобальные индексы)
+typedef struct {
+    long long first, count;
+    long long window;  // элементов в окне (последнее может быть короче)
+    long long windows;
+} stream_plan;
+
+// Разбор --stream=<элементов окна> с суффиксами K/M/G: 0 — режим выключен, -1 — ошибка
+static inline long long stream_window_arg(int argc, char* argv[]) {
+    long long window = arg_size(argc, argv, "--stream", 0);
+    return window >= 0 && window <= INT_MAX ? window : -1;
+}
+
+static inline void stream_plan_init(stream_plan* p, long long first, long long count, long long window) {
+    p->first = first;
+    p->count = count;
+    p->window = window;
+    p->windows = (count + window - 1) / window;
+}
+
+// Смещение окна k внутри блока и его размер
+static inline long long stream_window_from(const stream_plan* p, long long k) {
+    return k * p->window;
+}
+
+static inline long long stream_window_count(const stream_plan* p, long long k) {
+    long long rest = p->count - k * p->window;
+    return rest < p->window ? rest : p->window;
+}
+
+// Глобальный индекс первого элемента окна k
+static inline long long stream_window_first(const stream_plan* p, long long k) {
+    return p->first + k * p->window;
+}
+
+// Очередь окон (--dynamic): по счётчику на проход в окне MPI_Win_allocate процесса 0,
+// счётчики не сбрасываются, поэтому проходы не нужно разделять барьером
+typedef struct {
+    MPI_Win win;
+    long long* counters;  // [passes] на процессе 0
+    int pass;             // текущий проход
+    long long taken;      // окон, взятых процессом в текущем проходе
+} stream_queue;
+
+// Коллективная операция на comm
+static inline void stream_queue_setup(stream_queue* q, int passes, MPI_Comm comm) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Aint bytes = rank == 0 ? (MPI_Aint)sizeof(long long) * passes : 0;
+    MPI_Win_allocate(bytes, sizeof(long long), MPI_INFO_NULL, comm, &q->counters, &q->win);
+    for (int i = 0; rank == 0 && i < passes; i++)
+        q->counters[i] = 0;
+    MPI_Win_lock_all(0, q->win);
+    MPI_Barrier(comm);
+    q->pass = 0;
+    q->taken = 0;
+}
+
+static inline void stream_queue_free(stream_queue* q) {
+    MPI_Win_unlock_all(q->win);
+    MPI_Win_free(&q->win);
+}
+
+// Начало прохода pass (у всех процессов одинаковые номера проходов)
+static inline void stream_queue_begin(stream_queue* q, int pass) {
+    q->pass = pass;
+    q->taken = 0;
+}
+
+// Окно, которое процесс обрабатывает j-м по счёту, или -1, если окон больше нет:
+// без очереди (q == NULL) — окна плана по порядку, с очередью — следующее свободное окно
+// (вызывается по одному разу для j = 0, 1, ...)
+static inline long long stream_next(const stream_plan* p, stream_queue* q, long long j) {
+    if (!q)
+        return j < p->windows ? j : -1;
+    long long one = 1, k = 0;
+    MPI_Fetch_and_op(&one, &k, MPI_LONG_LONG, 0, q->pass, MPI_SUM, q->win);
+    MPI_Win_flush(0, q->win);
+    if (k >= p->windows)
+        return -1;
+    q->taken++;
+    return k;
+}
+
+// Число окон, взятых каждым процессом в текущем проходе; печатается на root. Коллективная операция
+static inline void stream_queue_report(const stream_queue* q, int root, MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    long long* taken = rank == root ? (long long*)malloc(sizeof(long long) * size) : NULL;
+    MPI_Gather(&q->taken, 1, MPI_LONG_LONG, taken, 1, MPI_LONG_LONG, root, comm);
+    if (rank != root)
+        return;
+    long long lo = taken[0], hi = taken[0];
+    printf("Очередь окон: взято процессами в последнем проходе:");
+    for (int r = 0; r < size; r++) {
+        printf(" %lld", taken[r]);
+        lo = taken[r] < lo ? taken[r] : lo;
+        hi = taken[r] > hi ? taken[r] : hi;
+    }
+    printf(" (мин %lld, макс %lld)\n", lo, hi);
+    free(taken);
+}
+
+// Файл потокового режима: открывается один раз на все проходы
+typedef struct {
+    MPI_File fh;
+    MPI_Datatype type;
+    int elem;
+} stream_file;
+
+// Коллективное открытие для чтения. Возвращает 1 на всех процессах при успехе
+static inline int stream_open_read(stream_file* f, const char* path, MPI_Datatype type, MPI_Comm comm) {
+    int ok, all_ok = 0;
+    f->type = type;
+    MPI_Type_size(type, &f->elem);
+    ok = MPI_File_open(comm, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &f->fh) == MPI_SUCCESS;
+    MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_LAND, comm);
+    if (ok && !all_ok)
+        MPI_File_close(&f->fh);
+    return all_ok;
+}
+
+// Коллективное создание файла из total элементов для записи
+static inline int stream_open_write(stream_file* f, const char* path, MPI_Datatype type, long long total,
+                                    MPI_Comm comm) {
+    int ok, all_ok = 0;
+    f->type = type;
+    MPI_Type_size(type, &f->elem);
+    ok = MPI_File_open(comm, path, MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &f->fh) == MPI_SUCCESS;
+    ok = ok && MPI_File_set_size(f->fh, (MPI_Offset)total * f->elem) == MPI_SUCCESS;
+    MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_LAND, comm);
+    if (ok && !all_ok)
+        MPI_File_close(&f->fh);
+    return all_ok;
+}
+
+static inline void stream_close(stream_file* f) {
+    MPI_File_close(&f->fh);
+}
+
+// Запуск чтения окна k в buf
+static inline void stream_iread(stream_file* f, const stream_plan* p, long long k, void* buf, MPI_Request* req) {
+    MPI_File_iread_at(f->fh, (MPI_Offset)stream_window_first(p, k) * f->elem, buf,
+                      (int)stream_window_count(p, k), f->type, req);
+}
+
+// Запуск записи окна k из buf
+static inline void stream_iwrite(stream_file* f, const stream_plan* p, long long k, const void* buf,
+                                 MPI_Request* req) {
+    MPI_File_iwrite_at(f->fh, (MPI_Offset)stream_window_first(p, k) * f->elem, buf,
+                       (int)stream_window_count(p, k), f->type, req);
+}
+
+// Ожидание обмена окна из count элементов; возвращает 0, если передано меньше
+static inline int stream_wait(const stream_file* f, MPI_Request* req, long long count) {
+    MPI_Status status;
+    int done = 0;
+    if (MPI_Wait(req, &status) != MPI_SUCCESS)
+        return 0;
+    MPI_Get_count(&status, f->type, &done);
+    return done == count;
+}
+
+#endif
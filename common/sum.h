@@ -0,0 +1,147 @@
+#ifndef COMMON_SUM_H
+#define COMMON_SUM_H
+
+#include <stdint.h>
+
+// Ядра суммирования без переполнения и с контролем ошибки округления (задача 1).
+// Целые числа складываются в 64-битные накопители; вещественные — наивно, по Кэхэну
+// или попарно. Все ядра ведут SUM_LANES независимых накопителей (элемент i попадает
+// в линию i % SUM_LANES), что даёт параллелизм на уровне команд и совпадает
+// с раскладкой векторных вариантов из simd.h. Собирать без -ffast-math:
+// иначе компилятор вправе выбросить поправку Кэхэна.
+
+#define SUM_LANES 8
+#define SUM_PAIRWISE_BLOCK 256  // длина отрезка, который попарная сумма складывает напрямую
+
+// Сумма с поправкой: точное значение приближается величиной sum + err
+typedef struct {
+    double sum;
+    double err;
+} sum_pair;
+
+// Сложение двух пар без потери младших разрядов (TwoSum Кнута)
+static inline sum_pair sum_pair_add(sum_pair a, sum_pair b) {
+    double s = a.sum + b.sum;
+    double bp = s - a.sum;
+    double e = (a.sum - (s - bp)) + (b.sum - bp);
+    sum_pair r = { s, a.err + b.err + e };
+    return r;
+}
+
+// 64-битная сумма int: переполнение невозможно для блоков короче 2^32 элементов
+static inline int64_t sum_i32_wide(const int* restrict a, long long n) {
+    int64_t acc[4] = { 0, 0, 0, 0 };
+    long long i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc[0] += a[i];
+        acc[1] += a[i + 1];
+        acc[2] += a[i + 2];
+        acc[3] += a[i + 3];
+    }
+    for (; i < n; i++)
+        acc[0] += a[i];
+    return acc[0] + acc[1] + acc[2] + acc[3];
+}
+
+#ifdef __SIZEOF_INT128__
+// 128-битная сумма int64: значения из файла могут занимать все 64 бита
+static inline __int128 sum_i64_wide(const int64_t* restrict a, long long n) {
+    __int128 acc[2] = { 0, 0 };
+    long long i = 0;
+    for (; i + 2 <= n; i += 2) {
+        acc[0] += a[i];
+        acc[1] += a[i + 1];
+    }
+    for (; i < n; i++)
+        acc[0] += a[i];
+    return acc[0] + acc[1];
+}
+#endif
+
+// Шаг Кэхэна: c накапливает потерянные при сложении младшие разряды (со знаком минус)
+#define SUM_KAHAN_STEP(s, c, x) do { \
+        double y_ = (x) - (c);       \
+        double t_ = (s) + y_;        \
+        (c) = (t_ - (s)) - y_;       \
+        (s) = t_;                    \
+    } while (0)
+
+// Объединение линий Кэхэна в одну пару
+static inline sum_pair sum_kahan_combine(const double* s, const double* c) {
+    sum_pair r = { 0.0, 0.0 };
+    for (int j = 0; j < SUM_LANES; j++) {
+        sum_pair lane = { s[j], -c[j] };
+        r = sum_pair_add(r, lane);
+    }
+    return r;
+}
+
+// Продолжение линий Кэхэна с элемента from (используется и векторными вариантами для хвоста)
+static inline void sum_kahan_f64_lanes(const double* restrict x, long long from, long long n, double* s, double* c) {
+    for (long long i = from; i < n; i++)
+        SUM_KAHAN_STEP(s[i % SUM_LANES], c[i % SUM_LANES], x[i]);
+}
+
+static inline void sum_kahan_f32_lanes(const float* restrict x, long long from, long long n, double* s, double* c) {
+    for (long long i = from; i < n; i++)
+        SUM_KAHAN_STEP(s[i % SUM_LANES], c[i % SUM_LANES], (double)x[i]);
+}
+
+static inline sum_pair sum_kahan_f64(const double* restrict x, long long n) {
+    double s[SUM_LANES] = { 0 }, c[SUM_LANES] = { 0 };
+    sum_kahan_f64_lanes(x, 0, n, s, c);
+    return sum_kahan_combine(s, c);
+}
+
+// float складывается в double: сама сумма точнее входных данных
+static inline sum_pair sum_kahan_f32(const float* restrict x, long long n) {
+    double s[SUM_LANES] = { 0 }, c[SUM_LANES] = { 0 };
+    sum_kahan_f32_lanes(x, 0, n, s, c);
+    return sum_kahan_combine(s, c);
+}
+
+// Наивная сумма по линиям
+static inline double sum_naive_f64(const double* restrict x, long long n) {
+    double s[SUM_LANES] = { 0 };
+    long long i = 0;
+    for (; i + SUM_LANES <= n; i += SUM_LANES)
+        for (int j = 0; j < SUM_LANES; j++)
+            s[j] += x[i + j];
+    for (; i < n; i++)
+        s[i % SUM_LANES] += x[i];
+    double r = 0.0;
+    for (int j = 0; j < SUM_LANES; j++)
+        r += s[j];
+    return r;
+}
+
+static inline double sum_naive_f32(const float* restrict x, long long n) {
+    double s[SUM_LANES] = { 0 };
+    long long i = 0;
+    for (; i + SUM_LANES <= n; i += SUM_LANES)
+        for (int j = 0; j < SUM_LANES; j++)
+            s[j] += x[i + j];
+    for (; i < n; i++)
+        s[i % SUM_LANES] += x[i];
+    double r = 0.0;
+    for (int j = 0; j < SUM_LANES; j++)
+        r += s[j];
+    return r;
+}
+
+// Попарная (каскадная) сумма: ошибка растёт как O(log n) вместо O(n)
+static inline double sum_pairwise_f64(const double* restrict x, long long n) {
+    if (n <= SUM_PAIRWISE_BLOCK)
+        return sum_naive_f64(x, n);
+    long long half = n / 2;
+    return sum_pairwise_f64(x, half) + sum_pairwise_f64(x + half, n - half);
+}
+
+static inline double sum_pairwise_f32(const float* restrict x, long long n) {
+    if (n <= SUM_PAIRWISE_BLOCK)
+        return sum_naive_f32(x, n);
+    long long half = n / 2;
+    return sum_pairwise_f32(x, half) + sum_pairwise_f32(x + half, n - half);
+}
+
+#endif
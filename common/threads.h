@@ -0,0 +1,162 @@
+#ifndef COMMON_THREADS_H
+#define COMMON_THREADS_H
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <mpi.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "args.h"
+
+// Гибридный режим MPI + потоки OpenMP (собирать с -fopenmp).
+// Процесс делит свой блок на непрерывные отрезки по числу потоков; MPI вызывается
+// только из главного потока вне параллельных областей (MPI_THREAD_FUNNELED).
+// Без -fopenmp всё работает в одном потоке.
+
+#define THREADS_GRAIN 16        // отрезки потоков кратны 16 элементам (64 байта int)
+#define THREADS_MAX_CPUS 1024   // размер маски привязки
+#define THREADS_MASK_WORDS (THREADS_MAX_CPUS / (8 * sizeof(unsigned long)))
+
+enum { THREADS_BIND_NONE, THREADS_BIND_CLOSE, THREADS_BIND_SPREAD };
+
+static inline int threads_count(void) {
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+// Число потоков текущей параллельной области (1 вне её)
+static inline int threads_team_size(void) {
+#ifdef _OPENMP
+    return omp_get_num_threads();
+#else
+    return 1;
+#endif
+}
+
+static inline int threads_id(void) {
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+// MPI_Init_thread с уровнем FUNNELED; предупреждение, если библиотека его не даёт
+static inline void threads_mpi_init(int* argc, char*** argv) {
+    int provided;
+    MPI_Init_thread(argc, argv, MPI_THREAD_FUNNELED, &provided);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (provided < MPI_THREAD_FUNNELED && rank == 0)
+        printf("Предупреждение: библиотека MPI не поддерживает MPI_THREAD_FUNNELED.\n");
+}
+
+// Отрезок [*from, *from + *count) блока из n элементов для текущего потока.
+// Границы кратны THREADS_GRAIN, поэтому потоки не делят строки кэша и сохраняют
+// выравнивание, нужное векторным ядрам с потоковой записью
+static inline void threads_range(long long n, long long* from, long long* count) {
+    long long grains = (n + THREADS_GRAIN - 1) / THREADS_GRAIN;
+    int nt = threads_team_size(), t = threads_id();
+    long long g_per = grains / nt, g_rem = grains % nt;
+    long long g0 = g_per * t + (t < g_rem ? t : g_rem);
+    long long g1 = g0 + g_per + (t < g_rem ? 1 : 0);
+    long long lo = g0 * THREADS_GRAIN, hi = g1 * THREADS_GRAIN;
+    if (lo > n) lo = n;
+    if (hi > n) hi = n;
+    *from = lo;
+    *count = hi - lo;
+}
+
+// Первое касание: страницы буфера заполняются нулями тем потоком, который
+// будет с ними работать, и размещаются на его узле NUMA
+static inline void threads_first_touch(void* p, size_t elem, long long n) {
+#pragma omp parallel
+    {
+        long long from, count;
+        threads_range(n, &from, &count);
+        if (count > 0)
+            memset((char*)p + from * elem, 0, count * elem);
+    }
+}
+
+// Привязка текущего потока к процессору из множества, доступного процессу
+// (его задаёт mpirun, например --map-by ppr:1:socket:pe=8).
+// close — соседние потоки на соседние процессоры, spread — равномерно по множеству
+static inline int threads_bind_self(const unsigned long* allowed, int bind, int t, int nt) {
+    const int bits = 8 * sizeof(unsigned long);
+    int cpus[THREADS_MAX_CPUS], ncpu = 0;
+    for (int c = 0; c < THREADS_MAX_CPUS; c++)
+        if (allowed[c / bits] >> (c % bits) & 1UL)
+            cpus[ncpu++] = c;
+    if (ncpu == 0)
+        return -1;
+
+    int slot = bind == THREADS_BIND_SPREAD ? (int)((long long)t * ncpu / nt) : t;
+    int cpu = cpus[slot % ncpu];
+    unsigned long mask[THREADS_MASK_WORDS];
+    memset(mask, 0, sizeof(mask));
+    mask[cpu / bits] |= 1UL << (cpu % bits);
+    return (int)syscall(SYS_sched_setaffinity, 0, sizeof(mask), mask) == 0 ? cpu : -1;
+}
+
+// Маска процессоров процесса, прочитанная при первом вызове — до любой привязки потоков.
+// Привязка сужает маску главного потока, а в служебном режиме threads_setup вызывается для
+// каждого задания, поэтому следующее задание берёт доступные процессоры отсюда, а не из
+// текущей маски. NULL, если маску не удалось прочитать
+static inline const unsigned long* threads_process_mask(void) {
+    static unsigned long mask[THREADS_MASK_WORDS];
+    static int state = 0;  // 0 — не читалась, 1 — прочитана, -1 — ошибка
+    if (state == 0)
+        state = syscall(SYS_sched_getaffinity, 0, sizeof(mask), mask) < 0 ? -1 : 1;
+    return state > 0 ? mask : NULL;
+}
+
+// Разбор --threads=<число> и --bind=none|close|spread, запуск и привязка потоков.
+// При --bind=none потокам возвращается исходная маска процесса (снимается привязка прошлого задания).
+// Возвращает число потоков или 0 при ошибке в параметрах
+static inline int threads_setup(int argc, char* argv[], int verbose) {
+    long long nt = arg_long(argc, argv, "--threads", 1);
+    const char* bind_mode = arg_str(argc, argv, "--bind", "none");
+    int bind = strcmp(bind_mode, "close") == 0 ? THREADS_BIND_CLOSE
+             : strcmp(bind_mode, "spread") == 0 ? THREADS_BIND_SPREAD : THREADS_BIND_NONE;
+    if (nt <= 0 || nt > THREADS_MAX_CPUS || (bind == THREADS_BIND_NONE && strcmp(bind_mode, "none") != 0))
+        return 0;
+
+    // Маска процесса читается до привязки потоков, иначе главный поток сузит её для остальных
+    const unsigned long* allowed = threads_process_mask();
+
+#ifdef _OPENMP
+    omp_set_num_threads((int)nt);
+#else
+    if (nt > 1 && verbose)
+        printf("Предупреждение: программа собрана без -fopenmp, используется один поток.\n");
+    nt = 1;
+#endif
+
+    if (!allowed) {
+        if (bind != THREADS_BIND_NONE && verbose)
+            printf("Предупреждение: не удалось прочитать маску процессоров, потоки не привязаны.\n");
+        return (int)nt;
+    }
+    if (bind == THREADS_BIND_NONE) {
+#pragma omp parallel
+        syscall(SYS_sched_setaffinity, 0, sizeof(unsigned long) * THREADS_MASK_WORDS, allowed);
+        return (int)nt;
+    }
+    int failed = 0;
+#pragma omp parallel reduction(+:failed)
+    failed += threads_bind_self(allowed, bind, threads_id(), threads_team_size()) < 0;
+    if (failed && verbose)
+        printf("Предупреждение: не удалось привязать %d поток(ов).\n", failed);
+    return (int)nt;
+}
+
+#endif
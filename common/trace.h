@@ -0,0 +1,549 @@
+#ifndef COMMON_TRACE_H
+#define COMMON_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <mpi.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+#include "args.h"
+#include "bench.h"
+
+// Трассировка горячего пути (--trace=<файл>). Вызовы MPI, которыми пользуются программы,
+// перехватываются через интерфейс PMPI: заголовок определяет MPI_Barrier, MPI_Scatterv и т.д.,
+// которые вызывают PMPI_* и записывают время и объём вызова. Программа отмечает свои фазы
+// парами trace_begin/trace_end; для фаз записываются приращения аппаратных счётчиков
+// perf_event (такты, команды, промахи последнего уровня кэша), если ядро их даёт.
+// В конце trace_finish собирает события всех процессов на root и пишет их одним файлом
+// формата Chrome Trace (открывается в chrome://tracing или Perfetto): процесс трассы — ранг,
+// поток 0 — вызовы MPI, поток 1 — фазы. Без --trace перехватчики только передают вызов PMPI.
+// Заголовок определяет внешние функции, поэтому подключается в одну единицу трансляции
+// (каждая программа собирается из одного файла).
+
+#define TRACE_MAX_EVENTS 65536  // событий на процесс; лишние считаются, но не записываются
+#define TRACE_MAX_PHASES 32     // различных имён фаз в итоговой сводке
+
+// Перехватываемые вызовы MPI
+#define TRACE_MPI_FOREACH(X)                                                                         \
+    X(Barrier) X(Bcast) X(Scatterv) X(Gatherv) X(Iscatterv) X(Igatherv) X(Wait) X(Waitall)           \
+    X(Send) X(Recv) X(Sendrecv) X(Reduce) X(Allreduce) X(Allgather) X(Alltoall) X(Alltoallv)         \
+    X(File_read_all) X(File_read_at_all) X(File_write_all) X(File_write_at_all)                      \
+    X(File_iread_at) X(File_iwrite_at)
+
+#define TRACE_MPI_ENUM(name) TRACE_MPI_##name,
+enum { TRACE_MPI_FOREACH(TRACE_MPI_ENUM) TRACE_MPI_COUNT };
+#undef TRACE_MPI_ENUM
+
+#define TRACE_MPI_NAME(name) "MPI_" #name,
+static const char* const trace_mpi_names[TRACE_MPI_COUNT] = { TRACE_MPI_FOREACH(TRACE_MPI_NAME) };
+#undef TRACE_MPI_NAME
+
+// Аппаратные счётчики фаз
+enum { TRACE_CYCLES, TRACE_INSTRUCTIONS, TRACE_LLC_MISSES, TRACE_COUNTERS };
+static const char* const trace_counter_names[TRACE_COUNTERS] = { "cycles", "instructions", "llc_misses" };
+
+typedef struct {
+    const char* name;   // имя вызова MPI или фазы (строковая константа)
+    double start, dur;  // секунды от начала трассы
+    long long bytes;    // вызов MPI: байт, отправленных и принятых процессом (-1 — неизвестно)
+    int iteration;
+    int phase;          // 1 — фаза программы, 0 — вызов MPI
+    uint64_t counters[TRACE_COUNTERS];
+} trace_event;
+
+// Итоги фазы на процессе
+typedef struct {
+    const char* name;
+    int calls;
+    double time;
+    uint64_t counters[TRACE_COUNTERS];
+} trace_phase_total;
+
+typedef struct {
+    int on;
+    const char* path;
+    int rank;
+    double t0;
+    int iteration;
+    int fds[TRACE_COUNTERS];  // -1 — счётчик недоступен
+    int have_counters;
+    trace_event* events;
+    int count;
+    long long dropped;
+    double mpi_time[TRACE_MPI_COUNT];
+    long long mpi_calls[TRACE_MPI_COUNT];
+    long long mpi_bytes[TRACE_MPI_COUNT];
+    trace_phase_total phases[TRACE_MAX_PHASES];
+    int nphases;
+} trace_state;
+
+static trace_state trace_g;
+
+// Фаза, начатая trace_begin
+typedef struct {
+    const char* name;
+    double start;
+    uint64_t counters[TRACE_COUNTERS];
+} trace_region;
+
+#ifdef __linux__
+// Счётчик процесса и всех потоков, созданных после открытия (inherit), без ядра
+static inline int trace_perf_open(uint32_t type, uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+static inline void trace_read_counters(uint64_t* out) {
+    for (int c = 0; c < TRACE_COUNTERS; c++) {
+        out[c] = 0;
+        if (trace_g.fds[c] >= 0 && read(trace_g.fds[c], &out[c], sizeof(out[c])) != sizeof(out[c]))
+            out[c] = 0;
+    }
+}
+
+// Разбор --trace=<файл> и открытие счётчиков. Вызывается сразу после инициализации MPI,
+// до первой параллельной области, чтобы счётчики унаследовали потоки OpenMP.
+// Коллективная операция; возвращает 0, если не удалось выделить буфер событий
+static inline int trace_setup(int argc, char* argv[], MPI_Comm comm) {
+    memset(&trace_g, 0, sizeof(trace_g));
+    for (int c = 0; c < TRACE_COUNTERS; c++)
+        trace_g.fds[c] = -1;
+    trace_g.path = arg_value(argc, argv, "--trace");
+    if (!trace_g.path)
+        return 1;
+
+    trace_g.events = (trace_event*)malloc(sizeof(trace_event) * TRACE_MAX_EVENTS);
+    if (!trace_g.events)
+        return 0;
+    PMPI_Comm_rank(comm, &trace_g.rank);
+#ifdef __linux__
+    static const uint64_t configs[TRACE_COUNTERS] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                      PERF_COUNT_HW_CACHE_MISSES };
+    for (int c = 0; c < TRACE_COUNTERS; c++) {
+        trace_g.fds[c] = trace_perf_open(PERF_TYPE_HARDWARE, configs[c]);
+        trace_g.have_counters |= trace_g.fds[c] >= 0;
+    }
+#endif
+    // Общее начало отсчёта: после барьера процессы берут время почти одновременно
+    PMPI_Barrier(comm);
+    trace_g.t0 = PMPI_Wtime();
+    trace_g.on = 1;
+    return 1;
+}
+
+// Номер итерации замера (с нуля, включая прогревочные) для следующих событий
+static inline void trace_iteration(int iteration) {
+    trace_g.iteration = iteration;
+}
+
+static inline trace_event* trace_push(const char* name, double start, double end, int phase) {
+    if (trace_g.count == TRACE_MAX_EVENTS) {
+        trace_g.dropped++;
+        return NULL;
+    }
+    trace_event* e = &trace_g.events[trace_g.count++];
+    e->name = name;
+    e->start = start - trace_g.t0;
+    e->dur = end - start;
+    e->bytes = -1;
+    e->iteration = trace_g.iteration;
+    e->phase = phase;
+    memset(e->counters, 0, sizeof(e->counters));
+    return e;
+}
+
+static inline void trace_mpi_record(int id, double start, double end, long long bytes) {
+    trace_g.mpi_time[id] += end - start;
+    trace_g.mpi_calls[id]++;
+    if (bytes > 0)
+        trace_g.mpi_bytes[id] += bytes;
+    trace_event* e = trace_push(trace_mpi_names[id], start, end, 0);
+    if (e)
+        e->bytes = bytes;
+}
+
+static inline trace_region trace_begin(const char* name) {
+    trace_region r;
+    r.name = name;
+    r.start = 0.0;
+    if (trace_g.on) {
+        trace_read_counters(r.counters);
+        r.start = PMPI_Wtime();
+    }
+    return r;
+}
+
+static inline void trace_end(const trace_region* r) {
+    if (!trace_g.on)
+        return;
+    double end = PMPI_Wtime();
+    uint64_t now[TRACE_COUNTERS], delta[TRACE_COUNTERS];
+    trace_read_counters(now);
+    for (int c = 0; c < TRACE_COUNTERS; c++)
+        delta[c] = now[c] - r->counters[c];
+
+    trace_event* e = trace_push(r->name, r->start, end, 1);
+    if (e)
+        memcpy(e->counters, delta, sizeof(delta));
+
+    int p = 0;
+    while (p < trace_g.nphases && strcmp(trace_g.phases[p].name, r->name) != 0)
+        p++;
+    if (p == TRACE_MAX_PHASES)
+        return;
+    trace_phase_total* t = &trace_g.phases[p];
+    if (p == trace_g.nphases) {
+        memset(t, 0, sizeof(*t));
+        t->name = r->name;
+        trace_g.nphases++;
+    }
+    t->calls++;
+    t->time += end - r->start;
+    for (int c = 0; c < TRACE_COUNTERS; c++)
+        t->counters[c] += delta[c];
+}
+
+// ---------- объём вызовов ----------
+
+static inline long long trace_bytes(MPI_Datatype type, long long count) {
+    int size = 0;
+    PMPI_Type_size(type, &size);
+    return count * size;
+}
+
+// Сумма counts[0..nproc) элементов type
+static inline long long trace_counts_bytes(const int* counts, MPI_Datatype type, MPI_Comm comm) {
+    int nproc;
+    PMPI_Comm_size(comm, &nproc);
+    long long total = 0;
+    for (int i = 0; i < nproc; i++)
+        total += counts[i];
+    return trace_bytes(type, total);
+}
+
+static inline int trace_is_root(int root, MPI_Comm comm) {
+    int rank;
+    PMPI_Comm_rank(comm, &rank);
+    return rank == root;
+}
+
+static inline int trace_comm_size(MPI_Comm comm) {
+    int nproc;
+    PMPI_Comm_size(comm, &nproc);
+    return nproc;
+}
+
+// ---------- перехватчики ----------
+
+// Тело перехватчика: без трассировки — только вызов PMPI, иначе вызов с записью времени
+// и объёма (bytes вычисляется после вызова)
+#define TRACE_WRAP(id, call, bytes)                                                                  \
+    do {                                                                                             \
+        if (!trace_g.on)                                                                             \
+            return call;                                                                             \
+        double start_ = PMPI_Wtime();                                                                \
+        int rc_ = call;                                                                              \
+        trace_mpi_record(id, start_, PMPI_Wtime(), bytes);                                           \
+        return rc_;                                                                                  \
+    } while (0)
+
+int MPI_Barrier(MPI_Comm comm) {
+    TRACE_WRAP(TRACE_MPI_Barrier, PMPI_Barrier(comm), 0);
+}
+
+int MPI_Bcast(void* buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm) {
+    TRACE_WRAP(TRACE_MPI_Bcast, PMPI_Bcast(buffer, count, datatype, root, comm), trace_bytes(datatype, count));
+}
+
+int MPI_Scatterv(const void* sendbuf, const int sendcounts[], const int displs[], MPI_Datatype sendtype,
+                 void* recvbuf, int recvcount, MPI_Datatype recvtype, int root, MPI_Comm comm) {
+    TRACE_WRAP(TRACE_MPI_Scatterv,
+               PMPI_Scatterv(sendbuf, sendcounts, displs, sendtype, recvbuf, recvcount, recvtype, root, comm),
+               trace_bytes(recvtype, recvcount)
+                   + (trace_is_root(root, comm) ? trace_counts_bytes(sendcounts, sendtype, comm) : 0));
+}
+
+int MPI_Gatherv(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, const int recvcounts[],
+                const int displs[], MPI_Datatype recvtype, int root, MPI_Comm comm) {
+    TRACE_WRAP(TRACE_MPI_Gatherv,
+               PMPI_Gatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, root, comm),
+               trace_bytes(sendtype, sendcount)
+                   + (trace_is_root(root, comm) ? trace_counts_bytes(recvcounts, recvtype, comm) : 0));
+}
+
+// Неблокирующие вызовы: время постановки и объём; ожидание записывается в MPI_Wait/MPI_Waitall
+int MPI_Iscatterv(const void* sendbuf, const int sendcounts[], const int displs[], MPI_Datatype sendtype,
+                  void* recvbuf, int recvcount, MPI_Datatype recvtype, int root, MPI_Comm comm,
+                  MPI_Request* request) {
+    TRACE_WRAP(TRACE_MPI_Iscatterv,
+               PMPI_Iscatterv(sendbuf, sendcounts, displs, sendtype, recvbuf, recvcount, recvtype, root, comm,
+                              request),
+               trace_bytes(recvtype, recvcount)
+                   + (trace_is_root(root, comm) ? trace_counts_bytes(sendcounts, sendtype, comm) : 0));
+}
+
+int MPI_Igatherv(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, const int recvcounts[],
+                 const int displs[], MPI_Datatype recvtype, int root, MPI_Comm comm, MPI_Request* request) {
+    TRACE_WRAP(TRACE_MPI_Igatherv,
+               PMPI_Igatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, root, comm,
+                             request),
+               trace_bytes(sendtype, sendcount)
+                   + (trace_is_root(root, comm) ? trace_counts_bytes(recvcounts, recvtype, comm) : 0));
+}
+
+int MPI_Wait(MPI_Request* request, MPI_Status* status) {
+    TRACE_WRAP(TRACE_MPI_Wait, PMPI_Wait(request, status), -1);
+}
+
+int MPI_Waitall(int count, MPI_Request array_of_requests[], MPI_Status array_of_statuses[]) {
+    TRACE_WRAP(TRACE_MPI_Waitall, PMPI_Waitall(count, array_of_requests, array_of_statuses), -1);
+}
+
+int MPI_Send(const void* buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm) {
+    TRACE_WRAP(TRACE_MPI_Send, PMPI_Send(buf, count, datatype, dest, tag, comm), trace_bytes(datatype, count));
+}
+
+int MPI_Recv(void* buf, int count, MPI_Datatype datatype, int source, int tag, MPI_Comm comm, MPI_Status* status) {
+    TRACE_WRAP(TRACE_MPI_Recv, PMPI_Recv(buf, count, datatype, source, tag, comm, status),
+               trace_bytes(datatype, count));
+}
+
+int MPI_Sendrecv(const void* sendbuf, int sendcount, MPI_Datatype sendtype, int dest, int sendtag, void* recvbuf,
+                 int recvcount, MPI_Datatype recvtype, int source, int recvtag, MPI_Comm comm, MPI_Status* status) {
+    TRACE_WRAP(TRACE_MPI_Sendrecv,
+               PMPI_Sendrecv(sendbuf, sendcount, sendtype, dest, sendtag, recvbuf, recvcount, recvtype, source,
+                             recvtag, comm, status),
+               trace_bytes(sendtype, sendcount) + trace_bytes(recvtype, recvcount));
+}
+
+int MPI_Reduce(const void* sendbuf, void* recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root,
+               MPI_Comm comm) {
+    TRACE_WRAP(TRACE_MPI_Reduce, PMPI_Reduce(sendbuf, recvbuf, count, datatype, op, root, comm),
+               trace_bytes(datatype, count));
+}
+
+int MPI_Allreduce(const void* sendbuf, void* recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Comm comm) {
+    TRACE_WRAP(TRACE_MPI_Allreduce, PMPI_Allreduce(sendbuf, recvbuf, count, datatype, op, comm),
+               2 * trace_bytes(datatype, count));
+}
+
+int MPI_Allgather(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount,
+                  MPI_Datatype recvtype, MPI_Comm comm) {
+    TRACE_WRAP(TRACE_MPI_Allgather,
+               PMPI_Allgather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm),
+               trace_bytes(sendtype, sendcount) + trace_bytes(recvtype, (long long)recvcount * trace_comm_size(comm)));
+}
+
+int MPI_Alltoall(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount,
+                 MPI_Datatype recvtype, MPI_Comm comm) {
+    TRACE_WRAP(TRACE_MPI_Alltoall,
+               PMPI_Alltoall(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm),
+               (trace_bytes(sendtype, sendcount) + trace_bytes(recvtype, recvcount)) * trace_comm_size(comm));
+}
+
+int MPI_Alltoallv(const void* sendbuf, const int sendcounts[], const int sdispls[], MPI_Datatype sendtype,
+                  void* recvbuf, const int recvcounts[], const int rdispls[], MPI_Datatype recvtype, MPI_Comm comm) {
+    TRACE_WRAP(TRACE_MPI_Alltoallv,
+               PMPI_Alltoallv(sendbuf, sendcounts, sdispls, sendtype, recvbuf, recvcounts, rdispls, recvtype, comm),
+               trace_counts_bytes(sendcounts, sendtype, comm) + trace_counts_bytes(recvcounts, recvtype, comm));
+}
+
+int MPI_File_read_all(MPI_File fh, void* buf, int count, MPI_Datatype datatype, MPI_Status* status) {
+    TRACE_WRAP(TRACE_MPI_File_read_all, PMPI_File_read_all(fh, buf, count, datatype, status),
+               trace_bytes(datatype, count));
+}
+
+int MPI_File_read_at_all(MPI_File fh, MPI_Offset offset, void* buf, int count, MPI_Datatype datatype,
+                         MPI_Status* status) {
+    TRACE_WRAP(TRACE_MPI_File_read_at_all, PMPI_File_read_at_all(fh, offset, buf, count, datatype, status),
+               trace_bytes(datatype, count));
+}
+
+int MPI_File_write_all(MPI_File fh, const void* buf, int count, MPI_Datatype datatype, MPI_Status* status) {
+    TRACE_WRAP(TRACE_MPI_File_write_all, PMPI_File_write_all(fh, buf, count, datatype, status),
+               trace_bytes(datatype, count));
+}
+
+int MPI_File_write_at_all(MPI_File fh, MPI_Offset offset, const void* buf, int count, MPI_Datatype datatype,
+                          MPI_Status* status) {
+    TRACE_WRAP(TRACE_MPI_File_write_at_all, PMPI_File_write_at_all(fh, offset, buf, count, datatype, status),
+               trace_bytes(datatype, count));
+}
+
+int MPI_File_iread_at(MPI_File fh, MPI_Offset offset, void* buf, int count, MPI_Datatype datatype,
+                      MPI_Request* request) {
+    TRACE_WRAP(TRACE_MPI_File_iread_at, PMPI_File_iread_at(fh, offset, buf, count, datatype, request),
+               trace_bytes(datatype, count));
+}
+
+int MPI_File_iwrite_at(MPI_File fh, MPI_Offset offset, const void* buf, int count, MPI_Datatype datatype,
+                       MPI_Request* request) {
+    TRACE_WRAP(TRACE_MPI_File_iwrite_at, PMPI_File_iwrite_at(fh, offset, buf, count, datatype, request),
+               trace_bytes(datatype, count));
+}
+
+#undef TRACE_WRAP
+
+// ---------- вывод ----------
+
+// События процесса фрагментом JSON (через запятую, без скобок); возвращает строку из malloc
+static inline char* trace_format_events(long long* length) {
+    size_t cap = 256 + (size_t)trace_g.count * 320, len = 0;
+    char* buf = (char*)malloc(cap);
+    if (!buf) {
+        *length = 0;
+        return NULL;
+    }
+    int pid = trace_g.rank;
+    len += snprintf(buf + len, cap - len,
+                    "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"rank %d\"}},"
+                    "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"MPI\"}},"
+                    "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":1,\"args\":{\"name\":\"phases\"}}",
+                    pid, pid, pid, pid);
+    for (int i = 0; i < trace_g.count; i++) {
+        const trace_event* e = &trace_g.events[i];
+        if (cap - len < 512) {
+            char* grown = (char*)realloc(buf, cap * 2);
+            if (!grown)
+                break;
+            buf = grown;
+            cap *= 2;
+        }
+        len += snprintf(buf + len, cap - len,
+                        ",{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+                        "\"args\":{\"it\":%d",
+                        e->name, e->phase ? "phase" : "mpi", pid, e->phase, e->start * 1e6, e->dur * 1e6,
+                        e->iteration);
+        if (e->bytes >= 0)
+            len += snprintf(buf + len, cap - len, ",\"bytes\":%lld", e->bytes);
+        if (e->phase && trace_g.have_counters) {
+            for (int c = 0; c < TRACE_COUNTERS; c++)
+                if (trace_g.fds[c] >= 0)
+                    len += snprintf(buf + len, cap - len, ",\"%s\":%llu", trace_counter_names[c],
+                                    (unsigned long long)e->counters[c]);
+        }
+        len += snprintf(buf + len, cap - len, "}}");
+    }
+    *length = (long long)len;
+    return buf;
+}
+
+// Сводка на root: время вызовов MPI (максимум по процессам), объём (сумма по процессам)
+// и фазы процесса root со счётчиками
+static inline void trace_print_summary(const double* time, const long long* calls, const long long* bytes,
+                                       long long dropped) {
+    printf("Трассировка: вызовы MPI (время — максимум по процессам, вызовы и объём — сумма):\n");
+    static const char* columns[] = { "время, с", "вызовов", "МиБ" };
+    printf("  ");
+    bench_print_cell("вызов", 22, 0);
+    for (int c = 0; c < 3; c++)
+        bench_print_cell(columns[c], 12, 1);
+    printf("\n");
+    for (int id = 0; id < TRACE_MPI_COUNT; id++)
+        if (calls[id] > 0)
+            printf("  %-22s%12.6f%12lld%12.1f\n", trace_mpi_names[id], time[id], calls[id],
+                   bytes[id] / 1048576.0);
+
+    if (trace_g.nphases > 0) {
+        printf("Трассировка: фазы процесса %d%s:\n", trace_g.rank,
+               trace_g.have_counters ? " (счётчики — все потоки процесса; байты ≈ промахи LLC × 64)"
+                                     : " (аппаратные счётчики недоступны)");
+        for (int p = 0; p < trace_g.nphases; p++) {
+            const trace_phase_total* t = &trace_g.phases[p];
+            printf("  %-22s %12.6f с, %d раз", t->name, t->time, t->calls);
+            if (trace_g.fds[TRACE_CYCLES] >= 0 && trace_g.fds[TRACE_INSTRUCTIONS] >= 0 && t->counters[TRACE_CYCLES])
+                printf(", IPC %.2f", (double)t->counters[TRACE_INSTRUCTIONS] / t->counters[TRACE_CYCLES]);
+            if (trace_g.fds[TRACE_LLC_MISSES] >= 0 && t->time > 0)
+                printf(", из памяти ≈ %.2f ГБ/с", t->counters[TRACE_LLC_MISSES] * 64.0 / t->time / 1e9);
+            printf("\n");
+        }
+    }
+    if (dropped > 0)
+        printf("Трассировка: буфер событий переполнен, не записано событий: %lld\n", dropped);
+}
+
+// Сбор событий всех процессов на root, запись файла трассы и сводка. Коллективная операция;
+// без --trace ничего не делает. Возвращает 1 при успехе (на root)
+static inline int trace_finish(int root, MPI_Comm comm) {
+    if (!trace_g.on)
+        return 1;
+    trace_g.on = 0;
+
+    int rank, nproc;
+    PMPI_Comm_rank(comm, &rank);
+    PMPI_Comm_size(comm, &nproc);
+
+    double time[TRACE_MPI_COUNT];
+    long long calls[TRACE_MPI_COUNT], bytes[TRACE_MPI_COUNT], dropped = 0;
+    PMPI_Reduce(trace_g.mpi_time, time, TRACE_MPI_COUNT, MPI_DOUBLE, MPI_MAX, root, comm);
+    PMPI_Reduce(trace_g.mpi_calls, calls, TRACE_MPI_COUNT, MPI_LONG_LONG, MPI_SUM, root, comm);
+    PMPI_Reduce(trace_g.mpi_bytes, bytes, TRACE_MPI_COUNT, MPI_LONG_LONG, MPI_SUM, root, comm);
+    PMPI_Reduce(&trace_g.dropped, &dropped, 1, MPI_LONG_LONG, MPI_SUM, root, comm);
+
+    // Фрагменты процессов собираются на root как байты
+    long long length;
+    char* mine = trace_format_events(&length);
+    int len = (int)length;
+    int* lens = rank == root ? (int*)malloc(sizeof(int) * nproc) : NULL;
+    int* displs = rank == root ? (int*)calloc(nproc, sizeof(int)) : NULL;
+    PMPI_Gather(&len, 1, MPI_INT, lens, 1, MPI_INT, root, comm);
+    char* all = NULL;
+    long long total = 0;
+    if (rank == root) {
+        for (int i = 0; i < nproc; i++) {
+            displs[i] = (int)total;
+            total += lens[i];
+        }
+        all = (char*)malloc(total > 0 ? total : 1);
+    }
+    PMPI_Gatherv(mine, len, MPI_CHAR, all, lens, displs, MPI_CHAR, root, comm);
+
+    int ok = 1;
+    if (rank == root) {
+        FILE* f = fopen(trace_g.path, "w");
+        ok = f != NULL;
+        if (f) {
+            fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+            for (int i = 0; i < nproc; i++) {
+                if (i > 0 && lens[i] > 0)
+                    fputc(',', f);
+                fwrite(all + displs[i], 1, lens[i], f);
+            }
+            fprintf(f, "]}\n");
+            ok = fclose(f) == 0;
+        }
+        trace_print_summary(time, calls, bytes, dropped);
+        if (ok)
+            printf("Трасса записана в %s (chrome://tracing или Perfetto)\n", trace_g.path);
+        else
+            printf("Ошибка: не удалось записать трассу в '%s'.\n", trace_g.path);
+    }
+
+    free(mine);
+    free(all);
+    free(lens);
+    free(displs);
+    free(trace_g.events);
+    trace_g.events = NULL;
+    for (int c = 0; c < TRACE_COUNTERS; c++)
+        if (trace_g.fds[c] >= 0)
+            close(trace_g.fds[c]);
+    return ok;
+}
+
+#endif
@@ -0,0 +1,100 @@
+#!/bin/bash
+#
+# Таблицы масштабируемости по results.csv из scaling/sweep.sh (или любому CSV,
+# собранному программами с --format=csv).
+#
+#   scaling/report.sh <results.csv> [strong|weak]
+#
+# Для каждой задачи, серии замеров и набора параметров выводит медианное время,
+# ускорение S, эффективность E = S / (P*T) и долю последовательной части по Карпу–Флэтту
+#   e = (1/S - 1/(P*T)) / (1 - 1/(P*T)).
+# База — медиана taskN_seq того же размера (в слабой масштабируемости — размера,
+# приходящегося на одного исполнителя), а без неё — запуск с наименьшим P*T.
+# В слабой масштабируемости S — масштабированное ускорение (P*T * E).
+# Строки, где эффективность упала больше чем на 20% относительно предыдущей, помечены '!'.
+
+set -euo pipefail
+
+CSV=${1:-}
+MODE=${2:-}
+if [[ -z "$CSV" || ! -f "$CSV" ]]; then
+    sed -n '3,15p' "$0" | sed 's/^# \{0,1\}//'
+    exit 1
+fi
+if [[ -z "$MODE" ]]; then
+    MODE=$(cat "$(dirname "$CSV")/mode" 2>/dev/null || echo strong)
+fi
+
+awk -F',' -v mode="$MODE" '
+# Параметры без размеров: они меняются в слабой масштабируемости задачи 4
+function strip_size(params,    n, i, parts, out) {
+    n = split(params, parts, ";")
+    out = ""
+    for (i = 1; i <= n; i++)
+        if (parts[i] !~ /^(rows|cols)=/)
+            out = out (out == "" ? "" : ";") parts[i]
+    return out
+}
+NR == 1 || $1 == "program" { next }
+{
+    task = $1; sub(/_(seq|par)$/, "", task)
+    series = $2; p = $3 + 0; t = $4 + 0; size = $5; median = $10 + 0
+    if ($1 ~ /_seq$/) {
+        seq[task SUBSEP series SUBSEP size] = median
+        next
+    }
+    group = task " " series (strip_size($6) == "" ? "" : " [" strip_size($6) "]")
+    key = group SUBSEP p SUBSEP t SUBSEP size
+    if (!(key in time)) {
+        order[++count] = key
+    }
+    time[key] = median
+    gtask[key] = task; gseries[key] = series
+    # наименьший P*T группы при том же размере (для сильной) или вообще (для слабой)
+    pt = p * t
+    bkey = group SUBSEP (mode == "strong" ? size : "")
+    if (!(bkey in best_pt) || pt < best_pt[bkey]) {
+        best_pt[bkey] = pt
+        best_time[bkey] = median
+        best_size[bkey] = size
+    }
+}
+END {
+    for (i = 1; i <= count; i++) {
+        key = order[i]
+        split(key, k, SUBSEP)
+        group = k[1]; p = k[2]; t = k[3]; size = k[4]; pt = p * t
+        base_size = mode == "strong" ? size : size / pt
+        skey = gtask[key] SUBSEP gseries[key] SUBSEP sprintf("%.0f", base_size)
+        bkey = group SUBSEP (mode == "strong" ? size : "")
+        if (skey in seq) {
+            tb = seq[skey]; ref = "seq"
+        } else {
+            # база по параллельному запуску с наименьшим P*T: пересчёт на одного исполнителя
+            tb = best_time[bkey] * best_pt[bkey]
+            if (mode == "weak") tb = best_time[bkey]
+            ref = "P*T=" best_pt[bkey]
+        }
+        tp = time[key]
+        if (mode == "strong") {
+            s = tb / tp
+        } else {
+            s = pt * tb / tp
+        }
+        e = s / pt
+        kf = pt > 1 && s > 0 ? (1 / s - 1 / pt) / (1 - 1 / pt) : 0
+        printf "%s\t%.0f\t%d\t%d\t%d\t%s\t%.9g\t%.4f\t%.4f\t%.4f\t%s\n", group, base_size, pt, p, t, size, tp, s, e, kf, ref
+    }
+}' "$CSV" | sort -t $'\t' -k1,1 -k2,2n -k3,3n -k4,4n | awk -F'\t' -v mode="$MODE" '
+{
+    if ($1 != group || $2 != base) {
+        group = $1; base = $2; prev_e = -1
+        printf "\n%s, %s %s (%s масштабируемость, база: %s)\n", group,
+               mode == "strong" ? "размер" : "на исполнителя", base, mode == "strong" ? "сильная" : "слабая", $11
+        # mawk выравнивает по байтам: ширина кириллических заголовков увеличена на число букв
+        printf "%6s %6s %8s %20s %22s %10s %10s %21s\n", "P", "T", "P*T", "размер", "медиана, с", "S", "E", "Карп-Флэтт"
+    }
+    cliff = prev_e > 0 && $9 < 0.8 * prev_e ? " !" : ""
+    printf "%6d %6d %8d %14s %14.6f %10.2f %10.2f %12.4f%s\n", $4, $5, $3, $6, $7, $8, $9, $10, cliff
+    prev_e = $9
+}'
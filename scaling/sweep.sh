@@ -0,0 +1,192 @@
+#!/bin/bash
+#
+# Серия замеров сильной или слабой масштабируемости.
+# Перебирает числа процессов, потоков на процесс и размеры задачи, запускает
+# taskN_seq (база для ускорения) и taskN_par с --format=csv и собирает всё
+# в <каталог>/results.csv. Таблицы строит scaling/report.sh.
+#
+#   scaling/sweep.sh --task=3 --mode=strong --procs=1,2,4,8,16 --size=10M
+#   scaling/sweep.sh --task=1 --mode=weak --procs=2,4,8 --threads=1,4 --size=1M
+#   scaling/sweep.sh --task=4 --launcher=lsf --procs=2,4,8,12,16 --ptile=2
+#
+# --launcher=local (по умолчанию) запускает mpirun сразу, --launcher=lsf только
+# пишет задания LSF в каталог и submit.sh для их постановки в очередь.
+# Программы должны быть собраны (см. README).
+
+set -euo pipefail
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+
+TASKS="1"
+MODE="strong"
+PROCS="1,2,4,8,12,16"
+THREADS="1"
+SIZES=""
+RUNS=100
+WARMUP=1
+LAUNCHER="local"
+PTILE=2
+WALLTIME="00:20"
+OUT=""
+EXTRA=""
+MPIRUN="mpirun"
+
+usage() {
+    sed -n '3,17p' "$0" | sed 's/^# \{0,1\}//'
+    echo "Параметры: --task=1,2,3,4 --mode=strong|weak --procs=<список> --threads=<список> --size=<список>"
+    echo "           --runs=<число> --warmup=<число> --launcher=local|lsf --ptile=<число> --walltime=ЧЧ:ММ"
+    echo "           --out=<каталог> --mpirun=<команда> --extra=\"<параметры программ>\""
+    exit 1
+}
+
+for arg in "$@"; do
+    case "$arg" in
+        --task=*) TASKS=${arg#*=} ;;
+        --mode=*) MODE=${arg#*=} ;;
+        --procs=*) PROCS=${arg#*=} ;;
+        --threads=*) THREADS=${arg#*=} ;;
+        --size=*) SIZES=${arg#*=} ;;
+        --runs=*) RUNS=${arg#*=} ;;
+        --warmup=*) WARMUP=${arg#*=} ;;
+        --launcher=*) LAUNCHER=${arg#*=} ;;
+        --ptile=*) PTILE=${arg#*=} ;;
+        --walltime=*) WALLTIME=${arg#*=} ;;
+        --out=*) OUT=${arg#*=} ;;
+        --mpirun=*) MPIRUN=${arg#*=} ;;
+        --extra=*) EXTRA=${arg#*=} ;;
+        *) usage ;;
+    esac
+done
+
+[[ "$MODE" == strong || "$MODE" == weak ]] || usage
+[[ "$LAUNCHER" == local || "$LAUNCHER" == lsf ]] || usage
+OUT=${OUT:-"$ROOT/scaling/runs/$(date +%Y%m%d_%H%M%S)_$MODE"}
+mkdir -p "$OUT"
+OUT=$(cd "$OUT" && pwd)
+RESULTS="$OUT/results.csv"
+echo "$MODE" > "$OUT/mode"
+
+# Размер по умолчанию — как в программах
+default_size() {
+    case "$1" in
+        1|3) echo 1000000 ;;
+        2) echo 200000 ;;
+        4) echo 500 ;;
+    esac
+}
+
+# Число с суффиксом K/M/G (как в common/args.h)
+expand_size() {
+    local v=$1
+    case "$v" in
+        *K) echo $(( ${v%K} * 1000 )) ;;
+        *M) echo $(( ${v%M} * 1000000 )) ;;
+        *G) echo $(( ${v%G} * 1000000000 )) ;;
+        *) echo "$v" ;;
+    esac
+}
+
+# Параметры размера: для задачи 4 размер — число строк (столбцов столько же в сильной
+# масштабируемости; в слабой растёт число строк при неизменных столбцах)
+size_args() {
+    local task=$1 size=$2 cols=$3
+    if [[ "$task" == 4 ]]; then
+        echo "--rows=$size --cols=$cols"
+    else
+        echo "--n=$size"
+    fi
+}
+
+JOBS=()
+
+# Команда одного замера; при local выполняется сразу, при lsf — копится для задания
+emit() {
+    local np=$1; shift
+    local cmd
+    if [[ "$np" == 0 ]]; then
+        cmd="$*"
+    else
+        cmd="$MPIRUN -np $np $*"
+    fi
+    if [[ "$LAUNCHER" == local ]]; then
+        echo ">> $cmd"
+        (cd "$ROOT" && eval "$cmd") >> "$OUT/log.txt" 2>&1 || echo "   ошибка, см. $OUT/log.txt"
+    else
+        JOBS+=("$cmd")
+    fi
+}
+
+# Задание LSF на np процессов с указанными командами
+write_lsf() {
+    local name=$1 np=$2; shift 2
+    local file="$OUT/$name.lsf"
+    {
+        echo "#!/bin/bash"
+        echo "#"
+        echo "#BSUB -J $name"
+        echo "#BSUB -W $WALLTIME"
+        echo "#BSUB -n $np"
+        echo "#BSUB -R \"span[ptile=$PTILE]\""
+        echo "#BSUB -oo $OUT/$name.out"
+        echo "#BSUB -eo $OUT/$name.err"
+        echo "module load mpi/openmpi-x86_64"
+        echo "cd $ROOT"
+        for c in "$@"; do
+            echo "$c"
+        done
+    } > "$file"
+    echo "bsub < $file" >> "$OUT/submit.sh"
+}
+
+[[ "$LAUNCHER" == lsf ]] && { echo "#!/bin/bash" > "$OUT/submit.sh"; chmod +x "$OUT/submit.sh"; }
+
+IFS=',' read -ra TASK_LIST <<< "$TASKS"
+IFS=',' read -ra PROC_LIST <<< "$PROCS"
+IFS=',' read -ra THREAD_LIST <<< "$THREADS"
+MAX_THREADS=1
+for nt in "${THREAD_LIST[@]}"; do
+    (( nt > MAX_THREADS )) && MAX_THREADS=$nt
+done
+
+for task in "${TASK_LIST[@]}"; do
+    seq_bin="./task$task/task${task}_seq"
+    par_bin="./task$task/task${task}_par"
+    common="--warmup=$WARMUP --format=csv --out=$RESULTS $EXTRA"
+    IFS=',' read -ra SIZE_LIST <<< "${SIZES:-$(default_size "$task")}"
+
+    for size in "${SIZE_LIST[@]}"; do
+        base=$(expand_size "$size")
+        cols=$([[ "$task" == 4 ]] && echo "$base" || echo 0)
+
+        # База: последовательная программа на исходном размере
+        JOBS=()
+        emit 0 "$seq_bin $RUNS $(size_args "$task" "$base" "$cols") $common"
+        [[ "$LAUNCHER" == lsf ]] && write_lsf "task${task}_seq_s$base" 1 "${JOBS[@]}"
+
+        for np in "${PROC_LIST[@]}"; do
+            JOBS=()
+            for nt in "${THREAD_LIST[@]}"; do
+                # Сильная масштабируемость: размер постоянный; слабая: растёт с числом исполнителей
+                if [[ "$MODE" == strong ]]; then
+                    scaled=$base
+                else
+                    scaled=$(( base * np * nt ))
+                fi
+                # Гибридный запуск: каждому процессу nt ядер, потоки привязаны внутри них
+                map=""
+                [[ "$nt" -gt 1 ]] && map="--map-by slot:PE=$nt --bind-to core "
+                bind=""
+                [[ "$nt" -gt 1 ]] && bind=" --bind=close"
+                emit "$np" "$map$par_bin $RUNS $(size_args "$task" "$scaled" "$cols") --threads=$nt$bind $common"
+            done
+            [[ "$LAUNCHER" == lsf ]] && write_lsf "task${task}_par_${np}_s$base" $(( np * MAX_THREADS )) "${JOBS[@]}"
+        done
+    done
+done
+
+if [[ "$LAUNCHER" == local ]]; then
+    "$ROOT/scaling/report.sh" "$RESULTS" "$MODE"
+else
+    echo "Задания записаны в $OUT; постановка в очередь: $OUT/submit.sh"
+    echo "После выполнения: scaling/report.sh $RESULTS $MODE"
+fi
@@ -1,104 +1,394 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <mpi.h>
+#include <stdint.h>
+#include <string.h>
 #include <time.h>
 
-#define ARRAY_SIZE 1000000  
+#include "../common/arena.h"
+#include "../common/args.h"
+#include "../common/bench.h"
+#include "../common/coll.h"
+#include "../common/decomp.h"
+#include "../common/dtype.h"
+#include "../common/io.h"
+#include "../common/pipeline.h"
+#include "../common/rng.h"
+#include "../common/serve.h"
+#include "../common/simd.h"
+#include "../common/stream.h"
+#include "../common/trace.h"
 
-// Подсчёт суммы элементов локального массива
-int local_sum(int* array, int size) {
-    int sum = 0;
-    for (int i = 0; i < size; i++) {
-        sum += array[i];
+#define ARRAY_SIZE 1000000  // размер по умолчанию, задаётся параметром --n
+
+// Способ суммирования вещественных чисел
+typedef enum { METHOD_NAIVE, METHOD_KAHAN, METHOD_PAIRWISE } sum_method;
+
+static const char* method_names[] = { "naive", "kahan", "pairwise" };
+
+// Параметры суммирования
+typedef struct {
+    long long n;                 // размер массива
+    unsigned long long seed;     // начальное значение генератора
+    int local_gen;               // каждый процесс генерирует свой блок сам
+    const simd_kernels* kernels; // вариант векторных ядер
+    dtype dtype;
+    sum_method method;           // для float/double
+    int wide128;                 // для целых: глобальная сумма в 128 битах (для int64 — всегда)
+    int chunks;                  // число порций конвейерной раздачи (0 — одной операцией)
+    long long window;            // окно потокового режима (0 — блок целиком в памяти)
+    int dynamic;                 // окна всего массива берутся из общей очереди (--dynamic)
+    const char* input;           // файл с данными вместо генерации (NULL — генерация)
+    io_config io;                // способ чтения файла
+} sum_config;
+
+// Результат: целая сумма (64 или 128 бит) или вещественная сумма с поправкой
+typedef struct {
+    int64_t i64;
+#ifdef __SIZEOF_INT128__
+    __int128 i128;
+#endif
+    sum_pair f;
+} sum_result;
+
+// Заполнение элементов first..first+size-1 массива случайными числами от 0 до 99
+// (float/double — из [0, 100)). Каждый поток заполняет свой отрезок
+void fill_random(void* array, dtype type, long long size, long long first, unsigned long long seed) {
+    size_t elem = dtype_size(type);
+#pragma omp parallel
+    {
+        long long from, count;
+        threads_range(size, &from, &count);
+        dtype_fill((char*)array + from * elem, type, count, first + from, seed, 0, 0, 100);
+    }
+}
+
+// Пользовательские операции для свёртки сумм (coll_reduce): 128-битная сумма и сложение пар (сумма, поправка)
+#ifdef __SIZEOF_INT128__
+static void int128_sum_op(void* in, void* inout, int* len, MPI_Datatype* type) {
+    (void)type;
+    for (int i = 0; i < *len; i++) {
+        __int128 a, b;
+        memcpy(&a, (char*)in + i * sizeof(a), sizeof(a));
+        memcpy(&b, (char*)inout + i * sizeof(b), sizeof(b));
+        b += a;
+        memcpy((char*)inout + i * sizeof(b), &b, sizeof(b));
+    }
+}
+#endif
+
+static void sum_pair_op(void* in, void* inout, int* len, MPI_Datatype* type) {
+    (void)type;
+    sum_pair* a = (sum_pair*)in;
+    sum_pair* b = (sum_pair*)inout;
+    for (int i = 0; i < *len; i++)
+        b[i] = sum_pair_add(a[i], b[i]);
+}
+
+// Сумма отрезка блока
+static sum_result range_sum(const void* array, long long size, const sum_config* cfg) {
+    sum_result r;
+    memset(&r, 0, sizeof(r));
+    if (cfg->dtype == DTYPE_I32) {
+        r.i64 = cfg->kernels->sum_i32((const int*)array, size);
+#ifdef __SIZEOF_INT128__
+    } else if (cfg->dtype == DTYPE_I64) {
+        r.i128 = sum_i64_wide((const int64_t*)array, size);
+#endif
+    } else if (cfg->method == METHOD_KAHAN) {
+        r.f = cfg->dtype == DTYPE_F32 ? cfg->kernels->sum_f32_kahan((const float*)array, size)
+                                        : cfg->kernels->sum_f64_kahan((const double*)array, size);
+    } else if (cfg->method == METHOD_PAIRWISE) {
+        r.f.sum = cfg->dtype == DTYPE_F32 ? sum_pairwise_f32((const float*)array, size)
+                                            : sum_pairwise_f64((const double*)array, size);
+    } else {
+        r.f.sum = cfg->dtype == DTYPE_F32 ? sum_naive_f32((const float*)array, size)
+                                            : sum_naive_f64((const double*)array, size);
+    }
+    return r;
+}
+
+// Сложение частичных сумм способом, соответствующим типу и методу
+static sum_result sum_result_add(sum_result a, sum_result b, const sum_config* cfg) {
+    if (cfg->dtype == DTYPE_I32)
+        a.i64 += b.i64;
+#ifdef __SIZEOF_INT128__
+    else if (cfg->dtype == DTYPE_I64)
+        a.i128 += b.i128;
+#endif
+    else if (cfg->method == METHOD_KAHAN)
+        a.f = sum_pair_add(a.f, b.f);
+    else
+        a.f.sum += b.f.sum;
+    return a;
+}
+
+// Локальная сумма блока: каждый поток суммирует свой отрезок, частичные суммы
+// складываются в порядке номеров потоков, поэтому результат не зависит от планирования
+static sum_result local_sum(const void* array, long long size, const sum_config* cfg, sum_result* parts) {
+    const char* base = (const char*)array;
+    size_t elem = dtype_size(cfg->dtype);
+    int nt = 1;
+    trace_region tr = trace_begin("sum");
+#pragma omp parallel
+    {
+        long long from, count;
+        threads_range(size, &from, &count);
+        parts[threads_id()] = range_sum(base + from * elem, count, cfg);
+#pragma omp single
+        nt = threads_team_size();
     }
-    return sum;
+    trace_end(&tr);
+
+    sum_result r = parts[0];
+    for (int t = 1; t < nt; t++)
+        r = sum_result_add(r, parts[t], cfg);
+    return r;
 }
 
-// Заполнение массива случайными числами от 0 до 99
-void fill_random(int* array, int size) {
-    for (int i = 0; i < size; i++) {
-        array[i] = rand() % 100;
+// Конвейерная раздача с суммированием: порция k суммируется, пока порция k+1 в пути.
+// Суммы порций складываются по порядку, поэтому результат не зависит от сроков доставки
+static sum_result pipelined_sum(const pipe_plan* plan, const void* full_array, void* local_array,
+                                const sum_config* cfg, sum_result* parts) {
+    MPI_Datatype type = dtype_mpi(cfg->dtype);
+    size_t elem = dtype_size(cfg->dtype);
+    MPI_Request reqs[2];
+    sum_result r;
+    memset(&r, 0, sizeof(r));
+
+    pipe_iscatter(plan, 0, full_array, type, local_array, &reqs[0]);
+    for (int k = 0; k < plan->chunks; k++) {
+        MPI_Wait(&reqs[k % 2], MPI_STATUS_IGNORE);
+        if (k + 1 < plan->chunks) {
+            pipe_iscatter(plan, k + 1, full_array, type, local_array, &reqs[(k + 1) % 2]);
+            pipe_progress(1, &reqs[(k + 1) % 2]);
+        }
+
+        const char* chunk = (const char*)local_array + pipe_chunk_from(plan, k) * elem;
+        r = sum_result_add(r, local_sum(chunk, pipe_chunk_count(plan, k), cfg, parts), cfg);
     }
+    return r;
 }
 
-// Функция параллельного суммирования с N запусков
-double parallel_sum(int runs, int rank, int size, int* total_sum_out) {
-    // Проверка делимости размера массива
-    if (ARRAY_SIZE % size != 0) {
-        if (rank == 0) {
-            printf("Ошибка: размер массива (%d) не делится на количество процессов (%d) без остатка.\n",
-                   ARRAY_SIZE, size);
+// Потоковая сумма окнами плана plan по cfg->window элементов: окна блока по порядку или,
+// с очередью queue, любые свободные окна всего массива. Окно читается из файла in
+// (следующее — неблокирующе, пока суммируется текущее) или генерируется по глобальным
+// индексам; в памяти только два окна windows. Суммы окон складываются по порядку обработки
+static sum_result streamed_sum(const sum_config* cfg, const stream_plan* plan, stream_queue* queue, stream_file* in,
+                               void* windows[2], unsigned long long seed, sum_result* parts) {
+    sum_result r;
+    memset(&r, 0, sizeof(r));
+
+    MPI_Request req;
+    long long k = stream_next(plan, queue, 0), next = -1;
+    if (cfg->input && k >= 0)
+        stream_iread(in, plan, k, windows[0], &req);
+    for (long long j = 0; k >= 0; j++, k = next) {
+        void* window = windows[j % 2];
+        long long count = stream_window_count(plan, k);
+        if (cfg->input) {
+            if (!stream_wait(in, &req, count)) {
+                printf("Ошибка: не удалось прочитать файл '%s'.\n", cfg->input);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            next = stream_next(plan, queue, j + 1);
+            if (next >= 0)
+                stream_iread(in, plan, next, windows[(j + 1) % 2], &req);
+        } else {
+            trace_region tr = trace_begin("gen");
+            fill_random(window, cfg->dtype, count, stream_window_first(plan, k), seed);
+            trace_end(&tr);
         }
-        return -1.0;
+        r = sum_result_add(r, local_sum(window, count, cfg, parts), cfg);
+        if (!cfg->input)
+            next = stream_next(plan, queue, j + 1);  // без чтения наперёд окно берётся, когда процесс свободен
     }
+    return r;
+}
 
-    int local_size = ARRAY_SIZE / size;
-    int* local_array = (int*)malloc(sizeof(int) * local_size);
-    int* full_array = NULL;
+// Функция параллельного суммирования: warmup + runs итераций, время каждой записывается в серию series
+// Массив из n элементов делится на блоки, размеры которых отличаются не больше чем на 1.
+// При local_gen каждый процесс генерирует свой блок сам, и полного массива нет ни у кого.
+// int складываются в 64-битные накопители и собираются через MPI_INT64_T (или 128-битной
+// пользовательской операцией), int64 — в 128-битные, вещественные — парами (сумма, поправка).
+// При cfg->chunks > 0 раздача идёт порциями и перекрывается с суммированием.
+// При cfg->window > 0 блок проходится окнами внутри замера (streamed_sum), и массив целиком не хранится;
+// с очередью queue (--dynamic) окна всего массива разбираются процессами по мере готовности.
+// При cfg->input каждый процесс читает свой блок из файла, время чтения — в серию read_series.
+// Частичные суммы собираются на процессе 0 свёрткой cl (плоской или двухуровневой, --coll)
+// Буферы берутся из арены mem один раз до замеров
+void parallel_sum(bench* bm, int series, int read_series, int rank, int size, const sum_config* cfg,
+                  arena* mem, coll* cl, stream_queue* queue, sum_result* total_sum_out) {
+    long long n = cfg->n;
+    size_t elem = dtype_size(cfg->dtype);
+    MPI_Datatype type = dtype_mpi(cfg->dtype);
+    long long local_size = block_count(n, size, rank);
+    long long local_first = block_start(n, size, rank);
+    void* local_array = cfg->window > 0 ? NULL : arena_take(mem, elem, local_size);
+    void* full_array = rank == 0 && !cfg->local_gen && !cfg->input ? arena_take(mem, elem, n) : NULL;
 
-    if (rank == 0) {
-        full_array = (int*)malloc(sizeof(int) * ARRAY_SIZE);
-        if (!full_array) {
-            printf("Ошибка: не удалось выделить память под массив.\n");
+    // Потоковый режим: два окна и входной файл, открытый на все запуски
+    void* windows[2] = { NULL, NULL };
+    stream_file in;
+    stream_plan splan = { 0, 0, 0, 0 };
+    if (cfg->window > 0) {
+        if (cfg->dynamic)
+            stream_plan_init(&splan, 0, n, cfg->window);
+        else
+            stream_plan_init(&splan, local_first, local_size, cfg->window);
+        windows[0] = arena_take(mem, elem, cfg->window);
+        windows[1] = arena_take(mem, elem, cfg->window);
+        if (cfg->input && !stream_open_read(&in, cfg->input, type, MPI_COMM_WORLD)) {
+            if (rank == 0)
+                printf("Ошибка: не удалось открыть файл '%s'.\n", cfg->input);
             MPI_Abort(MPI_COMM_WORLD, 1);
         }
     }
+    sum_result* parts = (sum_result*)arena_take(mem, sizeof(sum_result), threads_count());
+
+    pipe_plan plan;
+    if (cfg->chunks > 0)
+        pipe_plan_init(&plan, n, cfg->chunks, 0, MPI_COMM_WORLD);
+
+    // Типы и операции для сбора сумм
+    MPI_Datatype pair_type;
+    MPI_Op pair_op;
+    MPI_Type_contiguous(2, MPI_DOUBLE, &pair_type);
+    MPI_Type_commit(&pair_type);
+    MPI_Op_create(sum_pair_op, 1, &pair_op);
+#ifdef __SIZEOF_INT128__
+    MPI_Datatype i128_type;
+    MPI_Op i128_op;
+    MPI_Type_contiguous(2, MPI_INT64_T, &i128_type);
+    MPI_Type_commit(&i128_type);
+    MPI_Op_create(int128_sum_op, 1, &i128_op);
+#endif
+
+    sum_result final_sum;
+    memset(&final_sum, 0, sizeof(final_sum));
 
-    double total_time = 0.0;
-    int final_sum = 0;
+    for (int it = 0; it < bench_iterations(bm); it++) {
+        int run = bench_is_warmup(bm, it) ? 0 : it - bm->warmup;  // прогрев идёт на данных первого запуска
+        trace_iteration(it);
+        if (queue)
+            stream_queue_begin(queue, it);
 
-    for (int run = 0; run < runs; run++) {
-        // Только главный процесс заполняет массив случайными числами
-        if (rank == 0) {
-            srand(time(NULL) + run);  // Новый seed
-            fill_random(full_array, ARRAY_SIZE);
+        // Каждый процесс читает свой блок из файла, либо главный процесс заполняет весь массив,
+        // либо каждый процесс — свой блок
+        if (cfg->window > 0) {
+            // в потоковом режиме окна читаются или генерируются внутри замера (streamed_sum)
+        } else if (cfg->input) {
+            bench_sync(bm, MPI_COMM_WORLD);
+            double read_start = MPI_Wtime();
+            trace_region tr = trace_begin("read");
+            int ok = io_read_block(&cfg->io, cfg->input, local_array, type, local_first, local_size, MPI_COMM_WORLD);
+            trace_end(&tr);
+            if (!ok) {
+                if (rank == 0)
+                    printf("Ошибка: не удалось прочитать файл '%s'.\n", cfg->input);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            bench_sync(bm, MPI_COMM_WORLD);
+            bench_record_span(bm, read_series, it, read_start, MPI_Wtime());
+        } else if (cfg->local_gen || rank == 0) {
+            trace_region tr = trace_begin("gen");
+            if (cfg->local_gen)
+                fill_random(local_array, cfg->dtype, local_size, local_first, cfg->seed + run);
+            else
+                fill_random(full_array, cfg->dtype, n, 0, cfg->seed + run);  // Новый seed
+            trace_end(&tr);
         }
 
         // синхронизация всех процессов перед началом замера времени
-        MPI_Barrier(MPI_COMM_WORLD);
+        bench_sync(bm, MPI_COMM_WORLD);
         double start_time = MPI_Wtime();
 
-        // Распределение данных
-        MPI_Scatter(full_array, local_size, MPI_INT,
-                    local_array, local_size, MPI_INT,
-                    0, MPI_COMM_WORLD);
-
-        // Локальная сумма
-        int local_part_sum = local_sum(local_array, local_size);
+        // Распределение данных и локальная сумма: одной раздачей или конвейером порций
+        sum_result local_part_sum;
+        if (cfg->window > 0) {
+            local_part_sum = streamed_sum(cfg, &splan, queue, &in, windows, cfg->seed + run, parts);
+        } else if (cfg->chunks > 0) {
+            local_part_sum = pipelined_sum(&plan, full_array, local_array, cfg, parts);
+        } else {
+            if (!cfg->local_gen && !cfg->input)
+                scatterv_blocks(full_array, n, type, local_array, 0, MPI_COMM_WORLD);
+            local_part_sum = local_sum(local_array, local_size, cfg, parts);
+        }
 
         // Сбор всех локальных сумм
-        int global_sum = 0;
-        MPI_Reduce(&local_part_sum, &global_sum, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+        sum_result global_sum;
+        memset(&global_sum, 0, sizeof(global_sum));
+        if (!dtype_is_int(cfg->dtype)) {
+            if (cfg->method == METHOD_KAHAN)
+                coll_reduce(cl, &local_part_sum.f, &global_sum.f, 1, pair_type, pair_op, 0);
+            else
+                coll_reduce(cl, &local_part_sum.f.sum, &global_sum.f.sum, 1, MPI_DOUBLE, MPI_SUM, 0);
+        }
+#ifdef __SIZEOF_INT128__
+        else if (cfg->wide128) {
+            if (cfg->dtype == DTYPE_I32)
+                local_part_sum.i128 = local_part_sum.i64;
+            coll_reduce(cl, &local_part_sum.i128, &global_sum.i128, 1, i128_type, i128_op, 0);
+        }
+#endif
+        else {
+            coll_reduce(cl, &local_part_sum.i64, &global_sum.i64, 1, MPI_INT64_T, MPI_SUM, 0);
+        }
 
         // синхронизация всех процессов перед окончанием замера времени
-        MPI_Barrier(MPI_COMM_WORLD);
+        bench_sync(bm, MPI_COMM_WORLD);
         double end_time = MPI_Wtime();
 
-        if (rank == 0) {
-            total_time += (end_time - start_time);
+        bench_record_span(bm, series, it, start_time, end_time);
+        if (rank == 0)
             final_sum = global_sum;  // Последняя сумма
-        }
     }
 
-    free(local_array);
-    if (rank == 0) free(full_array);
+    MPI_Op_free(&pair_op);
+    MPI_Type_free(&pair_type);
+#ifdef __SIZEOF_INT128__
+    MPI_Op_free(&i128_op);
+    MPI_Type_free(&i128_type);
+#endif
+
+    if (cfg->chunks > 0)
+        pipe_plan_free(&plan);
+    if (cfg->window > 0 && cfg->input)
+        stream_close(&in);
 
     if (rank == 0) *total_sum_out = final_sum;
-    return total_time / runs;
 }
 
-int main(int argc, char* argv[]) {
-    MPI_Init(&argc, &argv);
-
-    // Получаем номер текущего процесса (rank) и общее количество процессов (size)
-    int rank, size;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
+#ifdef __SIZEOF_INT128__
+// Десятичная запись 128-битного числа
+static void format_int128(__int128 v, char* buf) {
+    char tmp[48];
+    int len = 0, neg = v < 0;
+    unsigned __int128 u = neg ? -(unsigned __int128)v : (unsigned __int128)v;
+    do {
+        tmp[len++] = (char)('0' + (int)(u % 10));
+        u /= 10;
+    } while (u != 0);
+    if (neg) tmp[len++] = '-';
+    for (int i = 0; i < len; i++)
+        buf[i] = tmp[len - 1 - i];
+    buf[len] = '\0';
+}
+#endif
 
+// Одно задание: запуски суммирования с параметрами argv, как в командной строке.
+// Буферы берутся из арены mem, которая переживает задания служебного режима и растёт
+// только при нехватке. Возвращает 0 при успехе, 1 при ошибке в параметрах
+static int sum_job(int argc, char* argv[], int rank, int size, arena* mem) {
     if (argc < 2) {
         if (rank == 0)
-            printf("Использование: mpirun -np <процессы> %s <число запусков>\n", argv[0]);
-        MPI_Finalize();
+            printf("Использование: mpirun -np <процессы> %s <число запусков> [--n=<размер массива>] "
+                   "[--gen=root|local] [--input=<файл>] [--io=mpiio|mmap] [--cb-buffer=<байт>] [--cb-nodes=<число>] "
+                   "[--pipeline=<порций>] [--stream=<элементов окна>] [--dynamic] [--seed=<число>] [--simd=auto|scalar|avx2|avx512] "
+                   "[--dtype=int|int64|float|double] [--acc=i64|i128] [--sum=naive|kahan|pairwise] "
+                   "[--threads=<потоков>] [--bind=none|close|spread] [--arena=<байт>] [--huge] [--warmup=<число>] "
+                   "[--format=text|csv|json] [--out=<файл>] [--trace=<файл>] [--timing=barrier|local|global] [--coll=flat|hier]\n"
+                   "       mpirun -np <процессы> %s --serve=<файл или FIFO> [--trace=<файл>]\n", argv[0], argv[0]);
         return 1;
     }
 
@@ -106,18 +396,249 @@ int main(int argc, char* argv[]) {
     if (runs <= 0) {
         if (rank == 0)
             printf("Ошибка: количество запусков должно быть больше 0.\n");
-        MPI_Finalize();
         return 1;
     }
 
-    int final_sum = 0;
-    double avg_time = parallel_sum(runs, rank, size, &final_sum);
+    sum_config cfg;
+    memset(&cfg, 0, sizeof(cfg));
+
+    // Генерация данных: целиком на процессе 0 с раздачей (root) или по блокам на месте (local)
+    const char* gen_mode = arg_str(argc, argv, "--gen", "root");
+    cfg.local_gen = strcmp(gen_mode, "local") == 0;
+    if (!cfg.local_gen && strcmp(gen_mode, "root") != 0) {
+        if (rank == 0)
+            printf("Ошибка: неизвестный режим генерации '%s' (root или local).\n", gen_mode);
+        return 1;
+    }
+
+    // Тип элементов, накопитель глобальной суммы для int и способ суммирования для float/double
+    const char* acc = arg_str(argc, argv, "--acc", "i64");
+    const char* method = arg_str(argc, argv, "--sum", "kahan");
+    cfg.method = strcmp(method, "naive") == 0 ? METHOD_NAIVE
+               : strcmp(method, "pairwise") == 0 ? METHOD_PAIRWISE : METHOD_KAHAN;
+    cfg.wide128 = strcmp(acc, "i128") == 0;
+    if (!dtype_parse(arg_str(argc, argv, "--dtype", "int"), &cfg.dtype) || strcmp(method_names[cfg.method], method) != 0
+        || (!cfg.wide128 && strcmp(acc, "i64") != 0)) {
+        if (rank == 0)
+            printf("Ошибка: неизвестное значение --dtype, --acc или --sum.\n");
+        return 1;
+    }
+    cfg.wide128 = cfg.wide128 || cfg.dtype == DTYPE_I64;
+#ifndef __SIZEOF_INT128__
+    if (cfg.wide128) {
+        if (rank == 0)
+            printf("Ошибка: компилятор не поддерживает 128-битные целые.\n");
+        return 1;
+    }
+#endif
+
+    // Данные из файла (--input, элементы типа --dtype): размер массива определяется по файлу
+    cfg.input = arg_value(argc, argv, "--input");
+    if (cfg.input && (cfg.n = io_file_count(cfg.input, (int)dtype_size(cfg.dtype), MPI_COMM_WORLD)) < 0) {
+        if (rank == 0)
+            printf("Ошибка: файл '%s' не открывается или его размер не кратен размеру элемента.\n", cfg.input);
+        return 1;
+    }
+
+    // Потоковый режим (--stream=<элементов окна>): блок процесса проходится окнами,
+    // окна генерируются на месте (как при --gen=local) или читаются из --input
+    cfg.window = stream_window_arg(argc, argv);
+    if (cfg.window < 0) {
+        if (rank == 0)
+            printf("Ошибка: некорректный размер окна --stream (не больше %d элементов).\n", INT_MAX);
+        return 1;
+    }
+    if (cfg.window > 0)
+        cfg.local_gen = 1;
+
+    // Динамическое распределение (--dynamic): окна потокового режима берутся из общей очереди
+    cfg.dynamic = arg_flag(argc, argv, "--dynamic");
+    if (cfg.dynamic && cfg.window == 0) {
+        if (rank == 0)
+            printf("Ошибка: --dynamic работает только с --stream=<элементов окна>.\n");
+        return 1;
+    }
+
+    // Размер массива: число с необязательным суффиксом K/M/G; в потоковом режиме блок
+    // процесса не ограничен, ограничено только окно
+    if (!cfg.input)
+        cfg.n = arg_size(argc, argv, "--n", ARRAY_SIZE);
+    if (cfg.n <= 0 || (cfg.window == 0 && !decomp_fits(cfg.n, size))) {
+        if (rank == 0)
+            printf("Ошибка: некорректный размер массива или блок процесса больше %d элементов.\n", INT_MAX);
+        return 1;
+    }
+
+    // Конвейерная раздача порциями (только при генерации на процессе 0)
+    cfg.chunks = (int)arg_long(argc, argv, "--pipeline", 0);
+    if (cfg.chunks < 0 || (cfg.chunks > 0 && (cfg.local_gen || cfg.input || cfg.n > INT_MAX))) {
+        if (rank == 0)
+            printf("Ошибка: --pipeline требует --gen=root (без --stream) и массива не больше %d элементов.\n",
+                   INT_MAX);
+        return 1;
+    }
+
+    // Начальное значение генератора: --seed или текущее время процесса 0
+    cfg.seed = (unsigned long long)arg_long(argc, argv, "--seed", (long long)time(NULL));
+    MPI_Bcast(&cfg.seed, 1, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+
+    // Вариант векторных ядер: auto (по CPUID), scalar, avx2 или avx512
+    cfg.kernels = simd_setup(arg_str(argc, argv, "--simd", "auto"), rank == 0);
+    if (!cfg.kernels) {
+        if (rank == 0)
+            printf("Ошибка: вариант --simd неизвестен или не поддерживается процессором.\n");
+        return 1;
+    }
+
+    // Потоки процесса: --threads и привязка --bind
+    int threads = threads_setup(argc, argv, rank == 0);
+    if (!threads) {
+        if (rank == 0)
+            printf("Ошибка: некорректное значение --threads или --bind.\n");
+        return 1;
+    }
+
+    // Свёртки по процессам (--coll): плоские или двухуровневые через общую память узла
+    int coll_arg = coll_mode_arg(argc, argv);
+    if (coll_arg < 0) {
+        if (rank == 0)
+            printf("Ошибка: неизвестный режим свёрток --coll (flat или hier).\n");
+        return 1;
+    }
+
+    // Измерения: --warmup, --format, --out
+    bench bm;
+    if (!bench_init(&bm, "task1_par", runs, argc, argv)) {
+        if (rank == 0)
+            printf("Ошибка: некорректное значение --warmup, --format или --timing.\n");
+        return 1;
+    }
+
+    // Способ чтения файла и подсказки MPI-IO (--io, --cb-buffer, --cb-nodes). Проверяется последним:
+    // до этого места задание ничего не выделяет, после него — не прерывается (служебный режим без утечек)
+    if (!io_setup(&cfg.io, argc, argv)) {
+        if (rank == 0)
+            printf("Ошибка: некорректное значение --io, --cb-buffer или --cb-nodes.\n");
+        return 1;
+    }
+
+    // Режим замера (--timing): в режиме global — выравнивание часов процессов
+    bench_timing_setup(&bm, MPI_COMM_WORLD);
+    coll cl;
+    coll_setup(&cl, MPI_COMM_WORLD, (coll_mode)coll_arg);
+    bench_param(&bm, "coll", "%s", coll_mode_names[coll_arg]);
+    bm.threads = threads;
+    bm.size = cfg.n;
+    bench_param(&bm, "dtype", "%s", dtype_names[cfg.dtype]);
+    if (dtype_is_int(cfg.dtype))
+        bench_param(&bm, "acc", "%s", cfg.wide128 ? "i128" : "i64");
+    else
+        bench_param(&bm, "sum", "%s", method_names[cfg.method]);
+    bench_param(&bm, "gen", "%s", cfg.input ? "file" : cfg.local_gen ? "local" : "root");
+    bench_param(&bm, "pipeline", "%d", cfg.chunks);
+    bench_param(&bm, "stream", "%lld", cfg.window);
+    bench_param(&bm, "dynamic", "%d", cfg.dynamic);
+    bench_param(&bm, "simd", "%s", cfg.kernels->name);
+    int series = bench_series_add(&bm, "sum", "Сумма");
+    int read_series = cfg.input && cfg.window == 0 ? bench_series_add(&bm, "read", "Чтение файла") : -1;
+
+    // Арена процесса: блок (в потоковом режиме — два окна), полный массив на процессе 0
+    // (при генерации на нём) и частичные суммы потоков
+    size_t elem = dtype_size(cfg.dtype);
+    long long held = cfg.window > 0 ? 2 * cfg.window : block_count(cfg.n, size, rank);
+    size_t needed = elem * (size_t)held + sizeof(sum_result) * threads + ARENA_SLACK;
+    if (rank == 0 && !cfg.local_gen && !cfg.input)
+        needed += elem * cfg.n;
+    if (!arena_ensure(mem, argc, argv, needed)) {
+        if (rank == 0)
+            printf("Ошибка: некорректное значение --arena или не удалось зарезервировать память.\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    stream_queue queue;
+    if (cfg.dynamic)
+        stream_queue_setup(&queue, bench_iterations(&bm), MPI_COMM_WORLD);
+
+    sum_result final_sum;
+    parallel_sum(&bm, series, read_series, rank, size, &cfg, mem, &cl, cfg.dynamic ? &queue : NULL, &final_sum);
+    bench_reduce_max(&bm, 0, &cl);
 
     if (rank == 0) {
-        printf("Среднее время за %d запусков: %f секунд(ы)\n", runs, avg_time);
-        printf("Сумма элементов массива (последний запуск): %d\n", final_sum);
+        printf("Размер массива: %lld, процессов: %d, потоков: %d, ядро: %s\n", cfg.n, size, threads,
+               cfg.kernels->name);
+        bench_report(&bm);
+        // Пропускная способность — по медиане и полному объёму массива
+        printf("%s: %.2f ГБ/с\n", cfg.window > 0 ? "Потоковая сумма окнами" : "Сумма",
+               (double)elem * cfg.n / bench_series_stats(&bm, series).median / 1e9);
+        if (!dtype_is_int(cfg.dtype)) {
+            printf("Сумма элементов массива (последний запуск, %s, %s): %.17g\n",
+                   dtype_names[cfg.dtype], method_names[cfg.method], final_sum.f.sum + final_sum.f.err);
+        }
+#ifdef __SIZEOF_INT128__
+        else if (cfg.wide128) {
+            char buf[48];
+            format_int128(final_sum.i128, buf);
+            printf("Сумма элементов массива (последний запуск, int128): %s\n", buf);
+        }
+#endif
+        else {
+            printf("Сумма элементов массива (последний запуск): %lld\n", (long long)final_sum.i64);
+        }
+        bench_write(&bm);
     }
+    if (cfg.dynamic) {
+        stream_queue_report(&queue, 0, MPI_COMM_WORLD);
+        stream_queue_free(&queue);
+    }
+    arena_report(mem, 0, MPI_COMM_WORLD);
 
-    MPI_Finalize();
+    bench_free(&bm);
+    coll_free(&cl);
+    io_free(&cfg.io);
     return 0;
 }
+
+int main(int argc, char* argv[]) {
+    threads_mpi_init(&argc, &argv);
+
+    // Получаем номер текущего процесса (rank) и общее количество процессов (size)
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    // Трассировка (--trace=<файл>): до первой параллельной области, чтобы счётчики унаследовали потоки
+    if (!trace_setup(argc, argv, MPI_COMM_WORLD)) {
+        if (rank == 0)
+            printf("Ошибка: не удалось выделить буфер трассы.\n");
+        MPI_Finalize();
+        return 1;
+    }
+
+    // Служебный режим (--serve): процессы остаются запущенными и выполняют задания из файла или FIFO
+    // одно за другим с общей ареной; без него — одно задание из командной строки
+    arena mem = { NULL, 0, 0, 0, 0, 0 };
+    const char* serve_path = arg_value(argc, argv, "--serve");
+    int status = 0;
+    if (serve_path) {
+        serve sv;
+        if (!serve_open(&sv, serve_path, argv[0], "task1", MPI_COMM_WORLD)) {
+            if (rank == 0)
+                printf("Ошибка: не удалось открыть поток заданий '%s'.\n", serve_path);
+            MPI_Finalize();
+            return 1;
+        }
+        while (serve_next(&sv, MPI_COMM_WORLD)) {
+            double start = MPI_Wtime();
+            int code = sv.argc > 0 ? sum_job(sv.argc, sv.argv, rank, size, &mem) : 1;
+            serve_done(&sv, code, start, MPI_COMM_WORLD);
+        }
+        serve_close(&sv, MPI_COMM_WORLD);
+    } else {
+        status = sum_job(argc, argv, rank, size, &mem);
+    }
+
+    trace_finish(0, MPI_COMM_WORLD);
+    arena_free(&mem);
+    MPI_Finalize();
+    return status;
+}
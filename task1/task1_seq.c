@@ -1,29 +1,84 @@
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
-#define ARRAY_SIZE 1000000
+#include "../common/args.h"
+#include "../common/bench.h"
+#include "../common/dtype.h"
+#include "../common/sum.h"
 
-// последовательная сумма
-int sequential_sum(int* array, int size) {
-    int sum = 0;
-    for (int i = 0; i < size; i++) {
-        sum += array[i];
+#define ARRAY_SIZE 1000000  // размер по умолчанию, задаётся параметром --n
+
+// Способ суммирования вещественных чисел (как в task1_par)
+typedef enum { METHOD_NAIVE, METHOD_KAHAN, METHOD_PAIRWISE } sum_method;
+
+static const char* method_names[] = { "naive", "kahan", "pairwise" };
+
+// Результат: целая сумма (64 или 128 бит) или вещественная сумма с поправкой
+typedef struct {
+    int64_t i64;
+#ifdef __SIZEOF_INT128__
+    __int128 i128;
+#endif
+    sum_pair f;
+} sum_result;
+
+// Последовательная сумма массива типа type скалярными ядрами common/sum.h: int — в 64-битном
+// накопителе (int переполняется уже на ~2*10^7 элементов), int64 — в 128-битном,
+// float/double — способом method
+sum_result sequential_sum(const void* array, dtype type, sum_method method, long long size) {
+    sum_result r;
+    memset(&r, 0, sizeof(r));
+    if (type == DTYPE_I32) {
+        r.i64 = sum_i32_wide((const int*)array, size);
+#ifdef __SIZEOF_INT128__
+    } else if (type == DTYPE_I64) {
+        r.i128 = sum_i64_wide((const int64_t*)array, size);
+#endif
+    } else if (method == METHOD_KAHAN) {
+        r.f = type == DTYPE_F32 ? sum_kahan_f32((const float*)array, size)
+                                : sum_kahan_f64((const double*)array, size);
+    } else if (method == METHOD_PAIRWISE) {
+        r.f.sum = type == DTYPE_F32 ? sum_pairwise_f32((const float*)array, size)
+                                    : sum_pairwise_f64((const double*)array, size);
+    } else {
+        r.f.sum = type == DTYPE_F32 ? sum_naive_f32((const float*)array, size)
+                                    : sum_naive_f64((const double*)array, size);
     }
-    return sum;
+    return r;
 }
 
-// заполнение массива случайными числами
-void fill_random(int* array, int size) {
-    for (int i = 0; i < size; i++) {
-        array[i] = rand() % 100;
-    }
+// заполнение массива случайными числами от 0 до 99, float/double — из [0, 100)
+// (тот же генератор, что и в task1_par)
+void fill_random(void* array, dtype type, long long size, unsigned long long seed) {
+    dtype_fill(array, type, size, 0, seed, 0, 0, 100);
+}
+
+#ifdef __SIZEOF_INT128__
+// Десятичная запись 128-битного числа
+static void format_int128(__int128 v, char* buf) {
+    char tmp[48];
+    int len = 0, neg = v < 0;
+    unsigned __int128 u = neg ? -(unsigned __int128)v : (unsigned __int128)v;
+    do {
+        tmp[len++] = (char)('0' + (int)(u % 10));
+        u /= 10;
+    } while (u != 0);
+    if (neg) tmp[len++] = '-';
+    for (int i = 0; i < len; i++)
+        buf[i] = tmp[len - 1 - i];
+    buf[len] = '\0';
 }
+#endif
 
 int main(int argc, char* argv[]) {
     // если количество запусков не было передано
     if (argc < 2) {
-        printf("Используйте: %s <количество запусков>\n", argv[0]);
+        printf("Используйте: %s <количество запусков> [--n=<размер массива>] [--seed=<число>] "
+               "[--dtype=int|int64|float|double] [--acc=i64|i128] [--sum=naive|kahan|pairwise]\n"
+               "       [--warmup=<число>] [--format=text|csv|json] [--out=<файл>]\n", argv[0]);
         return 1;
     }
 
@@ -33,35 +88,91 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    long long n = arg_size(argc, argv, "--n", ARRAY_SIZE);
+    if (n <= 0) {
+        printf("Некорректный размер массива.\n");
+        return 1;
+    }
+
+    unsigned long long seed = (unsigned long long)arg_long(argc, argv, "--seed", (long long)time(NULL));
+
+    // Тип элементов, накопитель суммы для int и способ суммирования для float/double — как в task1_par
+    dtype type;
+    const char* acc = arg_str(argc, argv, "--acc", "i64");
+    const char* method_arg = arg_str(argc, argv, "--sum", "kahan");
+    sum_method method = strcmp(method_arg, "naive") == 0 ? METHOD_NAIVE
+                      : strcmp(method_arg, "pairwise") == 0 ? METHOD_PAIRWISE : METHOD_KAHAN;
+    int wide128 = strcmp(acc, "i128") == 0;
+    if (!dtype_parse(arg_str(argc, argv, "--dtype", "int"), &type) || strcmp(method_names[method], method_arg) != 0
+        || (!wide128 && strcmp(acc, "i64") != 0)) {
+        printf("Ошибка: неизвестное значение --dtype, --acc или --sum.\n");
+        return 1;
+    }
+    wide128 = wide128 || type == DTYPE_I64;
+#ifndef __SIZEOF_INT128__
+    if (wide128) {
+        printf("Ошибка: компилятор не поддерживает 128-битные целые.\n");
+        return 1;
+    }
+#endif
+
+    // Измерения: --warmup, --format, --out
+    bench bm;
+    if (!bench_init(&bm, "task1_seq", runs, argc, argv)) {
+        printf("Некорректное значение --warmup или --format.\n");
+        return 1;
+    }
+    bm.size = n;
+    bench_param(&bm, "dtype", "%s", dtype_names[type]);
+    if (dtype_is_int(type))
+        bench_param(&bm, "acc", "%s", wide128 ? "i128" : "i64");
+    else
+        bench_param(&bm, "sum", "%s", method_names[method]);
+    int series = bench_series_add(&bm, "sum", "Сумма");
 
-    int* array = (int*)malloc(sizeof(int) * ARRAY_SIZE);
+    void* array = malloc(dtype_size(type) * n);
     if (!array) {
         printf("Ошибка: не удалось выделить память под массив.\n");
         return 1;
     }
-    
-    double total_time = 0.0;
-    int total_sum = 0;
 
-    for (int run = 0; run < runs; run++) {
-        
-        srand(time(NULL) + run); 
-        fill_random(array, ARRAY_SIZE);
-        
-        clock_t start = clock();
+    sum_result total_sum;
+    memset(&total_sum, 0, sizeof(total_sum));
 
-        int sum = sequential_sum(array, ARRAY_SIZE);
+    for (int it = 0; it < bench_iterations(&bm); it++) {
+        int run = bench_is_warmup(&bm, it) ? 0 : it - bm.warmup;  // прогрев идёт на данных первого запуска
 
-        clock_t end = clock();
+        fill_random(array, type, n, seed + run);
 
-        double elapsed = (double)(end - start) / CLOCKS_PER_SEC;
-        total_time += elapsed;
+        double start = bench_now();
+
+        sum_result sum = sequential_sum(array, type, method, n);
+
+        double end = bench_now();
+
+        bench_record(&bm, series, it, end - start);
         total_sum = sum;
     }
 
-    printf("Среднее время за %d запусков: %f секунд(ы)\n", runs, total_time / runs);
-    printf("Сумма элементов массива: %d\n", total_sum);
+    printf("Размер массива: %lld (%s)\n", n, dtype_names[type]);
+    bench_report(&bm);
+    if (!dtype_is_int(type)) {
+        printf("Сумма элементов массива (%s, %s): %.17g\n", dtype_names[type], method_names[method],
+               total_sum.f.sum + total_sum.f.err);
+    }
+#ifdef __SIZEOF_INT128__
+    else if (wide128) {
+        char buf[48];
+        format_int128(type == DTYPE_I64 ? total_sum.i128 : (__int128)total_sum.i64, buf);
+        printf("Сумма элементов массива (int128): %s\n", buf);
+    }
+#endif
+    else {
+        printf("Сумма элементов массива: %lld\n", (long long)total_sum.i64);
+    }
+    bench_write(&bm);
 
+    bench_free(&bm);
     free(array);
     return 0;
 }
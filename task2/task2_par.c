@@ -1,38 +1,93 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <string.h>
 #include <mpi.h>
 
-#define ARRAY_SIZE 200000  // должен быть кратен числу процессов
+#include "../common/arena.h"
+#include "../common/args.h"
+#include "../common/bench.h"
+#include "../common/coll.h"
+#include "../common/decomp.h"
+#include "../common/dtype.h"
+#include "../common/io.h"
+#include "../common/rng.h"
+#include "../common/serve.h"
+#include "../common/shm.h"
+#include "../common/sort.h"
+#include "../common/threads.h"
+#include "../common/trace.h"
 
-// заполнение массива числами от 0 до 999
-void fill_random(int* array, int size) {
-    for (int i = 0; i < size; i++) {
-        array[i] = rand() % 1000;
+#define ARRAY_SIZE 200000  // размер по умолчанию, задаётся параметром --n
+
+// заполнение элементов first..first+size-1 массива числами от 0 до 999 (вещественные — из [0, 1000));
+// каждый поток заполняет свой отрезок
+void fill_random(void* array, dtype type, long long size, long long first, unsigned long long seed) {
+    size_t elem = dtype_size(type);
+#pragma omp parallel
+    {
+        long long from, count;
+        threads_range(size, &from, &count);
+        dtype_fill((char*)array + from * elem, type, count, first + from, seed, 0, 0, 1000);
     }
 }
 
-// Последовательная пузырьковая сортировка для одного подмассива
-void bubble_sort(int* arr, int n) {
-    for (int i = 0; i < n - 1; ++i) {
-        for (int j = 0; j < n - i - 1; ++j) {
-            if (arr[j] > arr[j + 1]) {
-                int tmp = arr[j];
-                arr[j] = arr[j + 1];
-                arr[j + 1] = tmp;
-            }
-        }
+// Локальная сортировка блока на потоках процесса: каждый поток сортирует свой отрезок,
+// затем отрезки сливаются k-путевым слиянием. В одном потоке — обычная интроспективная сортировка.
+// Буфер слияния берётся из арены mem и возвращается в неё
+void local_sort(arena* mem, dtype type, void* arr, long long n) {
+    const sort_kernels* ops = &sort_table[type];
+    size_t elem = dtype_size(type);
+    int nt = threads_count();
+    if (nt <= 1 || n < (long long)nt * THREADS_GRAIN) {
+        ops->sort(arr, n);
+        return;
+    }
+
+    size_t mark = arena_mark(mem);
+    void** runs = (void**)arena_take(mem, sizeof(void*), nt);
+    long long* lens = (long long*)arena_take(mem, sizeof(long long), nt);
+#pragma omp parallel
+    {
+        long long from, count;
+        threads_range(n, &from, &count);
+        ops->sort((char*)arr + from * elem, count);
+        runs[threads_id()] = (char*)arr + from * elem;
+        lens[threads_id()] = count;
     }
+
+    void* merged = arena_take(mem, elem, n);
+    ops->kway_merge(runs, lens, nt, merged, arena_take(mem, 1, (long long)sort_kway_scratch(nt)));
+    memcpy(arr, merged, elem * n);
+    arena_reset(mem, mark);
 }
 
-// Параллельная пузырьковая сортировка с четно-нечетными фазами обмена
-void parallel_bubble_sort(int* local_arr, int local_size, int rank, int size) {
-    int* buffer = (int*)malloc(sizeof(int) * local_size);  // буфер для получения данных от соседа
+// Параллельная пузырьковая сортировка с четно-нечетными фазами обмена.
+// Блок сортируется локально один раз, далее на каждой фазе соседи
+// обмениваются блоками и выполняют линейное слияние-разделение.
+// Блоки соседей могут отличаться на 1 элемент (n не кратно числу процессов).
+// С общей памятью узла (wins не NULL: блок процесса в wins[0], запасной блок в wins[1])
+// сосед на том же узле читает блок партнёра на месте, а сообщения — только два
+// синхронизирующих на фазу; с соседом на другом узле блоки пересылаются как обычно.
+void parallel_bubble_sort(arena* mem, dtype type, void* local_arr, int local_size, long long n, int rank, int size,
+                          const shm_node* node, const shm_window* wins) {
+    const sort_kernels* ops = &sort_table[type];
+    size_t elem = dtype_size(type);
 
-    for (int phase = 0; phase < size; ++phase) {
-        // Локальная сортировка своей части массива
-        bubble_sort(local_arr, local_size);
+    // Локальная сортировка своей части массива
+    trace_region tr = trace_begin("local_sort");
+    local_sort(mem, type, local_arr, local_size);
+    trace_end(&tr);
 
+    // Буферы берутся из арены один раз на запуск и переиспользуются во всех фазах
+    size_t mark = arena_mark(mem);
+    int max_size = (int)block_count(n, size, 0);
+    void* buffer = arena_take(mem, elem, max_size);     // блок соседа
+    void* scratch = wins ? wins[1].base : arena_take(mem, elem, local_size);  // результат слияния
+    void* current = local_arr;
+    int in_spare = 0;  // текущий блок лежит в запасном сегменте окна
+
+    for (int phase = 0; phase < size; ++phase) {
         // Определяем партнёра для обмена
         int partner = (phase % 2 == 0)
             ? (rank % 2 == 0 ? rank + 1 : rank - 1)
@@ -42,103 +97,585 @@ void parallel_bubble_sort(int* local_arr, int local_size, int rank, int size) {
         if (partner < 0 || partner >= size)
             continue;
 
-        // Обмен массивами с партнёром
-        MPI_Sendrecv(local_arr, local_size, MPI_INT, partner, 0,
-                     buffer, local_size, MPI_INT, partner, 0,
-                     MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        // Обмен массивами с партнёром; на том же узле блок партнёра читается из общего окна,
+        // когда партнёр закончил прошлую фазу, и партнёр ждёт, пока мы его дочитаем
+        int partner_size = (int)block_count(n, size, partner);
+        int shared = wins && shm_same_node(node, partner);
+        const void* other = buffer;
+        if (shared) {
+            int theirs = shm_pair_sync(wins, 2, in_spare, partner, 1, MPI_COMM_WORLD);
+            other = shm_window_peer(&wins[theirs], node, partner);
+        } else {
+            MPI_Sendrecv(current, local_size, dtype_mpi(type), partner, 0,
+                         buffer, partner_size, dtype_mpi(type), partner, 0,
+                         MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        }
+
+        // Младший ранг получает меньшую половину, старший — большую
+        tr = trace_begin("merge_split");
+        if (rank < partner)
+            ops->merge_split_low(current, local_size, other, partner_size, scratch);
+        else
+            ops->merge_split_high(current, local_size, other, partner_size, scratch);
+        trace_end(&tr);
+        if (shared)
+            shm_pair_sync(wins, 2, 0, partner, 2, MPI_COMM_WORLD);
+
+        // Результат слияния становится текущим блоком
+        void* tmp = current;
+        current = scratch;
+        scratch = tmp;
+        in_spare = !in_spare;
+    }
+
+    if (current != local_arr)
+        memcpy(local_arr, current, elem * local_size);
+
+    arena_reset(mem, mark);  // возвращаем буферы арене
+}
 
-        // Объединяем два подмассива
-        int* merged = (int*)malloc(sizeof(int) * 2 * local_size);
-        for (int i = 0; i < local_size; ++i) {
-            merged[i] = local_arr[i];
-            merged[i + local_size] = buffer[i];
+// Параллельная сортировка регулярной выборкой (PSRS):
+// локальная интроспективная сортировка, выбор разделителей по регулярной выборке,
+// обмен блоками через MPI_Alltoallv и k-путевое слияние полученных отрезков.
+// Результат (отсортированный блок переменной длины, его длина известна только после обмена)
+// и временные буферы берутся из арены mem и остаются в ней до отката вызывающим,
+// в *result — начало блока; возвращается число элементов блока.
+long long parallel_sample_sort(arena* mem, dtype type, void* local_arr, int local_size, void** result, int size) {
+    const sort_kernels* ops = &sort_table[type];
+    size_t elem = dtype_size(type);
+    MPI_Datatype mpi_type = dtype_mpi(type);
+    const char* local_bytes = (const char*)local_arr;
+    trace_region tr = trace_begin("local_sort");
+    local_sort(mem, type, local_arr, local_size);
+    trace_end(&tr);
+
+    // Регулярная выборка: size равномерно расположенных элементов с каждого процесса
+    // (у пустого блока — нули)
+    char* samples = (char*)arena_take(mem, elem, size);
+    char* all_samples = (char*)arena_take(mem, elem, (long long)size * size);
+    memset(samples, 0, elem * size);
+    for (int i = 0; local_size > 0 && i < size; ++i)
+        memcpy(samples + i * elem, local_bytes + (long long)i * local_size / size * elem, elem);
+
+    MPI_Allgather(samples, size, mpi_type, all_samples, size, mpi_type, MPI_COMM_WORLD);
+    ops->sort(all_samples, (long long)size * size);
+
+    // Разделители: size - 1 элементов из отсортированной выборки с шагом size
+    int* send_counts = (int*)arena_take(mem, sizeof(int), size);
+    int* send_displs = (int*)arena_take(mem, sizeof(int), size);
+    int* recv_counts = (int*)arena_take(mem, sizeof(int), size);
+    int* recv_displs = (int*)arena_take(mem, sizeof(int), size);
+
+    long long prev = 0;
+    for (int i = 0; i < size; ++i) {
+        long long bound = local_size;
+        if (i < size - 1) {
+            const char* splitter = all_samples + ((long long)(i + 1) * size + size / 2 - 1) * elem;
+            bound = ops->upper_bound(local_arr, local_size, splitter);
+            if (bound < prev)
+                bound = prev;
         }
+        send_counts[i] = (int)(bound - prev);
+        send_displs[i] = (int)prev;
+        prev = bound;
+    }
 
-        // Сортируем объединённый массив
-        bubble_sort(merged, 2 * local_size);
+    MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT, MPI_COMM_WORLD);
 
-        // Разделяем обратно: младший ранг получает меньшую половину
-        if (rank < partner) {
-            for (int i = 0; i < local_size; ++i)
-                local_arr[i] = merged[i];
-        } else {
-            for (int i = 0; i < local_size; ++i)
-                local_arr[i] = merged[i + local_size];
+    long long recv_total = 0;
+    for (int i = 0; i < size; ++i) {
+        recv_displs[i] = (int)recv_total;
+        recv_total += recv_counts[i];
+    }
+
+    char* recv_buf = (char*)arena_take(mem, elem, recv_total);
+    MPI_Alltoallv(local_arr, send_counts, send_displs, mpi_type,
+                  recv_buf, recv_counts, recv_displs, mpi_type, MPI_COMM_WORLD);
+    *result = arena_take(mem, elem, recv_total);
+
+    // От каждого процесса пришёл отсортированный отрезок: сливаем их
+    void** runs = (void**)arena_take(mem, sizeof(void*), size);
+    long long* lens = (long long*)arena_take(mem, sizeof(long long), size);
+    for (int i = 0; i < size; ++i) {
+        runs[i] = recv_buf + (long long)recv_displs[i] * elem;
+        lens[i] = recv_counts[i];
+    }
+    void* scratch = arena_take(mem, 1, (long long)sort_kway_scratch(size));
+    tr = trace_begin("kway_merge");
+    ops->kway_merge(runs, lens, size, *result, scratch);
+    trace_end(&tr);
+    return recv_total;
+}
+
+// Параллельная поразрядная LSD-сортировка для ключей из [key_min, key_max].
+// На каждом проходе блок устойчиво распределяется по цифре локально, по гистограммам
+// всех процессов вычисляются глобальные позиции элементов, и элементы пересылаются
+// владельцам этих позиций одним MPI_Alltoallv. Размеры блоков при этом сохраняются.
+void parallel_radix_sort(arena* mem, int* local_arr, int local_size, int key_min, int key_max, int rank, int size) {
+    int passes, digit_bits;
+    radix_plan(key_min, key_max, &passes, &digit_bits);
+    if (passes == 0)
+        return;
+
+    size_t mark = arena_mark(mem);
+    int buckets = 1 << digit_bits;
+    int* tmp = (int*)arena_take(mem, sizeof(int), local_size);
+    int* recv_buf = (int*)arena_take(mem, sizeof(int), local_size);
+    long long* hist = (long long*)arena_take(mem, sizeof(long long), buckets);
+    long long* all_hist = (long long*)arena_take(mem, sizeof(long long), (long long)buckets * size);
+    long long* offsets = (long long*)arena_take(mem, sizeof(long long), (long long)buckets * size);
+    int* send_counts = (int*)arena_take(mem, sizeof(int), size);
+    int* send_displs = (int*)arena_take(mem, sizeof(int), size);
+    int* recv_counts = (int*)arena_take(mem, sizeof(int), size);
+    int* recv_displs = (int*)arena_take(mem, sizeof(int), size);
+    void* scratch = arena_take(mem, 1, (long long)RADIX_SCATTER_SCRATCH);  // строки и счётчики распределения
+
+    // Границы блоков: процесс r владеет глобальными позициями [block_start[r], block_start[r + 1])
+    long long my_size = local_size;
+    long long* block_start = (long long*)arena_take(mem, sizeof(long long), size + 1);
+    MPI_Allgather(&my_size, 1, MPI_LONG_LONG, block_start + 1, 1, MPI_LONG_LONG, MPI_COMM_WORLD);
+    block_start[0] = 0;
+    for (int r = 0; r < size; ++r)
+        block_start[r + 1] += block_start[r];
+    long long my_lo = block_start[rank], my_hi = block_start[rank + 1];
+
+    for (int p = 0; p < passes; ++p) {
+        int shift = p * digit_bits;
+
+        // Локальное устойчивое распределение по текущей цифре
+        trace_region tr = trace_begin("radix_pass");
+        radix_histogram(local_arr, local_size, key_min, shift, digit_bits, hist);
+        radix_scatter(local_arr, tmp, local_size, key_min, shift, digit_bits, hist, scratch);
+        trace_end(&tr);
+        MPI_Allgather(hist, buckets, MPI_LONG_LONG, all_hist, buckets, MPI_LONG_LONG, MPI_COMM_WORLD);
+
+        // Глобальная позиция начала корзины b процесса r:
+        // все элементы меньших корзин плюс элементы корзины b у процессов с меньшим рангом
+        long long pos = 0;
+        for (int b = 0; b < buckets; ++b) {
+            for (int r = 0; r < size; ++r) {
+                offsets[(long long)r * buckets + b] = pos;
+                pos += all_hist[(long long)r * buckets + b];
+            }
+        }
+
+        // Сколько элементов уходит каждому процессу и сколько приходит от каждого
+        for (int r = 0; r < size; ++r)
+            send_counts[r] = recv_counts[r] = 0;
+        int owner = 0;
+        for (int b = 0; b < buckets; ++b) {
+            long long lo = offsets[(long long)rank * buckets + b];
+            long long hi = lo + hist[b];
+            while (lo < hi) {
+                while (block_start[owner + 1] <= lo)
+                    owner++;
+                long long end = hi < block_start[owner + 1] ? hi : block_start[owner + 1];
+                send_counts[owner] += (int)(end - lo);
+                lo = end;
+            }
+        }
+        for (int s = 0; s < size; ++s) {
+            for (int b = 0; b < buckets; ++b) {
+                long long lo = offsets[(long long)s * buckets + b];
+                long long hi = lo + all_hist[(long long)s * buckets + b];
+                if (lo < my_lo) lo = my_lo;
+                if (hi > my_hi) hi = my_hi;
+                if (hi > lo)
+                    recv_counts[s] += (int)(hi - lo);
+            }
+        }
+        int send_sum = 0, recv_sum = 0;
+        for (int r = 0; r < size; ++r) {
+            send_displs[r] = send_sum;
+            recv_displs[r] = recv_sum;
+            send_sum += send_counts[r];
+            recv_sum += recv_counts[r];
         }
 
-        free(merged);  // освобождаем временный массив
+        MPI_Alltoallv(tmp, send_counts, send_displs, MPI_INT,
+                      recv_buf, recv_counts, recv_displs, MPI_INT, MPI_COMM_WORLD);
+
+        // Элементы от процесса s пришли в порядке корзин: раскладываем по глобальным позициям
+        for (int s = 0; s < size; ++s) {
+            const int* src = recv_buf + recv_displs[s];
+            for (int b = 0; b < buckets; ++b) {
+                long long lo = offsets[(long long)s * buckets + b];
+                long long hi = lo + all_hist[(long long)s * buckets + b];
+                if (lo < my_lo) lo = my_lo;
+                if (hi > my_hi) hi = my_hi;
+                if (hi > lo) {
+                    memcpy(local_arr + (lo - my_lo), src, sizeof(int) * (hi - lo));
+                    src += hi - lo;
+                }
+            }
+        }
     }
 
-    free(buffer);  // освобождаем буфер
+    arena_reset(mem, mark);
 }
 
-int main(int argc, char* argv[]) {
+// Проверка глобальной упорядоченности распределённого массива:
+// каждый блок отсортирован и максимум непустого блока не больше минимума следующего
+int check_sorted(arena* mem, dtype type, const void* arr, long long n, int rank, int size) {
+    const sort_kernels* ops = &sort_table[type];
+    size_t elem = dtype_size(type);
+    int local_ok = ops->is_sorted(arr, n);
+
+    // Первый и последний элементы блока и признак непустого блока
+    size_t mark = arena_mark(mem);
+    char* bounds = (char*)arena_take(mem, elem, 2);
+    char* all_bounds = (char*)arena_take(mem, elem, 2LL * size);
+    int nonempty = n > 0;
+    int* all_nonempty = (int*)arena_take(mem, sizeof(int), size);
+    memset(bounds, 0, 2 * elem);
+    if (n > 0) {
+        memcpy(bounds, arr, elem);
+        memcpy(bounds + elem, (const char*)arr + (n - 1) * elem, elem);
+    }
+    MPI_Allgather(bounds, 2, dtype_mpi(type), all_bounds, 2, dtype_mpi(type), MPI_COMM_WORLD);
+    MPI_Allgather(&nonempty, 1, MPI_INT, all_nonempty, 1, MPI_INT, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        const char* prev_max = NULL;
+        for (int r = 0; r < size; ++r) {
+            if (!all_nonempty[r])
+                continue;
+            if (prev_max && ops->less(all_bounds + 2 * r * elem, prev_max))
+                local_ok = 0;
+            prev_max = all_bounds + (2 * r + 1) * elem;
+        }
+    }
+    arena_reset(mem, mark);
+
+    int global_ok = 0;
+    MPI_Allreduce(&local_ok, &global_ok, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+    return global_ok;
+}
+
+// Одно задание: запуски сортировки с параметрами argv, как в командной строке.
+// Буферы берутся из арены mem, которая переживает задания служебного режима.
+// Возвращает 0 при успехе, 1 при ошибке в параметрах или записи
+static int sort_job(int argc, char* argv[], int rank, int size, arena* mem) {
     if (argc < 2) {
-        printf("Использование: mpirun -np <процессы> %s <кол-во запусков>\n", argv[0]);
+        if (rank == 0)
+            printf("Использование: mpirun -np <процессы> %s <кол-во запусков> [--n=<размер массива>] "
+                   "[--sort=oddeven|sample|radix] [--key-range=<min>:<max>] [--dtype=int|int64|float|double] "
+                   "[--gen=root|local] [--shm] [--seed=<число>] "
+                   "[--input=<файл>] [--output=<файл>] [--io=mpiio|mmap] [--cb-buffer=<байт>] [--cb-nodes=<число>] "
+                   "[--threads=<потоков>] [--bind=none|close|spread] [--arena=<байт>] [--huge] [--warmup=<число>] "
+                   "[--format=text|csv|json] [--out=<файл>] [--trace=<файл>] [--timing=barrier|local|global] [--coll=flat|hier]\n"
+                   "       mpirun -np <процессы> %s --serve=<файл или FIFO> [--trace=<файл>]\n", argv[0], argv[0]);
         return 1;
     }
 
     int runs = atoi(argv[1]);  
     if (runs <= 0) {
-        printf("Количество запусков должно быть больше 0.\n");
+        if (rank == 0)
+            printf("Количество запусков должно быть больше 0.\n");
         return 1;
     }
 
-    MPI_Init(&argc, &argv);  
+    // Алгоритм: четно-нечетная перестановка (по умолчанию), сортировка выборкой или поразрядная
+    const char* sort_mode = arg_str(argc, argv, "--sort", "oddeven");
+    int use_sample = strcmp(sort_mode, "sample") == 0;
+    int use_radix = strcmp(sort_mode, "radix") == 0;
+    if (!use_sample && !use_radix && strcmp(sort_mode, "oddeven") != 0) {
+        if (rank == 0)
+            printf("Ошибка: неизвестный алгоритм сортировки '%s' (oddeven, sample или radix).\n", sort_mode);
+        return 1;
+    }
 
-    int rank, size;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);  // Получаем ранг процесса
-    MPI_Comm_size(MPI_COMM_WORLD, &size);  // Получаем общее число процессов
+    // Тип элементов; поразрядная сортировка — только для int
+    dtype type;
+    if (!dtype_parse(arg_str(argc, argv, "--dtype", "int"), &type) || (use_radix && type != DTYPE_I32)) {
+        if (rank == 0)
+            printf("Ошибка: неизвестное значение --dtype (int, int64, float или double; для radix — только int).\n");
+        return 1;
+    }
+    size_t elem = dtype_size(type);
 
-    if (ARRAY_SIZE % size != 0) {
+    // Диапазон ключей для поразрядной сортировки; без параметра определяется по данным
+    const char* key_range = arg_value(argc, argv, "--key-range");
+    int key_min = 0, key_max = 0;
+    if (key_range && (sscanf(key_range, "%d:%d", &key_min, &key_max) != 2 || key_min > key_max)) {
         if (rank == 0)
-            printf("Ошибка: размер массива (%d) не делится на число процессов (%d).\n", ARRAY_SIZE, size);
-        MPI_Finalize();
+            printf("Ошибка: диапазон ключей задаётся как --key-range=<min>:<max>.\n");
+        return 1;
+    }
+
+    // Генерация данных: целиком на процессе 0 с раздачей (root) или по блокам на месте (local)
+    const char* gen_mode = arg_str(argc, argv, "--gen", "root");
+    int local_gen = strcmp(gen_mode, "local") == 0;
+    if (!local_gen && strcmp(gen_mode, "root") != 0) {
+        if (rank == 0)
+            printf("Ошибка: неизвестный режим генерации '%s' (root или local).\n", gen_mode);
         return 1;
     }
 
-    int local_size = ARRAY_SIZE / size;  // Размер подмассива, обрабатываемого каждым процессом
-    int* local_array = (int*)malloc(sizeof(int) * local_size);  
-    int* full_array = NULL;
+    // Блоки процессов одного узла в общей памяти (окно MPI_Win_allocate_shared)
+    int use_shm = arg_flag(argc, argv, "--shm");
 
-    if (rank == 0) {
-        full_array = (int*)malloc(sizeof(int) * ARRAY_SIZE);  // Главный процесс хранит полный массив
+    // Измерения: --warmup, --format, --out
+    bench bm;
+    if (!bench_init(&bm, "task2_par", runs, argc, argv)) {
+        if (rank == 0)
+            printf("Ошибка: некорректное значение --warmup, --format или --timing.\n");
+        return 1;
+    }
+
+    // Свёртки по процессам (--coll): плоские или двухуровневые через общую память узла
+    int coll_arg = coll_mode_arg(argc, argv);
+    if (coll_arg < 0) {
+        if (rank == 0)
+            printf("Ошибка: неизвестный режим свёрток --coll (flat или hier).\n");
+        return 1;
+    }
+
+    // Данные из файла (--input, элементы типа --dtype) и запись отсортированного массива (--output)
+    const char* input = arg_value(argc, argv, "--input");
+    const char* output = arg_value(argc, argv, "--output");
+    // Размер массива: по файлу или число с необязательным суффиксом K/M/G
+    long long n = input ? io_file_count(input, (int)elem, MPI_COMM_WORLD) : arg_size(argc, argv, "--n", ARRAY_SIZE);
+    if (input && n < 0) {
+        if (rank == 0)
+            printf("Ошибка: файл '%s' не открывается или его размер не кратен размеру элемента.\n", input);
+        return 1;
+    }
+    if (n <= 0 || !decomp_fits(n, size)) {
+        if (rank == 0)
+            printf("Ошибка: некорректный размер массива или блок процесса больше %d элементов.\n", INT_MAX);
+        return 1;
+    }
+
+    // Начальное значение генератора: --seed или текущее время процесса 0
+    unsigned long long seed = (unsigned long long)arg_long(argc, argv, "--seed", (long long)time(NULL));
+    MPI_Bcast(&seed, 1, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+
+    // Потоки процесса: --threads и привязка --bind
+    int threads = threads_setup(argc, argv, rank == 0);
+    if (!threads) {
+        if (rank == 0)
+            printf("Ошибка: некорректное значение --threads или --bind.\n");
+        return 1;
     }
 
-    double total_time = 0.0;  
+    // Подсказки MPI-IO — последней проверкой: до неё задание ничего не выделяет
+    io_config io;
+    if (!io_setup(&io, argc, argv)) {
+        if (rank == 0)
+            printf("Ошибка: некорректное значение --io, --cb-buffer или --cb-nodes.\n");
+        return 1;
+    }
+
+    // Режим замера (--timing): в режиме global — выравнивание часов процессов
+    bench_timing_setup(&bm, MPI_COMM_WORLD);
+    coll cl;
+    coll_setup(&cl, MPI_COMM_WORLD, (coll_mode)coll_arg);
+    bench_param(&bm, "coll", "%s", coll_mode_names[coll_arg]);
 
-    for (int run = 0; run < runs; ++run) {
-        // Главный процесс инициализирует массив случайными числами
-        if (rank == 0) {
-            srand(time(NULL) + run);  
-            fill_random(full_array, ARRAY_SIZE);
+    int local_size = (int)block_count(n, size, rank);  // Размер подмассива, обрабатываемого каждым процессом
+    long long local_first = block_start(n, size, rank);
+    // Арена процесса: свой блок, полный массив на главном процессе и буферы сортировки —
+    // блок соседа и результат слияния, два блока поразрядной сортировки или, для сортировки
+    // выборкой, полученные отрезки и их слияние (в худшем случае весь массив), и рабочие буферы
+    // ядер сортировки. Резерв виртуальный: реально занимается только пик
+    int root_full = rank == 0 && !local_gen && !input;
+    long long max_block = block_count(n, size, 0);
+    long long buckets = 1LL << RADIX_MAX_BITS;
+    size_t needed = elem * (size_t)(2 * max_block) + elem * (size_t)(use_sample ? 2 * n : max_block)
+                    + sizeof(long long) * (size_t)(buckets * (2LL * size + 1)) + elem * 4 * (size_t)size * size
+                    + RADIX_SCATTER_SCRATCH + sort_kway_scratch(size > threads ? size : threads) + ARENA_SLACK;
+    if (root_full)
+        needed += elem * (size_t)n;
+    if (!arena_ensure(mem, argc, argv, needed)) {
+        if (rank == 0)
+            printf("Ошибка: некорректное значение --arena или не удалось зарезервировать память.\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // С --shm свой блок и запасной блок чётно-нечётной перестановки лежат в общих окнах узла
+    shm_node node;
+    shm_window wins[2];
+    int zero_copy = 0;
+    void* local_array;
+    if (use_shm) {
+        shm_setup(&node, MPI_COMM_WORLD);
+        int spare = !use_sample && !use_radix ? local_size : 0;
+        if (!shm_window_alloc(&wins[0], &node, elem * (size_t)local_size)
+            || !shm_window_alloc(&wins[1], &node, elem * (size_t)spare)) {
+            if (rank == 0)
+                printf("Ошибка: не удалось выделить окно общей памяти.\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
         }
+        local_array = wins[0].base;
+    } else
+        local_array = arena_take(mem, elem, local_size);
+    void* full_array = root_full ? arena_take(mem, elem, n) : NULL;  // Главный процесс хранит полный массив
+
+    // Буферы сортировки берутся после этой отметки; откат к ней в начале каждого запуска
+    // отдаёт их следующему запуску, а результат последнего запуска остаётся до проверки
+    size_t run_mark = arena_mark(mem);
 
-        // Распределение массива между процессами
-        MPI_Scatter(full_array, local_size, MPI_INT,
-                    local_array, local_size, MPI_INT,
-                    0, MPI_COMM_WORLD);
+    // Результат сортировки выборкой: блок переменной длины
+    void* sorted = NULL;
+    long long sorted_size = local_size;
 
-        MPI_Barrier(MPI_COMM_WORLD);  // Синхронизация перед замером времени
+    bm.threads = threads;
+    bm.size = n;
+    bench_param(&bm, "sort", "%s", sort_mode);
+    bench_param(&bm, "dtype", "%s", dtype_names[type]);
+    bench_param(&bm, "gen", "%s", input ? "file" : gen_mode);
+    bench_param(&bm, "shm", "%d", use_shm);
+    int series = bench_series_add(&bm, "sort", "Сортировка");
+    int read_series = input ? bench_series_add(&bm, "read", "Чтение файла") : -1;
+
+    for (int it = 0; it < bench_iterations(&bm); ++it) {
+        int run = bench_is_warmup(&bm, it) ? 0 : it - bm.warmup;  // прогрев идёт на данных первого запуска
+        arena_reset(mem, run_mark);
+        trace_iteration(it);
+
+        // Каждый процесс читает свой блок из файла, либо главный процесс инициализирует
+        // массив случайными числами и раздаёт его, либо каждый процесс генерирует свой блок на месте
+        if (input) {
+            bench_sync(&bm, MPI_COMM_WORLD);
+            double read_start = MPI_Wtime();
+            if (!io_read_block(&io, input, local_array, dtype_mpi(type), local_first, local_size, MPI_COMM_WORLD)) {
+                if (rank == 0)
+                    printf("Ошибка: не удалось прочитать файл '%s'.\n", input);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            bench_sync(&bm, MPI_COMM_WORLD);
+            bench_record_span(&bm, read_series, it, read_start, MPI_Wtime());
+        } else if (local_gen) {
+            trace_region tr = trace_begin("gen");
+            fill_random(local_array, type, local_size, local_first, seed + run);
+            trace_end(&tr);
+        } else {
+            if (rank == 0) {
+                trace_region tr = trace_begin("gen");
+                fill_random(full_array, type, n, 0, seed + run);
+                trace_end(&tr);
+            }
+
+            // Распределение массива между процессами; с общей памятью — только между узлами
+            zero_copy = use_shm && shm_scatter_blocks(&node, full_array, n, dtype_mpi(type), &wins[0]);
+            if (!zero_copy)
+                scatterv_blocks(full_array, n, dtype_mpi(type), local_array, 0, MPI_COMM_WORLD);
+        }
+
+        bench_sync(&bm, MPI_COMM_WORLD);  // Синхронизация перед замером времени
         double start = MPI_Wtime();   
 
         // Параллельная сортировка
-        parallel_bubble_sort(local_array, local_size, rank, size);
+        if (use_sample) {
+            sorted_size = parallel_sample_sort(mem, type, local_array, local_size, &sorted, size);
+        } else if (use_radix) {
+            int lo = key_min, hi = key_max;
+            if (!key_range) {
+                int local_lo, local_hi;
+                sort_key_range(local_array, local_size, &local_lo, &local_hi);
+                MPI_Allreduce(&local_lo, &lo, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+                MPI_Allreduce(&local_hi, &hi, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+            }
+            parallel_radix_sort(mem, local_array, local_size, lo, hi, rank, size);
+        } else
+            parallel_bubble_sort(mem, type, local_array, local_size, n, rank, size,
+                                 use_shm ? &node : NULL, use_shm ? wins : NULL);
 
-        MPI_Barrier(MPI_COMM_WORLD);  // Синхронизация после сортировки
+        bench_sync(&bm, MPI_COMM_WORLD);  // Синхронизация после сортировки
         double end = MPI_Wtime();     
 
-        if (rank == 0) {
-            total_time += (end - start);  
-        }
+        bench_record_span(&bm, series, it, start, end);
+    }
+    bench_reduce_max(&bm, 0, &cl);
+
+    // Проверка результата последнего запуска
+    int ok = check_sorted(mem, type, use_sample ? sorted : local_array, sorted_size, rank, size);
+
+    // Запись отсортированного массива: блоки сортировки выборкой имеют разную длину,
+    // поэтому смещение блока — префиксная сумма длин блоков младших процессов
+    int written = 1;
+    double write_time = 0.0;
+    if (output) {
+        long long out_first = 0;
+        MPI_Exscan(&sorted_size, &out_first, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+        if (rank == 0)
+            out_first = 0;
+        MPI_Barrier(MPI_COMM_WORLD);
+        double write_start = MPI_Wtime();
+        written = io_write_block(&io, output, use_sample ? sorted : local_array, dtype_mpi(type),
+                                 out_first, sorted_size, n, MPI_COMM_WORLD);
+        write_time = MPI_Wtime() - write_start;
     }
 
     if (rank == 0) {
-        printf("Среднее время за %d запусков: %f секунд(ы)\n", runs, total_time / runs);
-        free(full_array);  // Очистка памяти
+        printf("Размер массива: %lld (%s), процессов: %d, потоков: %d\n", n, dtype_names[type], size, threads);
+        printf("Алгоритм: %s\n", use_sample ? "сортировка выборкой"
+                                : use_radix ? "поразрядная сортировка" : "четно-нечетная перестановка");
+        if (use_shm)
+            printf("Общая память: узлов %d, раздача %s\n", node.nodes,
+                   zero_copy ? "только между узлами" : local_gen || input ? "не нужна" : "обычная");
+        bench_report(&bm);
+        printf("Массив отсортирован: %s\n", ok ? "да" : "нет");
+        if (output && written)
+            printf("Результат записан в '%s' за %.6f с (%.2f ГБ/с)\n", output, write_time,
+                   (double)elem * n / write_time / 1e9);
+        else if (output)
+            printf("Ошибка: не удалось записать файл '%s'.\n", output);
+        bench_write(&bm);
+    }
+    arena_report(mem, 0, MPI_COMM_WORLD);
+
+    if (use_shm) {
+        shm_window_free(&wins[0]);
+        shm_window_free(&wins[1]);
+        shm_free(&node);
+    }
+    bench_free(&bm);  // Очистка памяти (арена остаётся следующим заданиям)
+    coll_free(&cl);
+    io_free(&io);
+    return written ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    threads_mpi_init(&argc, &argv);
+
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);  // Получаем ранг процесса
+    MPI_Comm_size(MPI_COMM_WORLD, &size);  // Получаем общее число процессов
+
+    // Трассировка (--trace=<файл>): до первой параллельной области, чтобы счётчики унаследовали потоки
+    if (!trace_setup(argc, argv, MPI_COMM_WORLD)) {
+        if (rank == 0)
+            printf("Ошибка: не удалось выделить буфер трассы.\n");
+        MPI_Finalize();
+        return 1;
+    }
+
+    // Служебный режим (--serve): задания из файла или FIFO одно за другим с общей ареной (common/serve.h)
+    arena mem = { NULL, 0, 0, 0, 0, 0 };
+    const char* serve_path = arg_value(argc, argv, "--serve");
+    int status = 0;
+    if (serve_path) {
+        serve sv;
+        if (!serve_open(&sv, serve_path, argv[0], "task2", MPI_COMM_WORLD)) {
+            if (rank == 0)
+                printf("Ошибка: не удалось открыть поток заданий '%s'.\n", serve_path);
+            MPI_Finalize();
+            return 1;
+        }
+        while (serve_next(&sv, MPI_COMM_WORLD)) {
+            double start = MPI_Wtime();
+            int code = sv.argc > 0 ? sort_job(sv.argc, sv.argv, rank, size, &mem) : 1;
+            serve_done(&sv, code, start, MPI_COMM_WORLD);
+        }
+        serve_close(&sv, MPI_COMM_WORLD);
+    } else {
+        status = sort_job(argc, argv, rank, size, &mem);
     }
 
-    free(local_array);  
+    trace_finish(0, MPI_COMM_WORLD);
+    arena_free(&mem);
     MPI_Finalize();     // Завершение работы MPI
-    return 0;
+    return status;
 }
@@ -1,33 +1,45 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
-#define ARRAY_SIZE 200000
+#include "../common/args.h"
+#include "../common/bench.h"
+#include "../common/dtype.h"
+#include "../common/rng.h"
+#include "../common/sort.h"
 
-void fill_random(int *array, int size) {
-    for (int i = 0; i < size; i++) {
-        array[i] = rand() % 1000;
-    }
+#define ARRAY_SIZE 200000  // размер по умолчанию, задаётся параметром --n
+
+// Заполнение числами от 0 до 999 (тот же генератор, что и в task2_par)
+void fill_random(void *array, dtype type, long long size, unsigned long long seed) {
+    dtype_fill(array, type, size, 0, seed, 0, 0, 1000);
 }
 
-// СОортировка пузырьком
-void bubble_sort(int *array, int size) {
-    for (int i = 0; i < size - 1; i++) {
-        for (int j = 0; j < size - i - 1; j++) {
-            if (array[j] > array[j + 1]) {
-                int tmp = array[j];
-                array[j] = array[j + 1];
-                array[j + 1] = tmp;
-            }
-        }
-    }
+// СОортировка пузырьком: одно тело для всех типов элементов
+#define BUBBLE_SORT_DEFINE(sfx, T)                                  \
+static void bubble_sort_##sfx(void *data, long long size) {         \
+    T *array = (T *)data;                                           \
+    for (long long i = 0; i < size - 1; i++) {                      \
+        for (long long j = 0; j < size - i - 1; j++) {              \
+            if (array[j] > array[j + 1]) {                          \
+                T tmp = array[j];                                   \
+                array[j] = array[j + 1];                            \
+                array[j + 1] = tmp;                                 \
+            }                                                       \
+        }                                                           \
+    }                                                               \
 }
+DTYPE_FOREACH(BUBBLE_SORT_DEFINE)
+
+#define BUBBLE_SORT_ENTRY(sfx, T) bubble_sort_##sfx,
+static void (*const bubble_sort[DTYPE_COUNT])(void *, long long) = { DTYPE_FOREACH(BUBBLE_SORT_ENTRY) };
 
 int main(int argc, char* argv[]) {
   
     // Если параметр не передали
     if (argc < 2) {
-        printf("Используйте: %s <количество запусков>\n", argv[0]);
+        printf("Используйте: %s <количество запусков> [--n=<размер массива>] [--sort=bubble|radix] [--key-range=<min>:<max>] [--dtype=int|int64|float|double] [--seed=<число>] [--warmup=<число>] [--format=text|csv|json] [--out=<файл>]\n", argv[0]);
         return 1;
     }
 
@@ -38,28 +50,85 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    int *array = malloc(sizeof(int) * ARRAY_SIZE);
-    if (!array) {
+    // Алгоритм: пузырьковая сортировка (по умолчанию) или поразрядная
+    const char* sort_mode = arg_str(argc, argv, "--sort", "bubble");
+    int use_radix = strcmp(sort_mode, "radix") == 0;
+    if (!use_radix && strcmp(sort_mode, "bubble") != 0) {
+        printf("Неизвестный алгоритм сортировки '%s' (bubble или radix).\n", sort_mode);
+        return 1;
+    }
+
+    // Тип элементов; поразрядная сортировка — только для int
+    dtype type;
+    if (!dtype_parse(arg_str(argc, argv, "--dtype", "int"), &type) || (use_radix && type != DTYPE_I32)) {
+        printf("Неизвестное значение --dtype (int, int64, float или double; для radix — только int).\n");
+        return 1;
+    }
+
+    // Диапазон ключей для поразрядной сортировки; без параметра определяется по данным
+    const char* key_range = arg_value(argc, argv, "--key-range");
+    int key_min = 0, key_max = 0;
+    if (key_range && (sscanf(key_range, "%d:%d", &key_min, &key_max) != 2 || key_min > key_max)) {
+        printf("Диапазон ключей задаётся как --key-range=<min>:<max>.\n");
+        return 1;
+    }
+
+    long long n = arg_size(argc, argv, "--n", ARRAY_SIZE);
+    if (n <= 0) {
+        printf("Некорректный размер массива.\n");
+        return 1;
+    }
+
+    unsigned long long seed = (unsigned long long)arg_long(argc, argv, "--seed", (long long)time(NULL));
+
+    // Измерения: --warmup, --format, --out
+    bench bm;
+    if (!bench_init(&bm, "task2_seq", runs, argc, argv)) {
+        printf("Некорректное значение --warmup или --format.\n");
+        return 1;
+    }
+    bm.size = n;
+    bench_param(&bm, "sort", "%s", sort_mode);
+    bench_param(&bm, "dtype", "%s", dtype_names[type]);
+    int series = bench_series_add(&bm, "sort", "Сортировка");
+
+    void *array = malloc(dtype_size(type) * n);
+    int *tmp = use_radix ? malloc(sizeof(int) * n) : NULL;
+    void *scratch = use_radix ? aligned_alloc(64, RADIX_SCRATCH) : NULL;  // рабочий буфер поразрядной сортировки
+    if (!array || (use_radix && (!tmp || !scratch))) {
         printf("Ошибка выделения памяти.\n");
         return 1;
     }
+    if (scratch)
+        memset(scratch, 0, RADIX_SCRATCH);  // страницы рабочего буфера подкачиваются до замеров
 
-    double total_time = 0.0;
+    for (int it = 0; it < bench_iterations(&bm); it++) {
+        int run = bench_is_warmup(&bm, it) ? 0 : it - bm.warmup;  // прогрев идёт на данных первого запуска
 
-    for (int run = 0; run < runs; run++) {
-        srand(time(NULL) + run);
         // Каждый раз перезаполняется
-        fill_random(array, ARRAY_SIZE);
+        fill_random(array, type, n, seed + run);
 
-        clock_t start = clock();
-        bubble_sort(array, ARRAY_SIZE);
-        clock_t end = clock();
+        double start = bench_now();
+        if (use_radix) {
+            int lo = key_min, hi = key_max;
+            if (!key_range)
+                sort_key_range(array, n, &lo, &hi);
+            sort_radix(array, n, tmp, lo, hi, scratch);
+        } else {
+            bubble_sort[type](array, n);
+        }
+        double end = bench_now();
 
-        total_time += (double)(end - start) / CLOCKS_PER_SEC;
+        bench_record(&bm, series, it, end - start);
     }
 
-    printf("Среднее время сортировки за %d запусков: %f секунд(ы)\n", runs, total_time / runs);
+    printf("Размер массива: %lld (%s)\n", n, dtype_names[type]);
+    bench_report(&bm);
+    bench_write(&bm);
 
     free(array);
+    free(tmp);
+    free(scratch);
+    bench_free(&bm);
     return 0;
 }
@@ -1,142 +1,706 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <mpi.h>
+#include <string.h>
 #include <time.h>
 
-#define ARRAY_SIZE 1000000
+#include "../common/arena.h"
+#include "../common/args.h"
+#include "../common/bench.h"
+#include "../common/coll.h"
+#include "../common/decomp.h"
+#include "../common/dtype.h"
+#include "../common/gather.h"
+#include "../common/pipeline.h"
+#include "../common/rng.h"
+#include "../common/serve.h"
+#include "../common/simd.h"
+#include "../common/stream.h"
+#include "../common/trace.h"
 
-// Заполнение массива случайными значениями от 1 до 100
-void fill_random(int *array, int size) {
-    for (int i = 0; i < size; i++) {
-        array[i] = rand() % 100 + 1;
+#define ARRAY_SIZE 1000000  // размер по умолчанию, задаётся параметром --n
+
+// Заполнение элементов first..first+size-1 массива типа type случайными значениями от 1 до 100
+// (вещественные — из [1, 101)); stream различает массивы a и b. Каждый поток заполняет свой отрезок
+void fill_random(void *array, dtype type, long long size, long long first, unsigned long long seed,
+                 unsigned int stream) {
+    size_t elem = dtype_size(type);
+#pragma omp parallel
+    {
+        long long from, count;
+        threads_range(size, &from, &count);
+        dtype_fill((char *)array + from * elem, type, count, first + from, seed, stream, 1, 100);
     }
 }
 
-// Операции над частями массивов
-void compute_add(int *a, int *b, int *sum, int size) {
-    for (int i = 0; i < size; i++) sum[i] = a[i] + b[i];
-}
+// Конвейер: порции a и b раздаются одновременно, порция k считается, пока k+1 в пути,
+// результаты порции k сразу отправляются обратно неблокирующим сбором.
+// greqs — не меньше 4 * plan->chunks запросов сбора
+static void pipelined_pass(const pipe_plan* plan, const simd_kernels* kernels, int fused, int use_nt,
+                           const ew_arrays* g, const ew_arrays* l, MPI_Request* greqs) {
+    MPI_Datatype type = dtype_mpi(l->type);
+    MPI_Request sreqs[2][2];
 
-void compute_sub(int *a, int *b, int *diff, int size) {
-    for (int i = 0; i < size; i++) diff[i] = a[i] - b[i];
-}
+    pipe_iscatter(plan, 0, g->a, type, l->a, &sreqs[0][0]);
+    pipe_iscatter(plan, 0, g->b, type, l->b, &sreqs[0][1]);
+    for (int k = 0; k < plan->chunks; k++) {
+        MPI_Waitall(2, sreqs[k % 2], MPI_STATUSES_IGNORE);
+        if (k + 1 < plan->chunks) {
+            pipe_iscatter(plan, k + 1, g->a, type, l->a, &sreqs[(k + 1) % 2][0]);
+            pipe_iscatter(plan, k + 1, g->b, type, l->b, &sreqs[(k + 1) % 2][1]);
+            pipe_progress(2, sreqs[(k + 1) % 2]);
+        }
+
+        simd_run_all(kernels, fused, use_nt, l, pipe_chunk_from(plan, k), pipe_chunk_count(plan, k));
 
-void compute_mul(int *a, int *b, int *prod, int size) {
-    for (int i = 0; i < size; i++) prod[i] = a[i] * b[i];
+        MPI_Request* r = greqs + 4 * k;
+        pipe_igather(plan, k, l->sum, type, g->sum, &r[0]);
+        pipe_igather(plan, k, l->diff, type, g->diff, &r[1]);
+        pipe_igather(plan, k, l->prod, type, g->prod, &r[2]);
+        pipe_igather(plan, k, l->quot, MPI_DOUBLE, g->quot, &r[3]);
+        pipe_progress(4 * (k + 1), greqs);
+    }
+    MPI_Waitall(4 * plan->chunks, greqs, MPI_STATUSES_IGNORE);
 }
 
-void compute_div(int *a, int *b, double *quot, int size) {
-    for (int i = 0; i < size; i++) {
-        quot[i] = b[i] != 0 ? (double)a[i] / b[i] : 0.0;
+// Потоковый проход (--stream): окна плана plan проходятся по порядку или, с очередью queue
+// (--dynamic), берутся из неё, пока не кончатся. Операнды окна читаются из файлов in[2]
+// (следующее окно — пока считается текущее) или генерируются по глобальным индексам,
+// результаты окна дописываются в файлы out[4] неблокирующе, пока считаются следующие окна
+// (in и out могут быть NULL). w — два комплекта окон операндов и результатов. При check
+// копятся расхождения с эталонным ядром и контрольная сумма для --verify
+static void streamed_pass(const stream_plan* plan, stream_queue* queue, const simd_kernels* kernels, int fused,
+                          int use_nt, stream_file* in, stream_file* out, const ew_arrays w[2],
+                          unsigned long long seed, int check, long long* bad, uint64_t* checksum) {
+    dtype type = w[0].type;
+    MPI_Request rreqs[2][2], wreqs[2][4];
+    long long held[2] = { -1, -1 };  // окно, результаты которого пишутся из комплекта (-1 — нет записи)
+
+    long long k = stream_next(plan, queue, 0), next = -1;
+    if (in && k >= 0) {
+        stream_iread(&in[0], plan, k, w[0].a, &rreqs[0][0]);
+        stream_iread(&in[1], plan, k, w[0].b, &rreqs[0][1]);
+    }
+    for (long long j = 0; k >= 0; j++, k = next) {
+        int slot = (int)(j % 2);
+        const ew_arrays* cur = &w[slot];
+        long long count = stream_window_count(plan, k);
+        int ok = 1;
+        if (in) {
+            ok = stream_wait(&in[0], &rreqs[slot][0], count) && stream_wait(&in[1], &rreqs[slot][1], count);
+            next = stream_next(plan, queue, j + 1);
+            if (ok && next >= 0) {
+                stream_iread(&in[0], plan, next, w[!slot].a, &rreqs[!slot][0]);
+                stream_iread(&in[1], plan, next, w[!slot].b, &rreqs[!slot][1]);
+            }
+        } else {
+            trace_region tr = trace_begin("gen");
+            fill_random(cur->a, type, count, stream_window_first(plan, k), seed, 0);
+            fill_random(cur->b, type, count, stream_window_first(plan, k), seed, 1);
+            trace_end(&tr);
+        }
+
+        // Результаты позапрошлого окна лежат в том же комплекте и должны быть дописаны до нового счёта
+        for (int i = 0; out && held[slot] >= 0 && i < 4; i++)
+            ok = stream_wait(&out[i], &wreqs[slot][i], stream_window_count(plan, held[slot])) && ok;
+        if (!ok) {
+            printf("Ошибка: потоковое чтение или запись окна не удались.\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+
+        simd_run_all(kernels, fused, use_nt, cur, 0, count);
+        if (check) {
+            *bad += ew_mismatches(cur, count);
+            *checksum += ew_checksum(cur, count, stream_window_first(plan, k));
+        }
+        if (out) {
+            const void* results[4] = { cur->sum, cur->diff, cur->prod, cur->quot };
+            for (int i = 0; i < 4; i++)
+                stream_iwrite(&out[i], plan, k, results[i], &wreqs[slot][i]);
+            held[slot] = k;
+        }
+        if (!in)
+            next = stream_next(plan, queue, j + 1);  // без чтения наперёд окно берётся, когда процесс свободен
+    }
+
+    // Запись двух последних окон
+    int ok = 1;
+    for (int slot = 0; out && slot < 2; slot++)
+        for (int i = 0; held[slot] >= 0 && i < 4; i++)
+            ok = stream_wait(&out[i], &wreqs[slot][i], stream_window_count(plan, held[slot])) && ok;
+    if (!ok) {
+        printf("Ошибка: потоковая запись результатов не удалась.\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
     }
 }
 
-int main(int argc, char *argv[]) {
+// Одно задание: запуски поэлементных операций с параметрами argv, как в командной строке.
+// Массивы берутся из арены mem, которая переживает задания служебного режима.
+// Возвращает 0 при успехе, 1 при ошибке в параметрах, 2 при неудачной проверке или записи
+static int vector_job(int argc, char *argv[], int rank, int size, arena *mem) {
     if (argc < 2) {
-        printf("Использование: mpirun -np <процессы> %s <кол-во запусков>\n", argv[0]);
+        if (rank == 0)
+            printf("Использование: mpirun -np <процессы> %s <кол-во запусков> [--n=<размер массива>] "
+                   "[--gen=root|local] [--input=<файл a>,<файл b>] [--output=<префикс>] [--io=mpiio|mmap] "
+                   "[--cb-buffer=<байт>] [--cb-nodes=<число>] [--pipeline=<порций>] [--stream=<элементов окна>] [--dynamic] [--gather=none|root] [--verify] [--seed=<число>] [--dtype=int|int64|float|double] [--kernel=separate|fused|both] [--nt] "
+                   "[--simd=auto|scalar|avx2|avx512] [--threads=<потоков>] [--bind=none|close|spread]\n"
+                   "       [--arena=<байт>] [--huge] [--warmup=<число>] [--format=text|csv|json] [--out=<файл>] [--trace=<файл>] [--timing=barrier|local|global] [--coll=flat|hier]\n"
+                   "       mpirun -np <процессы> %s --serve=<файл или FIFO> [--trace=<файл>]\n", argv[0], argv[0]);
         return 1;
     }
 
     int runs = atoi(argv[1]);
     if (runs <= 0) {
-        printf("Ошибка: количество запусков должно быть положительным числом.\n");
+        if (rank == 0)
+            printf("Ошибка: количество запусков должно быть положительным числом.\n");
         return 1;
     }
 
-    MPI_Init(&argc, &argv);
-    int rank, size;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    // Генерация данных: целиком на процессе 0 с раздачей (root) или по блокам на месте (local)
+    const char* gen_mode = arg_str(argc, argv, "--gen", "root");
+    int local_gen = strcmp(gen_mode, "local") == 0;
+    if (!local_gen && strcmp(gen_mode, "root") != 0) {
+        if (rank == 0)
+            printf("Ошибка: неизвестный режим генерации '%s' (root или local).\n", gen_mode);
+        return 1;
+    }
 
-    // Проверка делимости массива на количество процессов
-    if (ARRAY_SIZE % size != 0) {
+    // Тип элементов операндов и результатов (кроме частного, оно всегда double)
+    dtype type;
+    if (!dtype_parse(arg_str(argc, argv, "--dtype", "int"), &type)) {
+        if (rank == 0)
+            printf("Ошибка: неизвестное значение --dtype (int, int64, float или double).\n");
+        return 1;
+    }
+    size_t elem = dtype_size(type);
+
+    // Операнды из файлов (--input=<a>,<b>, элементы типа --dtype) и запись результатов (--output=<префикс>)
+    const char* input = arg_value(argc, argv, "--input");
+    const char* output = arg_value(argc, argv, "--output");
+    char input_a[4096], input_b[4096];
+    if (input && !io_split_pair(input, input_a, input_b, sizeof(input_a))) {
+        if (rank == 0)
+            printf("Ошибка: входные файлы задаются как --input=<файл a>,<файл b>.\n");
+        return 1;
+    }
+
+    // Конвейерная раздача и сбор порциями (только при генерации на процессе 0)
+    int chunks = (int)arg_long(argc, argv, "--pipeline", 0);
+    if (chunks < 0 || (chunks > 0 && (local_gen || input))) {
+        if (rank == 0)
+            printf("Ошибка: --pipeline требует положительного числа порций и --gen=root.\n");
+        return 1;
+    }
+
+    // Сбор результатов на процессе 0 (конвейер собирает их всегда) и проверка по эталонному ядру
+    const char* gather_mode = arg_str(argc, argv, "--gather", "none");
+    int gather = chunks > 0 || strcmp(gather_mode, "root") == 0;
+    int verify = arg_flag(argc, argv, "--verify");
+    if (strcmp(gather_mode, "root") != 0 && strcmp(gather_mode, "none") != 0) {
+        if (rank == 0)
+            printf("Ошибка: неизвестный режим сбора '%s' (none или root).\n", gather_mode);
+        return 1;
+    }
+
+    // Потоковый режим (--stream=<элементов окна>): блок процесса проходится окнами, окна
+    // генерируются на месте (как при --gen=local) или читаются из --input, результаты
+    // дописываются в --output по мере счёта; полных массивов нет ни у кого
+    long long window = stream_window_arg(argc, argv);
+    if (window < 0 || (window > 0 && gather)) {
+        if (rank == 0)
+            printf("Ошибка: --stream требует окна не больше %d элементов и несовместим с --pipeline и --gather=root.\n",
+                   INT_MAX);
+        return 1;
+    }
+    if (window > 0)
+        local_gen = 1;
+
+    // Динамическое распределение (--dynamic): окна всего массива берутся процессами из общей очереди
+    int dynamic = arg_flag(argc, argv, "--dynamic");
+    if (dynamic && window == 0) {
+        if (rank == 0)
+            printf("Ошибка: --dynamic работает только с --stream=<элементов окна>.\n");
+        return 1;
+    }
+
+    // Ядра: четыре раздельных прохода (по умолчанию), один совмещённый проход или оба для сравнения;
+    // --nt включает потоковые записи в совмещённом ядре
+    const char* kernel_mode = arg_str(argc, argv, "--kernel", "separate");
+    int run_separate = strcmp(kernel_mode, "separate") == 0 || strcmp(kernel_mode, "both") == 0;
+    int run_fused = strcmp(kernel_mode, "fused") == 0 || strcmp(kernel_mode, "both") == 0;
+    int use_nt = arg_flag(argc, argv, "--nt");
+    if (!run_separate && !run_fused) {
+        if (rank == 0)
+            printf("Ошибка: неизвестный режим ядер '%s' (separate, fused или both).\n", kernel_mode);
+        return 1;
+    }
+
+    // Измерения: --warmup, --format, --out
+    bench bm;
+    if (!bench_init(&bm, "task3_par", runs, argc, argv)) {
+        if (rank == 0)
+            printf("Ошибка: некорректное значение --warmup, --format или --timing.\n");
+        return 1;
+    }
+
+    // Свёртки по процессам (--coll): плоские или двухуровневые через общую память узла
+    int coll_arg = coll_mode_arg(argc, argv);
+    if (coll_arg < 0) {
+        if (rank == 0)
+            printf("Ошибка: неизвестный режим свёрток --coll (flat или hier).\n");
+        return 1;
+    }
+
+    // Размер массивов: по входным файлам (они должны быть одной длины) или число с необязательным
+    // суффиксом K/M/G; остаток от деления на число процессов распределяется по первым процессам
+    long long n = arg_size(argc, argv, "--n", ARRAY_SIZE);
+    if (input) {
+        n = io_file_count(input_a, (int)elem, MPI_COMM_WORLD);
+        if (n < 0 || io_file_count(input_b, (int)elem, MPI_COMM_WORLD) != n) {
+            if (rank == 0) {
+                printf("Ошибка: входные файлы не открываются или имеют разную длину.\n");
+            }
+            return 1;
+        }
+    }
+    if (n <= 0 || (window == 0 && !decomp_fits(n, size))) {
         if (rank == 0) {
-            printf("Ошибка: размер массива должен делиться на количество процессов.\n");
+            printf("Ошибка: некорректный размер массива или блок процесса больше %d элементов.\n", INT_MAX);
         }
-        MPI_Finalize();
         return 1;
     }
 
-    int local_size = ARRAY_SIZE / size;
+    if (chunks > 0 && n > INT_MAX) {
+        if (rank == 0) {
+            printf("Ошибка: для --pipeline массив должен быть не больше %d элементов.\n", INT_MAX);
+        }
+        return 1;
+    }
 
-    // Локальные массивы для каждого процесса
-    int *local_a = malloc(local_size * sizeof(int));
-    int *local_b = malloc(local_size * sizeof(int));
-    int *local_sum = malloc(local_size * sizeof(int));
-    int *local_diff = malloc(local_size * sizeof(int));
-    int *local_prod = malloc(local_size * sizeof(int));
-    double *local_quot = malloc(local_size * sizeof(double));
+    // Начальное значение генератора: --seed или текущее время процесса 0
+    unsigned long long seed = (unsigned long long)arg_long(argc, argv, "--seed", (long long)time(NULL));
+    MPI_Bcast(&seed, 1, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
 
-    // Глобальные массивы только у процесса 0
-    int *a = NULL, *b = NULL;
-    if (rank == 0) {
-        a = malloc(ARRAY_SIZE * sizeof(int));
-        b = malloc(ARRAY_SIZE * sizeof(int));
+    // Вариант векторных ядер: auto (по CPUID), scalar, avx2 или avx512
+    const simd_kernels* kernels = simd_setup(arg_str(argc, argv, "--simd", "auto"), rank == 0);
+    if (!kernels) {
+        if (rank == 0) {
+            printf("Ошибка: вариант --simd неизвестен или не поддерживается процессором.\n");
+        }
+        return 1;
     }
 
-    // Накопители времени
-    double total_time_add = 0.0;
-    double total_time_sub = 0.0;
-    double total_time_mul = 0.0;
-    double total_time_div = 0.0;
+    // Потоки процесса: --threads и привязка --bind
+    int threads = threads_setup(argc, argv, rank == 0);
+    if (!threads) {
+        if (rank == 0) {
+            printf("Ошибка: некорректное значение --threads или --bind.\n");
+        }
+        return 1;
+    }
 
-    for (int run = 0; run < runs; run++) {
+    // Подсказки MPI-IO — последней проверкой: до неё задание ничего не выделяет
+    io_config io;
+    if (!io_setup(&io, argc, argv)) {
         if (rank == 0) {
-            srand(time(NULL) + run);
-            fill_random(a, ARRAY_SIZE);
-            fill_random(b, ARRAY_SIZE);
+            printf("Ошибка: некорректное значение --io, --cb-buffer или --cb-nodes.\n");
         }
+        return 1;
+    }
 
-        // Распределение данных между процессами
-        MPI_Scatter(a, local_size, MPI_INT, local_a, local_size, MPI_INT, 0, MPI_COMM_WORLD);
-        MPI_Scatter(b, local_size, MPI_INT, local_b, local_size, MPI_INT, 0, MPI_COMM_WORLD);
+    // Режим замера (--timing): в режиме global — выравнивание часов процессов
+    bench_timing_setup(&bm, MPI_COMM_WORLD);
+    coll cl;
+    coll_setup(&cl, MPI_COMM_WORLD, (coll_mode)coll_arg);
+    bench_param(&bm, "coll", "%s", coll_mode_names[coll_arg]);
+    // План конвейера: размеры и смещения порций всех процессов
+    pipe_plan plan;
+    if (chunks > 0)
+        pipe_plan_init(&plan, n, chunks, 0, MPI_COMM_WORLD);
 
-        // Синхронизация перед замером времени
-        MPI_Barrier(MPI_COMM_WORLD);
-        double start = MPI_Wtime();
-        compute_add(local_a, local_b, local_sum, local_size);
-        MPI_Barrier(MPI_COMM_WORLD);
-        double end = MPI_Wtime();
-        total_time_add += end - start;
+    long long local_size = block_count(n, size, rank);
+    long long local_first = block_start(n, size, rank);
 
-        MPI_Barrier(MPI_COMM_WORLD);
-        start = MPI_Wtime();
-        compute_sub(local_a, local_b, local_diff, local_size);
-        MPI_Barrier(MPI_COMM_WORLD);
-        end = MPI_Wtime();
-        total_time_sub += end - start;
+    // Арена процесса: шесть локальных массивов (в потоковом режиме — два комплекта окон), на процессе 0 —
+    // операнды (при генерации на нём) и массивы результатов (при сборе), запросы сбора конвейера
+    int root_operands = rank == 0 && !local_gen && !input;
+    int root_results = gather && rank == 0;
+    long long held = window > 0 ? 2 * window : local_size;
+    size_t needed = (size_t)held * (5 * elem + sizeof(double))
+                    + sizeof(MPI_Request) * 4 * (chunks > 0 ? chunks : 0) + ARENA_SLACK;
+    if (root_operands)
+        needed += (size_t)n * 2 * elem;
+    if (root_results)
+        needed += (size_t)n * (3 * elem + sizeof(double));
+    if (!arena_ensure(mem, argc, argv, needed)) {
+        if (rank == 0) {
+            printf("Ошибка: некорректное значение --arena или не удалось зарезервировать память.\n");
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
 
-        MPI_Barrier(MPI_COMM_WORLD);
-        start = MPI_Wtime();
-        compute_mul(local_a, local_b, local_prod, local_size);
-        MPI_Barrier(MPI_COMM_WORLD);
-        end = MPI_Wtime();
-        total_time_mul += end - start;
+    // Локальные массивы для каждого процесса; страницы арены уже получили первое касание
+    ew_arrays local = { type, NULL, NULL, NULL, NULL, NULL, NULL };
+    ew_arrays windows[2];
+    for (int w = 0; w < (window > 0 ? 2 : 1); w++) {
+        ew_arrays* l = window > 0 ? &windows[w] : &local;
+        long long count = window > 0 ? window : local_size;
+        l->type = type;
+        l->a = arena_take(mem, elem, count);
+        l->b = arena_take(mem, elem, count);
+        l->sum = arena_take(mem, elem, count);
+        l->diff = arena_take(mem, elem, count);
+        l->prod = arena_take(mem, elem, count);
+        l->quot = arena_take(mem, sizeof(double), count);
+    }
+    void *local_a = local.a, *local_b = local.b;
+    void *local_sum = local.sum, *local_diff = local.diff, *local_prod = local.prod;
+    double *local_quot = local.quot;
 
-        MPI_Barrier(MPI_COMM_WORLD);
-        start = MPI_Wtime();
-        compute_div(local_a, local_b, local_quot, local_size);
-        MPI_Barrier(MPI_COMM_WORLD);
-        end = MPI_Wtime();
-        total_time_div += end - start;
+    // Глобальные массивы только у процесса 0 и только при генерации на нём;
+    // массивы результатов — только при сборе
+    ew_arrays global = { type, NULL, NULL, NULL, NULL, NULL, NULL };
+    if (root_operands) {
+        global.a = arena_take(mem, elem, n);
+        global.b = arena_take(mem, elem, n);
+    }
+    if (root_results) {
+        global.sum = arena_take(mem, elem, n);
+        global.diff = arena_take(mem, elem, n);
+        global.prod = arena_take(mem, elem, n);
+        global.quot = arena_take(mem, sizeof(double), n);
     }
+    void *a = global.a, *b = global.b;
+    MPI_Request* greqs = chunks > 0 ? arena_take(mem, sizeof(MPI_Request), 4LL * chunks) : NULL;
 
-    // Вывод результатов только у процесса 0
-    if (rank == 0) {
-        printf("Среднее время выполнения операций за %d запусков:\n", runs);
-        printf("Сложение:    %f секунд(ы)\n", total_time_add / runs);
-        printf("Вычитание:   %f секунд(ы)\n", total_time_sub / runs);
-        printf("Умножение:   %f секунд(ы)\n", total_time_mul / runs);
-        printf("Деление:     %f секунд(ы)\n", total_time_div / runs);
+    // Серии замеров
+    bm.threads = threads;
+    bm.size = n;
+    bench_param(&bm, "dtype", "%s", dtype_names[type]);
+    bench_param(&bm, "kernel", "%s", kernel_mode);
+    bench_param(&bm, "nt", "%d", use_nt);
+    bench_param(&bm, "gen", "%s", input ? "file" : local_gen ? "local" : "root");
+    bench_param(&bm, "pipeline", "%d", chunks);
+    bench_param(&bm, "stream", "%lld", window);
+    bench_param(&bm, "dynamic", "%d", dynamic);
+    bench_param(&bm, "gather", "%s", gather ? "root" : "none");
+    bench_param(&bm, "simd", "%s", kernels->name);
+    int s_add = -1, s_sub = -1, s_mul = -1, s_div = -1, s_separate = -1, s_fused = -1;
+    if (window > 0) {
+        // Потоковый проход целиком (чтение или генерация, ядро, запись) — одна серия на вариант ядра
+        if (run_separate)
+            s_separate = bench_series_add(&bm, "stream_separate", "Поток: раздельно");
+        if (run_fused)
+            s_fused = bench_series_add(&bm, "stream_fused", "Поток: совмещённое");
+    } else if (run_separate) {
+        s_add = bench_series_add(&bm, "add", "Сложение");
+        s_sub = bench_series_add(&bm, "sub", "Вычитание");
+        s_mul = bench_series_add(&bm, "mul", "Умножение");
+        s_div = bench_series_add(&bm, "div", "Деление");
+        s_separate = bench_series_add(&bm, "separate", "Все четыре раздельно");
+    }
+    if (run_fused && window == 0)
+        s_fused = bench_series_add(&bm, "fused", use_nt ? "Совмещённое (потоковое)" : "Совмещённое ядро");
+    int s_blocking = -1, s_pipeline = -1, s_read = -1;
+    if (input && window == 0)
+        s_read = bench_series_add(&bm, "read", "Чтение файлов");
+    if (gather)
+        s_blocking = bench_series_add(&bm, "blocking", local_gen || input ? "Ядро+сбор" : "Раздача+ядро+сбор");
+    if (chunks > 0)
+        s_pipeline = bench_series_add(&bm, "pipeline", "Конвейер порциями");
+
+    // Потоковый режим: входные файлы и файлы результатов открываются на все запуски
+    stream_plan splan = { 0, 0, 0, 0 };
+    stream_file sin[2], sout[4];
+    int stream_in = window > 0 && input, stream_out = window > 0 && output;
+    long long stream_bad = 0;
+    uint64_t stream_checksum = 0;
+    if (window > 0 && dynamic)
+        stream_plan_init(&splan, 0, n, window);
+    else if (window > 0)
+        stream_plan_init(&splan, local_first, local_size, window);
+    // Очередь: по проходу на каждый вариант ядра в каждой итерации
+    stream_queue queue;
+    if (dynamic)
+        stream_queue_setup(&queue, 2 * bench_iterations(&bm), MPI_COMM_WORLD);
+    if (stream_in && !(stream_open_read(&sin[0], input_a, dtype_mpi(type), MPI_COMM_WORLD)
+                       && stream_open_read(&sin[1], input_b, dtype_mpi(type), MPI_COMM_WORLD))) {
+        if (rank == 0) {
+            printf("Ошибка: не удалось открыть входные файлы.\n");
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if (stream_out) {
+        static const char* suffix[4] = { "sum", "diff", "prod", "quot" };
+        char path[4096];
+        int ok = 1;
+        for (int i = 0; i < 4; i++) {
+            snprintf(path, sizeof(path), "%s.%s", output, suffix[i]);
+            ok = ok && stream_open_write(&sout[i], path, i == 3 ? MPI_DOUBLE : dtype_mpi(type), n, MPI_COMM_WORLD);
+        }
+        if (!ok) {
+            if (rank == 0) {
+                printf("Ошибка: не удалось создать файлы результатов %s.*\n", output);
+            }
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    for (int it = 0; it < bench_iterations(&bm); it++) {
+        int run = bench_is_warmup(&bm, it) ? 0 : it - bm.warmup;  // прогрев идёт на данных первого запуска
+        trace_iteration(it);
+
+        if (window > 0) {
+            // Проход окнами для каждого выбранного варианта ядра; проверка — на последнем проходе
+            for (int fused = 0; fused < 2; fused++) {
+                if (!(fused ? run_fused : run_separate))
+                    continue;
+                int check = verify && it + 1 == bench_iterations(&bm) && (fused || !run_fused);
+                bench_sync(&bm, MPI_COMM_WORLD);
+                double start = MPI_Wtime();
+                if (dynamic)
+                    stream_queue_begin(&queue, 2 * it + fused);
+                trace_region tr = trace_begin("stream");
+                streamed_pass(&splan, dynamic ? &queue : NULL, kernels, fused, use_nt, stream_in ? sin : NULL,
+                              stream_out ? sout : NULL, windows, seed + run, check, &stream_bad, &stream_checksum);
+                trace_end(&tr);
+                bench_sync(&bm, MPI_COMM_WORLD);
+                double end = MPI_Wtime();
+                bench_record_span(&bm, fused ? s_fused : s_separate, it, start, end);
+            }
+            continue;
+        }
+
+        if (input) {
+            // Каждый процесс читает свои блоки a и b сам
+            bench_sync(&bm, MPI_COMM_WORLD);
+            double start = MPI_Wtime();
+            trace_region tr = trace_begin("read");
+            int ok = ew_read_operands(&io, input_a, input_b, &local, local_first, local_size, MPI_COMM_WORLD);
+            trace_end(&tr);
+            if (!ok) {
+                if (rank == 0) {
+                    printf("Ошибка: не удалось прочитать входные файлы.\n");
+                }
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            bench_sync(&bm, MPI_COMM_WORLD);
+            bench_record_span(&bm, s_read, it, start, MPI_Wtime());
+        } else if (local_gen) {
+            trace_region tr = trace_begin("gen");
+            fill_random(local_a, type, local_size, local_first, seed + run, 0);
+            fill_random(local_b, type, local_size, local_first, seed + run, 1);
+            trace_end(&tr);
+        } else {
+            if (rank == 0) {
+                trace_region tr = trace_begin("gen");
+                fill_random(a, type, n, 0, seed + run, 0);
+                fill_random(b, type, n, 0, seed + run, 1);
+                trace_end(&tr);
+            }
+
+            // Распределение данных между процессами
+            scatterv_blocks(a, n, dtype_mpi(type), local_a, 0, MPI_COMM_WORLD);
+            scatterv_blocks(b, n, dtype_mpi(type), local_b, 0, MPI_COMM_WORLD);
+        }
+
+        if (gather) {
+            // Полный путь данных (раздача, ядро, сбор) без перекрытия;
+            // ядро — совмещённое, если оно выбрано, иначе четыре прохода
+            bench_sync(&bm, MPI_COMM_WORLD);
+            double start = MPI_Wtime();
+            trace_region tr = trace_begin("blocking");
+            ew_roundtrip(kernels, run_fused, use_nt, !local_gen && !input, n, &global, &local, local_size,
+                         0, MPI_COMM_WORLD);
+            trace_end(&tr);
+            bench_sync(&bm, MPI_COMM_WORLD);
+            double end = MPI_Wtime();
+            bench_record_span(&bm, s_blocking, it, start, end);
+        }
+
+        if (chunks > 0) {
+            // Тот же путь конвейером порций
+            bench_sync(&bm, MPI_COMM_WORLD);
+            double start = MPI_Wtime();
+            trace_region tr = trace_begin("pipeline");
+            pipelined_pass(&plan, kernels, run_fused, use_nt, &global, &local, greqs);
+            trace_end(&tr);
+            bench_sync(&bm, MPI_COMM_WORLD);
+            double end = MPI_Wtime();
+            bench_record_span(&bm, s_pipeline, it, start, end);
+        }
+
+        if (run_separate) {
+            // Синхронизация перед замером времени
+            bench_sync(&bm, MPI_COMM_WORLD);
+            double start = MPI_Wtime();
+            trace_region tr_add = trace_begin("add");
+            simd_run_binary(kernels->ew[type].add, elem, local_a, local_b, local_sum, local_size);
+            trace_end(&tr_add);
+            bench_sync(&bm, MPI_COMM_WORLD);
+            double end = MPI_Wtime();
+            bench_record_span(&bm, s_add, it, start, end);
+            double separate = end - start;
+
+            bench_sync(&bm, MPI_COMM_WORLD);
+            start = MPI_Wtime();
+            trace_region tr_sub = trace_begin("sub");
+            simd_run_binary(kernels->ew[type].sub, elem, local_a, local_b, local_diff, local_size);
+            trace_end(&tr_sub);
+            bench_sync(&bm, MPI_COMM_WORLD);
+            end = MPI_Wtime();
+            bench_record_span(&bm, s_sub, it, start, end);
+            separate += end - start;
+
+            bench_sync(&bm, MPI_COMM_WORLD);
+            start = MPI_Wtime();
+            trace_region tr_mul = trace_begin("mul");
+            simd_run_binary(kernels->ew[type].mul, elem, local_a, local_b, local_prod, local_size);
+            trace_end(&tr_mul);
+            bench_sync(&bm, MPI_COMM_WORLD);
+            end = MPI_Wtime();
+            bench_record_span(&bm, s_mul, it, start, end);
+            separate += end - start;
+
+            bench_sync(&bm, MPI_COMM_WORLD);
+            start = MPI_Wtime();
+            trace_region tr_div = trace_begin("div");
+            simd_run_div(kernels->ew[type].div, elem, local_a, local_b, local_quot, local_size);
+            trace_end(&tr_div);
+            bench_sync(&bm, MPI_COMM_WORLD);
+            end = MPI_Wtime();
+            bench_record_span(&bm, s_div, it, start, end);
+            separate += end - start;
+            bench_record(&bm, s_separate, it, separate);
+        }
+
+        if (run_fused) {
+            // Все четыре операции за один проход
+            bench_sync(&bm, MPI_COMM_WORLD);
+            double start = MPI_Wtime();
+            trace_region tr = trace_begin("fused");
+            simd_run_fused(use_nt ? kernels->ew[type].fused_nt : kernels->ew[type].fused, &local, local_size);
+            trace_end(&tr);
+            bench_sync(&bm, MPI_COMM_WORLD);
+            double end = MPI_Wtime();
+            bench_record_span(&bm, s_fused, it, start, end);
+        }
     }
 
-    // Очистка памяти
-    free(local_a); free(local_b);
-    free(local_sum); free(local_diff); free(local_prod); free(local_quot);
+    bench_reduce_max(&bm, 0, &cl);
+
+    // Вывод результатов только у процесса 0; пропускная способность — по медиане
     if (rank == 0) {
-        free(a); free(b);
+        printf("Размер массивов: %lld (%s), процессов: %d, потоков: %d, ядро: %s\n", n, dtype_names[type], size, threads,
+               kernels->name);
+        bench_report(&bm);
+        double separate = run_separate ? bench_series_stats(&bm, s_separate).median : 0.0;
+        double fused = run_fused ? bench_series_stats(&bm, s_fused).median : 0.0;
+        if (window > 0)
+            printf("Потоковый режим: окна по %lld элементов\n", window);
+        if (run_separate)
+            printf("Все четыре раздельно: %.2f ГБ/с\n", (double)EW_BYTES_SEPARATE(elem) * n / separate / 1e9);
+        if (run_fused)
+            printf("Совмещённое ядро%s: %.2f ГБ/с\n", use_nt ? " (потоковая запись)" : "",
+                   (double)EW_BYTES_FUSED(elem) * n / fused / 1e9);
+        if (run_separate && run_fused)
+            printf("Ускорение совмещённого ядра: %.2f раз(а)\n", separate / fused);
+        if (chunks > 0)
+            printf("Ускорение конвейера (%d порций): %.2f раз(а)\n", chunks,
+                   bench_series_stats(&bm, s_blocking).median / bench_series_stats(&bm, s_pipeline).median);
+        bench_write(&bm);
+    }
+    if (dynamic) {
+        stream_queue_report(&queue, 0, MPI_COMM_WORLD);
+        stream_queue_free(&queue);
+    }
+
+    arena_report(mem, 0, MPI_COMM_WORLD);
+
+    // Проверка результатов последнего запуска: блоки процессов и собранные массивы
+    // (в потоковом режиме — итоги, накопленные по окнам последнего прохода)
+    int verified = 1;
+    if (verify && window > 0)
+        verified = ew_verify_totals(stream_bad, stream_checksum, NULL, n, 0, MPI_COMM_WORLD);
+    else if (verify)
+        verified = ew_verify(&local, local_size, local_first, gather ? &global : NULL, n, 0, MPI_COMM_WORLD);
+
+    if (stream_in) {
+        stream_close(&sin[0]);
+        stream_close(&sin[1]);
+    }
+    if (stream_out) {
+        for (int i = 0; i < 4; i++)
+            stream_close(&sout[i]);
+        if (rank == 0) {
+            printf("Результаты записаны потоком в %s.{sum,diff,prod,quot}\n", output);
+        }
+    }
+
+    // Запись результатов последнего запуска: каждый процесс пишет свои блоки
+    if (output && window == 0) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        double start = MPI_Wtime();
+        int written = ew_write_results(&io, output, &local, local_first, local_size, n, MPI_COMM_WORLD);
+        double elapsed = MPI_Wtime() - start;
+        if (rank == 0 && written) {
+            printf("Результаты записаны в %s.{sum,diff,prod,quot} за %.6f с\n", output, elapsed);
+        } else if (rank == 0) {
+            printf("Ошибка: не удалось записать результаты в %s.*\n", output);
+        }
+        verified = verified && written;
+    }
+
+    // Очистка памяти (арена остаётся следующим заданиям)
+    if (chunks > 0)
+        pipe_plan_free(&plan);
+    bench_free(&bm);
+    coll_free(&cl);
+    io_free(&io);
+    return verified ? 0 : 2;
+}
+
+int main(int argc, char *argv[]) {
+    threads_mpi_init(&argc, &argv);
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    // Трассировка (--trace=<файл>): до первой параллельной области, чтобы счётчики унаследовали потоки
+    if (!trace_setup(argc, argv, MPI_COMM_WORLD)) {
+        if (rank == 0) {
+            printf("Ошибка: не удалось выделить буфер трассы.\n");
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    // Служебный режим (--serve): задания из файла или FIFO одно за другим с общей ареной (common/serve.h)
+    arena mem = { NULL, 0, 0, 0, 0, 0 };
+    const char* serve_path = arg_value(argc, argv, "--serve");
+    int status = 0;
+    if (serve_path) {
+        serve sv;
+        if (!serve_open(&sv, serve_path, argv[0], "task3", MPI_COMM_WORLD)) {
+            if (rank == 0) {
+                printf("Ошибка: не удалось открыть поток заданий '%s'.\n", serve_path);
+            }
+            MPI_Finalize();
+            return 1;
+        }
+        while (serve_next(&sv, MPI_COMM_WORLD)) {
+            double start = MPI_Wtime();
+            int code = sv.argc > 0 ? vector_job(sv.argc, sv.argv, rank, size, &mem) : 1;
+            serve_done(&sv, code, start, MPI_COMM_WORLD);
+        }
+        serve_close(&sv, MPI_COMM_WORLD);
+    } else {
+        status = vector_job(argc, argv, rank, size, &mem);
     }
 
+    // Трасса: события всех процессов собираются на процесс 0
+    trace_finish(0, MPI_COMM_WORLD);
+    arena_free(&mem);
     MPI_Finalize();
-    return 0;
+    return status;
 }
@@ -2,46 +2,23 @@
 #include <stdlib.h>
 #include <time.h>
 
-#define ARRAY_SIZE 1000000
+#include "../common/args.h"
+#include "../common/bench.h"
+#include "../common/elementwise.h"
+#include "../common/dtype.h"
 
-// Заполнение массива случайными значениями от 1 до 100
-void fill_random(int *array, int size) {
-    for (int i = 0; i < size; i++) {
-        array[i] = rand() % 100 + 1;
-    }
-}
+#define ARRAY_SIZE 1000000  // размер по умолчанию, задаётся параметром --n
 
-// Операция сложения массивов
-void add_arrays(int *a, int *b, int *sum, int size) {
-    for (int i = 0; i < size; i++) {
-        sum[i] = a[i] + b[i];
-    }
-}
-
-// Операция вычитания массивов
-void subtract_arrays(int *a, int *b, int *diff, int size) {
-    for (int i = 0; i < size; i++) {
-        diff[i] = a[i] - b[i];
-    }
-}
-
-// Операция умножения массивов
-void multiply_arrays(int *a, int *b, int *prod, int size) {
-    for (int i = 0; i < size; i++) {
-        prod[i] = a[i] * b[i];
-    }
-}
-
-// Операция деления массивов
-void divide_arrays(int *a, int *b, double *quot, int size) {
-    for (int i = 0; i < size; i++) {
-        quot[i] = (b[i] != 0) ? ((double)a[i] / b[i]) : 0.0;
-    }
+// Заполнение массива типа type случайными значениями от 1 до 100 (тот же генератор,
+// что и в task3_par); stream различает массивы a и b
+void fill_random(void *array, dtype type, long long size, unsigned long long seed, unsigned int stream) {
+    dtype_fill(array, type, size, 0, seed, stream, 1, 100);
 }
 
 int main(int argc, char *argv[]) {
     if (argc < 2) {
-        printf("Используйте: %s <количество запусков>\n", argv[0]);
+        printf("Используйте: %s <количество запусков> [--n=<размер массива>] [--seed=<число>] [--verify]\n"
+               "       [--dtype=int|int64|float|double] [--warmup=<число>] [--format=text|csv|json] [--out=<файл>]\n", argv[0]);
         return 1;
     }
 
@@ -51,62 +28,98 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    int *a = malloc(sizeof(int) * ARRAY_SIZE);
-    int *b = malloc(sizeof(int) * ARRAY_SIZE);
-    int *sum = malloc(sizeof(int) * ARRAY_SIZE);
-    int *diff = malloc(sizeof(int) * ARRAY_SIZE);
-    int *prod = malloc(sizeof(int) * ARRAY_SIZE);
-    double *quot = malloc(sizeof(double) * ARRAY_SIZE);
+    long long n = arg_size(argc, argv, "--n", ARRAY_SIZE);
+    if (n <= 0) {
+        printf("Ошибка: некорректный размер массива.\n");
+        return 1;
+    }
+
+    unsigned long long seed = (unsigned long long)arg_long(argc, argv, "--seed", (long long)time(NULL));
+    int verify = arg_flag(argc, argv, "--verify");
+
+    // Тип элементов; операции — эталонные скалярные ядра этого типа (как в task3_par --simd=scalar)
+    dtype type;
+    if (!dtype_parse(arg_str(argc, argv, "--dtype", "int"), &type)) {
+        printf("Ошибка: неизвестное значение --dtype (int, int64, float или double).\n");
+        return 1;
+    }
+    size_t elem = dtype_size(type);
+    const ew_kernels *ops = &ew_scalar[type];
+
+    void *a = malloc(elem * n);
+    void *b = malloc(elem * n);
+    void *sum = malloc(elem * n);
+    void *diff = malloc(elem * n);
+    void *prod = malloc(elem * n);
+    double *quot = malloc(sizeof(double) * n);
 
     if (!a || !b || !sum || !diff || !prod || !quot) {
         printf("Ошибка выделения памяти.\n");
         return 1;
     }
 
-     // Время для каждой операции
-    double time_add = 0.0;
-    double time_sub = 0.0;
-    double time_mul = 0.0;
-    double time_div = 0.0;
+    // Измерения: --warmup, --format, --out
+    bench bm;
+    if (!bench_init(&bm, "task3_seq", runs, argc, argv)) {
+        printf("Ошибка: некорректное значение --warmup или --format.\n");
+        return 1;
+    }
+    bm.size = n;
+    bench_param(&bm, "dtype", "%s", dtype_names[type]);
+    int s_add = bench_series_add(&bm, "add", "Сложение");
+    int s_sub = bench_series_add(&bm, "sub", "Вычитание");
+    int s_mul = bench_series_add(&bm, "mul", "Умножение");
+    int s_div = bench_series_add(&bm, "div", "Деление");
+    int s_separate = bench_series_add(&bm, "separate", "Все четыре раздельно");
+
+    for (int it = 0; it < bench_iterations(&bm); it++) {
+        int run = bench_is_warmup(&bm, it) ? 0 : it - bm.warmup;  // прогрев идёт на данных первого запуска
 
-    for (int run = 0; run < runs; run++) {
-        srand(time(NULL) + run);
-        fill_random(a, ARRAY_SIZE);
-        fill_random(b, ARRAY_SIZE);
+        fill_random(a, type, n, seed + run, 0);
+        fill_random(b, type, n, seed + run, 1);
 
-        clock_t start, end;
+        double start, end, separate = 0.0;
 
         // Сложение
-        start = clock();
-        add_arrays(a, b, sum, ARRAY_SIZE);
-        end = clock();
-        time_add += (double)(end - start) / CLOCKS_PER_SEC;
+        start = bench_now();
+        ops->add(a, b, sum, n);
+        end = bench_now();
+        bench_record(&bm, s_add, it, end - start);
+        separate += end - start;
 
         // Вычитание
-        start = clock();
-        subtract_arrays(a, b, diff, ARRAY_SIZE);
-        end = clock();
-        time_sub += (double)(end - start) / CLOCKS_PER_SEC;
+        start = bench_now();
+        ops->sub(a, b, diff, n);
+        end = bench_now();
+        bench_record(&bm, s_sub, it, end - start);
+        separate += end - start;
 
         // Умножение
-        start = clock();
-        multiply_arrays(a, b, prod, ARRAY_SIZE);
-        end = clock();
-        time_mul += (double)(end - start) / CLOCKS_PER_SEC;
+        start = bench_now();
+        ops->mul(a, b, prod, n);
+        end = bench_now();
+        bench_record(&bm, s_mul, it, end - start);
+        separate += end - start;
 
         // Деление
-        start = clock();
-        divide_arrays(a, b, quot, ARRAY_SIZE);
-        end = clock();
-        time_div += (double)(end - start) / CLOCKS_PER_SEC;
-    }
+        start = bench_now();
+        ops->div(a, b, quot, n);
+        end = bench_now();
+        bench_record(&bm, s_div, it, end - start);
+        separate += end - start;
 
+        bench_record(&bm, s_separate, it, separate);
+    }
 
-    printf("Среднее время выполнения операций за %d запусков:\n", runs);
-    printf("Сложение:    %f секунд(ы)\n", time_add / runs);
-    printf("Вычитание:   %f секунд(ы)\n", time_sub / runs);
-    printf("Умножение:   %f секунд(ы)\n", time_mul / runs);
-    printf("Деление:     %f секунд(ы)\n", time_div / runs);
+    printf("Размер массивов: %lld (%s)\n", n, dtype_names[type]);
+    bench_report(&bm);
+    // Контрольная сумма результатов последнего запуска совпадает с task3_par --verify при том же --seed
+    if (verify) {
+        ew_arrays results = { type, a, b, sum, diff, prod, quot };
+        printf("Контрольная сумма: %016llx\n", (unsigned long long)ew_checksum(&results, n, 0));
+    }
+    bench_write(&bm);
+    bench_free(&bm);
 
     free(a); free(b); free(sum); free(diff); free(prod); free(quot);
     return 0;
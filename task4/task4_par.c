@@ -1,160 +1,518 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <mpi.h>
 
+#include "../common/arena.h"
+#include "../common/args.h"
+#include "../common/bench.h"
+#include "../common/coll.h"
+#include "../common/decomp.h"
+#include "../common/dtype.h"
+#include "../common/gather.h"
+#include "../common/grid.h"
+#include "../common/matrix.h"
+#include "../common/rng.h"
+#include "../common/serve.h"
+#include "../common/simd.h"
+#include "../common/trace.h"
+
+// Размеры по умолчанию, задаются параметрами --rows и --cols
 #define ROWS 500
 #define COLS 500
-#define SIZE (ROWS * COLS)
 
-// Заполнение массива случайными числами от 1 до 100
-void fill_random(int* matrix, int size) {
-    for (int i = 0; i < size; ++i)
-        matrix[i] = rand() % 100 + 1;
+// Заполнение элементов first..first+size-1 матрицы типа type (построчно) случайными числами
+// от 1 до 100; stream различает матрицы A и B. Каждый поток заполняет свой отрезок
+void fill_random(void* matrix, dtype type, long long size, long long first, unsigned long long seed,
+                 unsigned int stream) {
+    size_t elem = dtype_size(type);
+#pragma omp parallel
+    {
+        long long from, count;
+        threads_range(size, &from, &count);
+        dtype_fill((char*)matrix + from * elem, type, count, first + from, seed, stream, 1, 100);
+    }
 }
 
-// Операции над частями массивов (локальными блоками)
-void add_op(int* A, int* B, int* C, int n) {
-    for (int i = 0; i < n; ++i)
-        C[i] = A[i] + B[i];
+// Заполнение плитки двумерного разбиения: каждый непрерывный в полной матрице отрезок
+// строки плитки получает значения своих глобальных индексов, как при построчном заполнении
+void fill_tile(const grid2d* grid, void* tile, dtype type, unsigned long long seed, unsigned int stream) {
+    size_t elem = dtype_size(type);
+#pragma omp parallel for
+    for (long long li = 0; li < grid->local_rows; li++) {
+        long long len, global;
+        for (long long lj = 0; lj < grid->local_cols; lj += len) {
+            len = grid_run(grid, li, lj, &global);
+            dtype_fill((char*)tile + (li * grid->local_cols + lj) * elem, type, len, global, seed, stream, 1, 100);
+        }
+    }
 }
 
-void sub_op(int* A, int* B, int* C, int n) {
-    for (int i = 0; i < n; ++i)
-        C[i] = A[i] - B[i];
-}
+// Одно задание: запуски поэлементных операций с параметрами argv, как в командной строке.
+// Плитки берутся из арены mem, которая переживает задания служебного режима.
+// Возвращает 0 при успехе, 1 при ошибке в параметрах, 2 при неудачной проверке или записи
+static int matrix_job(int argc, char* argv[], int rank, int nproc, arena* mem) {
+    if (argc < 2) {
+        if (rank == 0)
+            printf("Использование: mpirun -np <процессы> %s <запуски> [--rows=<строки>] [--cols=<столбцы>] "
+                   "[--gen=root|local] [--input=<файл A>,<файл B>] [--output=<префикс>] [--io=mpiio|mmap] "
+                   "[--cb-buffer=<байт>] [--cb-nodes=<число>] [--decomp=rows|grid] [--grid=<P>x<Q>] [--block=<размер>] [--arena=<байт>] [--huge] [--gather=none|root] [--verify] [--seed=<число>] [--dtype=int|int64|float|double] [--kernel=separate|fused|both] [--nt] "
+                   "[--simd=auto|scalar|avx2|avx512] [--threads=<потоков>] [--bind=none|close|spread]\n"
+                   "       [--warmup=<число>] [--format=text|csv|json] [--out=<файл>] [--trace=<файл>] [--timing=barrier|local|global] [--coll=flat|hier]\n"
+                   "       mpirun -np <процессы> %s --serve=<файл или FIFO> [--trace=<файл>]\n", argv[0], argv[0]);
+        return 1;
+    }
 
-void mul_op(int* A, int* B, int* C, int n) {
-    for (int i = 0; i < n; ++i)
-        C[i] = A[i] * B[i];
-}
+    int runs = atoi(argv[1]);
+    if (runs <= 0) {
+        if (rank == 0)
+            printf("Количество запусков должно быть больше 0\n");
+        return 1;
+    }
 
-void div_op(int* A, int* B, double* C, int n) {
-    for (int i = 0; i < n; ++i)
-        C[i] = (double)A[i] / B[i]; // безопасно, т.к. B[i] >= 1
-}
+    // Измерения: --warmup, --format, --out
+    bench bm;
+    if (!bench_init(&bm, "task4_par", runs, argc, argv)) {
+        if (rank == 0)
+            printf("Ошибка: некорректное значение --warmup, --format или --timing\n");
+        return 1;
+    }
+    // Свёртки по процессам (--coll): плоские или двухуровневые через общую память узла
+    int coll_arg = coll_mode_arg(argc, argv);
+    if (coll_arg < 0) {
+        if (rank == 0)
+            printf("Ошибка: неизвестный режим свёрток --coll (flat или hier).\n");
+        return 1;
+    }
+    // Тип элементов матриц (частное всегда double)
+    dtype type;
+    if (!dtype_parse(arg_str(argc, argv, "--dtype", "int"), &type)) {
+        if (rank == 0)
+            printf("Ошибка: неизвестное значение --dtype (int, int64, float или double)\n");
+        return 1;
+    }
+    size_t elem = dtype_size(type);
 
-int main(int argc, char* argv[]) {
-    MPI_Init(&argc, &argv);
+    // Матрицы из файлов (--input=<A>,<B>, построчно, элементы типа --dtype) и запись результатов (--output=<префикс>)
+    const char* input = arg_value(argc, argv, "--input");
+    const char* output = arg_value(argc, argv, "--output");
+    char input_a[4096], input_b[4096];
+    if (input && !io_split_pair(input, input_a, input_b, sizeof(input_a))) {
+        if (rank == 0)
+            printf("Ошибка: некорректное значение --input\n");
+        return 1;
+    }
 
-    int rank, nproc;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+    // Матрица хранится построчно как одномерный массив из rows * cols элементов;
+    // при чтении из файлов число строк определяется по длине файла и --cols
+    long long rows = arg_size(argc, argv, "--rows", ROWS);
+    long long cols = arg_size(argc, argv, "--cols", COLS);
+    if (input) {
+        long long count = io_file_count(input_a, (int)elem, MPI_COMM_WORLD);
+        if (count < 0 || io_file_count(input_b, (int)elem, MPI_COMM_WORLD) != count
+            || cols <= 0 || count % cols != 0) {
+            if (rank == 0)
+                printf("Ошибка: входные файлы не открываются, имеют разную длину или длину, не кратную --cols\n");
+            return 1;
+        }
+        rows = count / cols;
+    }
+    if (rows <= 0 || cols <= 0 || !decomp_fits(rows * cols, nproc)) {
+        if (rank == 0)
+            printf("Ошибка: некорректный размер матрицы или блок процесса больше %d элементов\n", INT_MAX);
+        return 1;
+    }
+    long long size = rows * cols;
 
-    if (argc < 2) {
+    // Разбиение: по строкам как одномерный массив (rows) или плитками по решётке P x Q (grid),
+    // блочное или блочно-циклическое с блоками --block x --block
+    const char* decomp_mode = arg_str(argc, argv, "--decomp", "rows");
+    int use_grid = strcmp(decomp_mode, "grid") == 0;
+    int dims[2] = { 0, 0 };
+    const char* grid_arg = arg_value(argc, argv, "--grid");
+    int block = (int)arg_long(argc, argv, "--block", 0);
+    grid2d grid;
+    grid.comm = MPI_COMM_NULL;
+    if ((!use_grid && strcmp(decomp_mode, "rows") != 0)
+        || (grid_arg && sscanf(grid_arg, "%dx%d", &dims[0], &dims[1]) != 2)) {
         if (rank == 0)
-            printf("Использование: mpirun -np <процессы> %s <запуски>\n", argv[0]);
-        MPI_Finalize();
+            printf("Ошибка: некорректное значение --decomp или --grid\n");
         return 1;
     }
 
-    int runs = atoi(argv[1]);
-    if (runs <= 0) {
+    // Ядра: четыре раздельных прохода (по умолчанию), один совмещённый проход или оба для сравнения;
+    // --nt включает потоковые записи в совмещённом ядре
+    const char* kernel_mode = arg_str(argc, argv, "--kernel", "separate");
+    int run_separate = strcmp(kernel_mode, "separate") == 0 || strcmp(kernel_mode, "both") == 0;
+    int run_fused = strcmp(kernel_mode, "fused") == 0 || strcmp(kernel_mode, "both") == 0;
+    int use_nt = arg_flag(argc, argv, "--nt");
+    if (!run_separate && !run_fused) {
         if (rank == 0)
-            printf("Количество запусков должно быть больше 0\n");
-        MPI_Finalize();
+            printf("Ошибка: неизвестный режим ядер '%s' (separate, fused или both)\n", kernel_mode);
         return 1;
     }
 
-    if (SIZE % nproc != 0) {
+    // Генерация данных: целиком на процессе 0 с раздачей (root) или по блокам на месте (local)
+    const char* gen_mode = arg_str(argc, argv, "--gen", "root");
+    int local_gen = strcmp(gen_mode, "local") == 0;
+    if (!local_gen && strcmp(gen_mode, "root") != 0) {
         if (rank == 0)
-            printf("Ошибка: размер массива %d не делится на %d процессов\n", SIZE, nproc);
-        MPI_Finalize();
+            printf("Ошибка: неизвестный режим генерации '%s' (root или local)\n", gen_mode);
         return 1;
     }
 
-    int local_size = SIZE / nproc;
+    // Сбор результатов на процессе 0 и проверка по эталонному ядру
+    const char* gather_mode = arg_str(argc, argv, "--gather", "none");
+    int gather = strcmp(gather_mode, "root") == 0;
+    int verify = arg_flag(argc, argv, "--verify");
+    if (!gather && strcmp(gather_mode, "none") != 0) {
+        if (rank == 0)
+            printf("Ошибка: неизвестный режим сбора '%s' (none или root)\n", gather_mode);
+        return 1;
+    }
 
-    // Выделение локальной памяти
-    int* local_A = (int*)malloc(local_size * sizeof(int));
-    int* local_B = (int*)malloc(local_size * sizeof(int));
-    int* local_add = (int*)malloc(local_size * sizeof(int));
-    int* local_sub = (int*)malloc(local_size * sizeof(int));
-    int* local_mul = (int*)malloc(local_size * sizeof(int));
-    double* local_div = (double*)malloc(local_size * sizeof(double));
+    // Начальное значение генератора: --seed или текущее время процесса 0
+    unsigned long long seed = (unsigned long long)arg_long(argc, argv, "--seed", (long long)time(NULL));
+    MPI_Bcast(&seed, 1, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
 
-    // Только у корневого процесса будут полные массивы
-    int* A = NULL;
-    int* B = NULL;
-    if (rank == 0) {
-        A = (int*)malloc(SIZE * sizeof(int));
-        B = (int*)malloc(SIZE * sizeof(int));
+    // Вариант векторных ядер: auto (по CPUID), scalar, avx2 или avx512
+    const simd_kernels* kernels = simd_setup(arg_str(argc, argv, "--simd", "auto"), rank == 0);
+    if (!kernels) {
+        if (rank == 0)
+            printf("Ошибка: вариант --simd неизвестен или не поддерживается процессором\n");
+        return 1;
     }
 
-    double total_add_time = 0.0;
-    double total_sub_time = 0.0;
-    double total_mul_time = 0.0;
-    double total_div_time = 0.0;
+    // Потоки процесса: --threads и привязка --bind
+    int threads = threads_setup(argc, argv, rank == 0);
+    if (!threads) {
+        if (rank == 0)
+            printf("Ошибка: некорректное значение --threads или --bind\n");
+        return 1;
+    }
 
-    for (int r = 0; r < runs; r++) {
-        if (rank == 0) {
-            srand(time(NULL) + r);
-            fill_random(A, SIZE);
-            fill_random(B, SIZE);
+    // Ресурсы задания — после всех проверок, выше которых задание ничего не выделяет:
+    // подсказки MPI-IO и решётка процессов; каждое следующее задание создаёт их заново
+    io_config io;
+    if (!io_setup(&io, argc, argv)) {
+        if (rank == 0)
+            printf("Ошибка: некорректное значение --io, --cb-buffer или --cb-nodes\n");
+        return 1;
+    }
+    if (use_grid && !grid_init(&grid, rows, cols, dims, block, MPI_COMM_WORLD)) {
+        if (rank == 0)
+            printf("Ошибка: некорректное значение --grid или --block, либо решётка не подходит "
+                   "к матрице и числу процессов\n");
+        grid_free(&grid);
+        io_free(&io);
+        return 1;
+    }
+
+    // Режим замера (--timing): в режиме global — выравнивание часов процессов
+    bench_timing_setup(&bm, MPI_COMM_WORLD);
+    coll cl;
+    coll_setup(&cl, MPI_COMM_WORLD, (coll_mode)coll_arg);
+    bench_param(&bm, "coll", "%s", coll_mode_names[coll_arg]);
+
+    // Блок строк (local_first — его первый элемент) или плитка решётки
+    long long local_size = use_grid ? grid_tile_size(&grid) : block_count(size, nproc, rank);
+    long long local_first = use_grid ? 0 : block_start(size, nproc, rank);
+
+    // Арена процесса: шесть плиток, на процессе 0 — матрицы операндов (при генерации на нём)
+    // и результатов (при сборе). --huge размещает арену на больших страницах
+    int root_operands = rank == 0 && !local_gen && !input;
+    int root_results = gather && rank == 0;
+    size_t needed = (size_t)local_size * (5 * elem + sizeof(double)) + ARENA_SLACK;
+    if (root_operands)
+        needed += (size_t)size * 2 * elem;
+    if (root_results)
+        needed += (size_t)size * (3 * elem + sizeof(double));
+    if (!arena_ensure(mem, argc, argv, needed)) {
+        if (rank == 0)
+            printf("Ошибка: некорректное значение --arena или не удалось зарезервировать память.\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // Локальные плитки — матрицы common/matrix.h поверх буферов арены, сплошные:
+    // плитки пересылаются и читаются целиком. При разбиении по строкам плитка — одна строка
+    // из local_size элементов. Страницы арены уже получили первое касание
+    long long tile_rows = use_grid ? grid.local_rows : 1;
+    long long tile_cols = use_grid ? grid.local_cols : local_size;
+    matrix tile_A, tile_B, tile_add, tile_sub, tile_mul, tile_div;
+    matrix_wrap(&tile_A, arena_take(mem, elem, local_size), tile_rows, tile_cols, elem);
+    matrix_wrap(&tile_B, arena_take(mem, elem, local_size), tile_rows, tile_cols, elem);
+    matrix_wrap(&tile_add, arena_take(mem, elem, local_size), tile_rows, tile_cols, elem);
+    matrix_wrap(&tile_sub, arena_take(mem, elem, local_size), tile_rows, tile_cols, elem);
+    matrix_wrap(&tile_mul, arena_take(mem, elem, local_size), tile_rows, tile_cols, elem);
+    matrix_wrap(&tile_div, arena_take(mem, sizeof(double), local_size), tile_rows, tile_cols, sizeof(double));
+    void* local_A = tile_A.data;
+    void* local_B = tile_B.data;
+    void* local_add = tile_add.data;
+    void* local_sub = tile_sub.data;
+    void* local_mul = tile_mul.data;
+    double* local_div = (double*)tile_div.data;
+
+    // Только у корневого процесса будут полные матрицы, и только при генерации на нём;
+    // матрицы результатов — только при сборе
+    matrix full[6];
+    memset(full, 0, sizeof(full));
+    for (int i = 0; i < 6; i++) {
+        size_t bytes = i == 5 ? sizeof(double) : elem;
+        if (i < 2 ? root_operands : root_results)
+            matrix_wrap(&full[i], arena_take(mem, bytes, size), rows, cols, bytes);
+    }
+    void* A = full[0].data;
+    void* B = full[1].data;
+    ew_arrays local = { type, local_A, local_B, local_add, local_sub, local_mul, local_div };
+    ew_arrays global = { type, A, B, full[2].data, full[3].data, full[4].data, (double*)full[5].data };
+
+    // Серии замеров; время каждой итерации берётся как максимум по процессам
+    bm.threads = threads;
+    bm.size = size;
+    bench_param(&bm, "rows", "%lld", rows);
+    bench_param(&bm, "cols", "%lld", cols);
+    bench_param(&bm, "dtype", "%s", dtype_names[type]);
+    bench_param(&bm, "kernel", "%s", kernel_mode);
+    bench_param(&bm, "nt", "%d", use_nt);
+    bench_param(&bm, "gen", "%s", input ? "file" : gen_mode);
+    bench_param(&bm, "decomp", "%s", decomp_mode);
+    if (use_grid) {
+        bench_param(&bm, "grid", "%dx%d", grid.dims[0], grid.dims[1]);
+        bench_param(&bm, "block", "%d", block);
+    }
+    bench_param(&bm, "gather", "%s", gather_mode);
+    bench_param(&bm, "simd", "%s", kernels->name);
+    int s_add = -1, s_sub = -1, s_mul = -1, s_div = -1, s_separate = -1, s_fused = -1;
+    if (run_separate) {
+        s_add = bench_series_add(&bm, "add", "Сложение");
+        s_sub = bench_series_add(&bm, "sub", "Вычитание");
+        s_mul = bench_series_add(&bm, "mul", "Умножение");
+        s_div = bench_series_add(&bm, "div", "Деление");
+        s_separate = bench_series_add(&bm, "separate", "Все четыре раздельно");
+    }
+    if (run_fused)
+        s_fused = bench_series_add(&bm, "fused", use_nt ? "Совмещённое (потоковое)" : "Совмещённое ядро");
+    int s_blocking = -1, s_read = -1;
+    if (input)
+        s_read = bench_series_add(&bm, "read", "Чтение файлов");
+    if (gather)
+        s_blocking = bench_series_add(&bm, "blocking", local_gen || input ? "Ядро+сбор" : "Раздача+ядро+сбор");
+
+    for (int it = 0; it < bench_iterations(&bm); it++) {
+        int r = bench_is_warmup(&bm, it) ? 0 : it - bm.warmup;  // прогрев идёт на данных первого запуска
+        trace_iteration(it);
+
+        if (input) {
+            // Каждый процесс читает свои блоки строк A и B сам
+            bench_sync(&bm, MPI_COMM_WORLD);
+            double start = MPI_Wtime();
+            trace_region tr = trace_begin("read");
+            int ok = use_grid ? ew_grid_read_operands(&io, input_a, input_b, &grid, &local)
+                              : ew_read_operands(&io, input_a, input_b, &local, local_first, local_size,
+                                                 MPI_COMM_WORLD);
+            trace_end(&tr);
+            if (!ok) {
+                if (rank == 0)
+                    printf("Ошибка: не удалось прочитать входные файлы\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            double end = MPI_Wtime();
+            bench_record_span(&bm, s_read, it, start, end);
+        } else if (local_gen && use_grid) {
+            trace_region tr = trace_begin("gen");
+            fill_tile(&grid, local_A, type, seed + r, 0);
+            fill_tile(&grid, local_B, type, seed + r, 1);
+            trace_end(&tr);
+        } else if (local_gen) {
+            trace_region tr = trace_begin("gen");
+            fill_random(local_A, type, local_size, local_first, seed + r, 0);
+            fill_random(local_B, type, local_size, local_first, seed + r, 1);
+            trace_end(&tr);
+        } else {
+            if (rank == 0) {
+                trace_region tr = trace_begin("gen");
+                fill_random(A, type, size, 0, seed + r, 0);
+                fill_random(B, type, size, 0, seed + r, 1);
+                trace_end(&tr);
+            }
+
+            // Рассылка данных частям процессов: блоками строк или плитками
+            if (use_grid) {
+                grid_scatter(&grid, A, dtype_mpi(type), local_A, 0);
+                grid_scatter(&grid, B, dtype_mpi(type), local_B, 0);
+            } else {
+                scatterv_blocks(A, size, dtype_mpi(type), local_A, 0, MPI_COMM_WORLD);
+                scatterv_blocks(B, size, dtype_mpi(type), local_B, 0, MPI_COMM_WORLD);
+            }
         }
 
-        // Рассылка данных частям процессов
-        MPI_Scatter(A, local_size, MPI_INT, local_A, local_size, MPI_INT, 0, MPI_COMM_WORLD);
-        MPI_Scatter(B, local_size, MPI_INT, local_B, local_size, MPI_INT, 0, MPI_COMM_WORLD);
+        if (gather) {
+            // Полный путь данных: раздача, ядро (совмещённое, если выбрано) и сбор на процессе 0
+            bench_sync(&bm, MPI_COMM_WORLD);
+            double start = MPI_Wtime();
+            trace_region tr = trace_begin("blocking");
+            if (use_grid)
+                ew_grid_roundtrip(kernels, run_fused, use_nt, !local_gen && !input, &grid, &global, &local, 0);
+            else
+                ew_roundtrip(kernels, run_fused, use_nt, !local_gen && !input, size, &global, &local, local_size,
+                             0, MPI_COMM_WORLD);
+            trace_end(&tr);
+            double end = MPI_Wtime();
+            bench_record_span(&bm, s_blocking, it, start, end);
+        }
 
-        // СЛОЖЕНИЕ 
-        MPI_Barrier(MPI_COMM_WORLD);
-        double start = MPI_Wtime();
-        add_op(local_A, local_B, local_add, local_size);
-        double end = MPI_Wtime();
-        total_add_time += (end - start);
+        if (run_separate) {
+            // СЛОЖЕНИЕ 
+            bench_sync(&bm, MPI_COMM_WORLD);
+            double start = MPI_Wtime();
+            trace_region tr_add = trace_begin("add");
+            simd_run_binary(kernels->ew[type].add, elem, local_A, local_B, local_add, local_size);
+            trace_end(&tr_add);
+            double end = MPI_Wtime();
+            bench_record_span(&bm, s_add, it, start, end);
+            double separate = end - start;
 
-        // ВЫЧИТАНИЕ
-        MPI_Barrier(MPI_COMM_WORLD);
-        start = MPI_Wtime();
-        sub_op(local_A, local_B, local_sub, local_size);
-        end = MPI_Wtime();
-        total_sub_time += (end - start);
+            // ВЫЧИТАНИЕ
+            bench_sync(&bm, MPI_COMM_WORLD);
+            start = MPI_Wtime();
+            trace_region tr_sub = trace_begin("sub");
+            simd_run_binary(kernels->ew[type].sub, elem, local_A, local_B, local_sub, local_size);
+            trace_end(&tr_sub);
+            end = MPI_Wtime();
+            bench_record_span(&bm, s_sub, it, start, end);
+            separate += end - start;
 
-        // УМНОЖЕНИЕ
-        MPI_Barrier(MPI_COMM_WORLD);
-        start = MPI_Wtime();
-        mul_op(local_A, local_B, local_mul, local_size);
-        end = MPI_Wtime();
-        total_mul_time += (end - start);
+            // УМНОЖЕНИЕ
+            bench_sync(&bm, MPI_COMM_WORLD);
+            start = MPI_Wtime();
+            trace_region tr_mul = trace_begin("mul");
+            simd_run_binary(kernels->ew[type].mul, elem, local_A, local_B, local_mul, local_size);
+            trace_end(&tr_mul);
+            end = MPI_Wtime();
+            bench_record_span(&bm, s_mul, it, start, end);
+            separate += end - start;
+
+            // ДЕЛЕНИЕ (B[i] >= 1, проверка на ноль не срабатывает)
+            bench_sync(&bm, MPI_COMM_WORLD);
+            start = MPI_Wtime();
+            trace_region tr_div = trace_begin("div");
+            simd_run_div(kernels->ew[type].div, elem, local_A, local_B, local_div, local_size);
+            trace_end(&tr_div);
+            end = MPI_Wtime();
+            bench_record_span(&bm, s_div, it, start, end);
+            separate += end - start;
+            bench_record(&bm, s_separate, it, separate);
+        }
+
+        if (run_fused) {
+            // ВСЕ ЧЕТЫРЕ ОПЕРАЦИИ ЗА ОДИН ПРОХОД
+            bench_sync(&bm, MPI_COMM_WORLD);
+            double start = MPI_Wtime();
+            trace_region tr = trace_begin("fused");
+            simd_run_fused(use_nt ? kernels->ew[type].fused_nt : kernels->ew[type].fused, &local, local_size);
+            trace_end(&tr);
+            double end = MPI_Wtime();
+            bench_record_span(&bm, s_fused, it, start, end);
+        }
+    }
+
+    bench_reduce_max(&bm, 0, &cl);
+
+    if (rank == 0) {
+        printf("Размер матриц: %lld x %lld (%s), процессов: %d, потоков: %d, ядро: %s\n", rows, cols,
+               dtype_names[type], nproc, threads, kernels->name);
+        if (use_grid)
+            printf("Решётка процессов: %d x %d, %s\n", grid.dims[0], grid.dims[1],
+                   block > 0 ? "блочно-циклическое разбиение" : "блочное разбиение");
+        bench_report(&bm);
+        // Пропускная способность считается по медиане и полному объёму матриц
+        double separate_time = run_separate ? bench_series_stats(&bm, s_separate).median : 0.0;
+        double fused_time = run_fused ? bench_series_stats(&bm, s_fused).median : 0.0;
+        if (run_separate)
+            printf("Все четыре раздельно: %.2f ГБ/с\n", (double)EW_BYTES_SEPARATE(elem) * size / separate_time / 1e9);
+        if (run_fused) {
+            printf("Совмещённое ядро%s: %.2f ГБ/с\n", use_nt ? " (потоковая запись)" : "",
+                   (double)EW_BYTES_FUSED(elem) * size / fused_time / 1e9);
+        }
+        if (run_separate && run_fused)
+            printf("Ускорение совмещённого ядра: %.2f раз(а)\n", separate_time / fused_time);
+        bench_write(&bm);
+    }
 
-        // ДЕЛЕНИЕ 
+    arena_report(mem, 0, MPI_COMM_WORLD);
+
+    // Проверка результатов последнего запуска: блоки процессов и собранные матрицы
+    int verified = 1;
+    if (verify && use_grid)
+        verified = ew_verify_sum(&local, local_size, ew_grid_checksum(&grid, &local), gather ? &global : NULL,
+                                 size, 0, MPI_COMM_WORLD);
+    else if (verify)
+        verified = ew_verify(&local, local_size, local_first, gather ? &global : NULL, size, 0, MPI_COMM_WORLD);
+
+    // Запись результатов последнего запуска: каждый процесс пишет свои строки
+    if (output) {
         MPI_Barrier(MPI_COMM_WORLD);
-        start = MPI_Wtime();
-        div_op(local_A, local_B, local_div, local_size);
-        end = MPI_Wtime();
-        total_div_time += (end - start);
+        double start = MPI_Wtime();
+        int written = use_grid ? ew_grid_write_results(&io, output, &grid, &local)
+                               : ew_write_results(&io, output, &local, local_first, local_size, size, MPI_COMM_WORLD);
+        double end = MPI_Wtime();
+        if (rank == 0) {
+            if (written)
+                printf("Результаты записаны в %s.{sum,diff,prod,quot} за %.6f с\n", output, end - start);
+            else
+                printf("Ошибка: не удалось записать результаты в %s.*\n", output);
+        }
+        verified = verified && written;
     }
 
-    // Сбор суммарного времени со всех процессов на rank 0
-    double global_add_time = 0.0, global_sub_time = 0.0;
-    double global_mul_time = 0.0, global_div_time = 0.0;
+    // Очистка памяти (арена остаётся следующим заданиям)
+    bench_free(&bm);
+    coll_free(&cl);
+    io_free(&io);
+    grid_free(&grid);
+    return verified ? 0 : 2;
+}
+
+int main(int argc, char* argv[]) {
+    threads_mpi_init(&argc, &argv);
 
-    MPI_Reduce(&total_add_time, &global_add_time, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
-    MPI_Reduce(&total_sub_time, &global_sub_time, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
-    MPI_Reduce(&total_mul_time, &global_mul_time, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
-    MPI_Reduce(&total_div_time, &global_div_time, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    int rank, nproc;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
 
-    if (rank == 0) {
-        printf("Среднее время выполнения операций за %d запусков (в секундах):\n", runs);
-        printf("Сложение:    %f\n", global_add_time / (runs * nproc));
-        printf("Вычитание:   %f\n", global_sub_time / (runs * nproc));
-        printf("Умножение:   %f\n", global_mul_time / (runs * nproc));
-        printf("Деление:     %f\n", global_div_time / (runs * nproc));
-    }
-
-    // Очистка памяти
-    free(local_A);
-    free(local_B);
-    free(local_add);
-    free(local_sub);
-    free(local_mul);
-    free(local_div);
-    if (rank == 0) {
-        free(A);
-        free(B);
+    // Трассировка (--trace=<файл>): до первой параллельной области, чтобы счётчики унаследовали потоки
+    if (!trace_setup(argc, argv, MPI_COMM_WORLD)) {
+        if (rank == 0)
+            printf("Ошибка: не удалось выделить буфер трассы.\n");
+        MPI_Finalize();
+        return 1;
+    }
+
+    // Служебный режим (--serve): задания из файла или FIFO одно за другим с общей ареной (common/serve.h)
+    arena mem = { NULL, 0, 0, 0, 0, 0 };
+    const char* serve_path = arg_value(argc, argv, "--serve");
+    int status = 0;
+    if (serve_path) {
+        serve sv;
+        if (!serve_open(&sv, serve_path, argv[0], "task4", MPI_COMM_WORLD)) {
+            if (rank == 0)
+                printf("Ошибка: не удалось открыть поток заданий '%s'.\n", serve_path);
+            MPI_Finalize();
+            return 1;
+        }
+        while (serve_next(&sv, MPI_COMM_WORLD)) {
+            double start = MPI_Wtime();
+            int code = sv.argc > 0 ? matrix_job(sv.argc, sv.argv, rank, nproc, &mem) : 1;
+            serve_done(&sv, code, start, MPI_COMM_WORLD);
+        }
+        serve_close(&sv, MPI_COMM_WORLD);
+    } else {
+        status = matrix_job(argc, argv, rank, nproc, &mem);
     }
 
+    trace_finish(0, MPI_COMM_WORLD);
+    arena_free(&mem);
     MPI_Finalize();
-    return 0;
+    return status;
 }
@@ -2,44 +2,38 @@
 #include <stdlib.h>
 #include <time.h>
 
+#include "../common/args.h"
+#include "../common/bench.h"
+#include "../common/elementwise.h"
+#include "../common/matrix.h"
+#include "../common/dtype.h"
+
+// Размеры по умолчанию, задаются параметрами --rows и --cols
 #define ROWS 500
 #define COLS 500
 
-// Заполнение матрицы случайными числами от 1 до 100
-void fill_random(int matrix[ROWS][COLS]) {
-    for (int i = 0; i < ROWS; ++i)
-        for (int j = 0; j < COLS; ++j)
-            matrix[i][j] = rand() % 100 + 1;
-}
-
-// Операции над элементами матриц
-void add_matrices(int A[ROWS][COLS], int B[ROWS][COLS], int C[ROWS][COLS]) {
-    for (int i = 0; i < ROWS; ++i)
-        for (int j = 0; j < COLS; ++j)
-            C[i][j] = A[i][j] + B[i][j];
-}
-
-void sub_matrices(int A[ROWS][COLS], int B[ROWS][COLS], int C[ROWS][COLS]) {
-    for (int i = 0; i < ROWS; ++i)
-        for (int j = 0; j < COLS; ++j)
-            C[i][j] = A[i][j] - B[i][j];
+// Заполнение матрицы типа type случайными числами от 1 до 100 (тот же генератор, что и в task4_par);
+// stream различает матрицы A и B
+void fill_random(const matrix* m, dtype type, unsigned long long seed, unsigned int stream) {
+    for (long long i = 0; i < m->rows; ++i)
+        dtype_fill(matrix_row(m, i), type, m->cols, i * m->cols, seed, stream, 1, 100);
 }
 
-void mul_matrices(int A[ROWS][COLS], int B[ROWS][COLS], int C[ROWS][COLS]) {
-    for (int i = 0; i < ROWS; ++i)
-        for (int j = 0; j < COLS; ++j)
-            C[i][j] = A[i][j] * B[i][j];
+// Операции над элементами матриц: построчно теми же ядрами, что и в task4_par (common/elementwise.h)
+void binary_matrices(ew_binary_fn op, const matrix* A, const matrix* B, const matrix* C) {
+    for (long long i = 0; i < A->rows; ++i)
+        op(matrix_row(A, i), matrix_row(B, i), matrix_row(C, i), A->cols);
 }
 
-void div_matrices(int A[ROWS][COLS], int B[ROWS][COLS], double C[ROWS][COLS]) {
-    for (int i = 0; i < ROWS; ++i)
-        for (int j = 0; j < COLS; ++j)
-            C[i][j] = (double)A[i][j] / B[i][j]; // B[i][j] от 1 до 100, деление безопасно
+void div_matrices(ew_div_fn op, const matrix* A, const matrix* B, const matrix* C) {
+    for (long long i = 0; i < A->rows; ++i)
+        op(matrix_row(A, i), matrix_row(B, i), (double*)matrix_row(C, i), A->cols);
 }
 
 int main(int argc, char* argv[]) {
     if (argc < 2) {
-        printf("Использование: %s <количество запусков>\n", argv[0]);
+        printf("Использование: %s <количество запусков> [--rows=<строки>] [--cols=<столбцы>] [--seed=<число>]\n"
+               "       [--dtype=int|int64|float|double] [--verify] [--huge] [--warmup=<число>] [--format=text|csv|json] [--out=<файл>]\n", argv[0]);
         return 1;
     }
 
@@ -49,48 +43,104 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    int A[ROWS][COLS], B[ROWS][COLS];
-    int C_add[ROWS][COLS], C_sub[ROWS][COLS], C_mul[ROWS][COLS];
-    double C_div[ROWS][COLS];
-
-    double total_time_add = 0.0;
-    double total_time_sub = 0.0;
-    double total_time_mul = 0.0;
-    double total_time_div = 0.0;
-
-    for (int r = 0; r < runs; r++) {
-        srand(time(NULL) + r);
-        fill_random(A);
-        fill_random(B);
-
-        clock_t start, end;
-
-        start = clock();
-        add_matrices(A, B, C_add);
-        end = clock();
-        total_time_add += (double)(end - start) / CLOCKS_PER_SEC;
-
-        start = clock();
-        sub_matrices(A, B, C_sub);
-        end = clock();
-        total_time_sub += (double)(end - start) / CLOCKS_PER_SEC;
-
-        start = clock();
-        mul_matrices(A, B, C_mul);
-        end = clock();
-        total_time_mul += (double)(end - start) / CLOCKS_PER_SEC;
-
-        start = clock();
-        div_matrices(A, B, C_div);
-        end = clock();
-        total_time_div += (double)(end - start) / CLOCKS_PER_SEC;
+    long long rows = arg_size(argc, argv, "--rows", ROWS);
+    long long cols = arg_size(argc, argv, "--cols", COLS);
+    if (rows <= 0 || cols <= 0) {
+        printf("Некорректный размер матрицы\n");
+        return 1;
     }
 
-    printf("Среднее время выполнения операций за %d запусков:\n", runs);
-    printf("Сложение:    %f секунд\n", total_time_add / runs);
-    printf("Вычитание:   %f секунд\n", total_time_sub / runs);
-    printf("Умножение:   %f секунд\n", total_time_mul / runs);
-    printf("Деление:     %f секунд\n", total_time_div / runs);
+    unsigned long long seed = (unsigned long long)arg_long(argc, argv, "--seed", (long long)time(NULL));
+    int verify = arg_flag(argc, argv, "--verify");
+
+    // Тип элементов; операции — эталонные скалярные ядра этого типа
+    dtype type;
+    if (!dtype_parse(arg_str(argc, argv, "--dtype", "int"), &type)) {
+        printf("Неизвестное значение --dtype (int, int64, float или double)\n");
+        return 1;
+    }
+    size_t elem = dtype_size(type);
+    const ew_kernels* ops = &ew_scalar[type];
+
+    // Матрицы в куче с выравниванием строк на строку кэша; --huge — на большие страницы
+    int flags = MATRIX_PAD_ROWS | (arg_flag(argc, argv, "--huge") ? MATRIX_HUGE : 0);
+    matrix A, B, C_add, C_sub, C_mul, C_div;
+    if (!matrix_alloc(&A, rows, cols, elem, flags) || !matrix_alloc(&B, rows, cols, elem, flags)
+        || !matrix_alloc(&C_add, rows, cols, elem, flags) || !matrix_alloc(&C_sub, rows, cols, elem, flags)
+        || !matrix_alloc(&C_mul, rows, cols, elem, flags)
+        || !matrix_alloc(&C_div, rows, cols, sizeof(double), flags)) {
+        printf("Ошибка выделения памяти\n");
+        return 1;
+    }
+
+    // Измерения: --warmup, --format, --out
+    bench bm;
+    if (!bench_init(&bm, "task4_seq", runs, argc, argv)) {
+        printf("Некорректное значение --warmup или --format\n");
+        return 1;
+    }
+    bm.size = rows * cols;
+    bench_param(&bm, "rows", "%lld", rows);
+    bench_param(&bm, "cols", "%lld", cols);
+    bench_param(&bm, "dtype", "%s", dtype_names[type]);
+    int s_add = bench_series_add(&bm, "add", "Сложение");
+    int s_sub = bench_series_add(&bm, "sub", "Вычитание");
+    int s_mul = bench_series_add(&bm, "mul", "Умножение");
+    int s_div = bench_series_add(&bm, "div", "Деление");
+    int s_separate = bench_series_add(&bm, "separate", "Все четыре раздельно");
+
+    for (int it = 0; it < bench_iterations(&bm); it++) {
+        int r = bench_is_warmup(&bm, it) ? 0 : it - bm.warmup;  // прогрев идёт на данных первого запуска
+
+        fill_random(&A, type, seed + r, 0);
+        fill_random(&B, type, seed + r, 1);
+
+        double start, end, separate = 0.0;
+
+        start = bench_now();
+        binary_matrices(ops->add, &A, &B, &C_add);
+        end = bench_now();
+        bench_record(&bm, s_add, it, end - start);
+        separate += end - start;
+
+        start = bench_now();
+        binary_matrices(ops->sub, &A, &B, &C_sub);
+        end = bench_now();
+        bench_record(&bm, s_sub, it, end - start);
+        separate += end - start;
+
+        start = bench_now();
+        binary_matrices(ops->mul, &A, &B, &C_mul);
+        end = bench_now();
+        bench_record(&bm, s_mul, it, end - start);
+        separate += end - start;
+
+        start = bench_now();
+        div_matrices(ops->div, &A, &B, &C_div);
+        end = bench_now();
+        bench_record(&bm, s_div, it, end - start);
+        separate += end - start;
+
+        bench_record(&bm, s_separate, it, separate);
+    }
+
+    printf("Размер матриц: %lld x %lld (%s)\n", rows, cols, dtype_names[type]);
+    bench_report(&bm);
+    // Контрольная сумма результатов последнего запуска совпадает с task4_par --verify при том же --seed;
+    // строки суммируются по отдельности, поэтому выравнивание строк на неё не влияет
+    if (verify) {
+        unsigned long long checksum = 0;
+        for (long long i = 0; i < rows; ++i) {
+            ew_arrays row = { type, matrix_row(&A, i), matrix_row(&B, i), matrix_row(&C_add, i),
+                              matrix_row(&C_sub, i), matrix_row(&C_mul, i), (double*)matrix_row(&C_div, i) };
+            checksum += ew_checksum(&row, cols, i * cols);
+        }
+        printf("Контрольная сумма: %016llx\n", checksum);
+    }
+    bench_write(&bm);
+    bench_free(&bm);
 
+    matrix_free(&A); matrix_free(&B);
+    matrix_free(&C_add); matrix_free(&C_sub); matrix_free(&C_mul); matrix_free(&C_div);
     return 0;
 }